@@ -0,0 +1,241 @@
+#include "benchmarks/benchmark.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "language-tools/intern.h"
+#include "language-tools/memory_stats.h"
+
+static uint64_t allocations_ = 0;
+
+#ifdef LANGUAGE_TOOLS_BENCHMARK_COUNT_ALLOCATIONS
+// Linked with -Wl,--wrap so that every allocation made by the pipeline, its
+// dependencies included, passes through here.
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  __atomic_fetch_add(&allocations_, 1, __ATOMIC_RELAXED);
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t num, size_t size) {
+  __atomic_fetch_add(&allocations_, 1, __ATOMIC_RELAXED);
+  return __real_calloc(num, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  __atomic_fetch_add(&allocations_, 1, __ATOMIC_RELAXED);
+  return __real_realloc(ptr, size);
+}
+#endif
+
+static int64_t now_ns_() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((int64_t)ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t benchmark_allocations() {
+  return __atomic_load_n(&allocations_, __ATOMIC_RELAXED);
+}
+
+long benchmark_peak_rss_kb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  // Reported in bytes rather than kilobytes.
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+void benchmark_stage_start(BenchmarkStage *stage, const char name[]) {
+  stage->name = name;
+  stage->start_allocations = benchmark_allocations();
+  stage->start_ns = now_ns_();
+}
+
+void benchmark_stage_end(BenchmarkStage *stage) {
+  stage->elapsed_ns = now_ns_() - stage->start_ns;
+  stage->allocations = benchmark_allocations() - stage->start_allocations;
+}
+
+void benchmark_report_header(FILE *out) {
+  fprintf(out, "%-12s %12s %14s %14s %14s %12s %12s\n", "stage", "ms",
+          "tokens/s", "nodes/s", "peak_rss_kb", "allocs", "allocs/token");
+}
+
+void benchmark_report(const BenchmarkStage *stage, size_t num_tokens,
+                      size_t num_nodes, FILE *out) {
+  const double seconds = stage->elapsed_ns / 1e9;
+  fprintf(out, "%-12s %12.3f %14.0f %14.0f %14ld", stage->name,
+          stage->elapsed_ns / 1e6, seconds > 0 ? num_tokens / seconds : 0,
+          seconds > 0 ? num_nodes / seconds : 0, benchmark_peak_rss_kb());
+#ifdef LANGUAGE_TOOLS_BENCHMARK_COUNT_ALLOCATIONS
+  fprintf(out, " %12lu %12.3f\n", (unsigned long)stage->allocations,
+          num_tokens > 0 ? (double)stage->allocations / num_tokens : 0);
+#else
+  fprintf(out, " %12s %12s\n", "n/a", "n/a");
+#endif
+}
+
+size_t benchmark_count_nodes(const SyntaxTree *st) {
+  size_t num_nodes = 1;
+  if (!st->has_children) {
+    return num_nodes;
+  }
+  SyntaxTreeArrayIterator children;
+  SyntaxTreeArray_iterator(&children, (SyntaxTreeArray *)&st->children);
+  for (; SyntaxTreeArray_has_next(&children);
+       SyntaxTreeArray_next(&children)) {
+    num_nodes += benchmark_count_nodes(*SyntaxTreeArray_value(&children));
+  }
+  return num_nodes;
+}
+
+int benchmark_main(const BenchmarkGrammar *grammar, int argc,
+                   const char *argv[]) {
+  int num_threads = 1;
+  const char threads_flag[] = "--threads=";
+  if (3 == argc &&
+      0 == strncmp(threads_flag, argv[2], sizeof(threads_flag) - 1)) {
+    num_threads = atoi(argv[2] + sizeof(threads_flag) - 1);
+  } else if (2 != argc) {
+    fprintf(stderr, "Usage: %s <corpus file> [--threads=N]\n", argv[0]);
+    return 1;
+  }
+  global_string_intern_pool_init();
+
+  BenchmarkStage stage;
+  fprintf(stdout, "%s: %s\n", grammar->name, argv[1]);
+  benchmark_report_header(stdout);
+
+  // Lexer.
+  benchmark_stage_start(&stage, "tokenize");
+  FileInfo *file = file_info(argv[1]);
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  grammar->tokenize(file, &tokens);
+  benchmark_stage_end(&stage);
+  const size_t num_tokens = TokenArray_size(&tokens);
+  benchmark_report(&stage, num_tokens, 0, stdout);
+
+  // Recognizer. Validates every top-level form without building trees. The
+  // spans are deleted afterwards to return the tokens for the parser.
+  benchmark_stage_start(&stage, "recognize");
+  Parser recognizer;
+  parser_init(&recognizer, grammar->root);
+  parser_set_mode(&recognizer, PARSER_MODE_RECOGNIZE);
+  SyntaxTreeArray spans;
+  SyntaxTreeArray_init(&spans);
+  while (true) {
+    SyntaxTree *span = parser_parse(&recognizer, &tokens);
+    if (!span->matched) {
+      break;
+    }
+    SyntaxTreeArray_push_back(&spans, span);
+  }
+  benchmark_stage_end(&stage);
+  benchmark_report(&stage, num_tokens, 0, stdout);
+  while (!SyntaxTreeArray_is_empty(&spans)) {
+    parser_delete_st(&recognizer, SyntaxTreeArray_pop_back_unchecked(&spans));
+  }
+  SyntaxTreeArray_finalize(&spans);
+  parser_finalize(&recognizer);
+
+  // Parser. Each top-level form is parsed separately, as a REPL would, or
+  // split among threads.
+  benchmark_stage_start(&stage, "parse");
+  Parser parser;
+  parser_init(&parser, grammar->root);
+  parser_set_token_boundary(&parser, grammar->token_boundary);
+  SyntaxTreeArray trees;
+  SyntaxTreeArray_init(&trees);
+  if (num_threads > 1) {
+    SyntaxTree *st = parser_parse_parallel(&parser, &tokens, num_threads);
+    if (!st->matched) {
+      fprintf(stderr, "Failed to parse.\n");
+      return 1;
+    }
+    for (int i = 0; i < SyntaxTreeArray_size(&st->children); ++i) {
+      SyntaxTreeArray_push_back(
+          &trees, SyntaxTreeArray_get_unchecked(&st->children, i));
+    }
+  }
+  while (!TokenArray_is_empty(&tokens)) {
+    SyntaxTree *st = parser_parse(&parser, &tokens);
+    if (!st->matched) {
+      if (TokenArray_is_empty(&tokens)) {
+        break;
+      }
+      const Token *token = TokenArray_get_unchecked(&tokens, 0);
+      int line, col;
+      token_line_col(NULL, token, &line, &col);
+      fprintf(stderr, "Failed to parse '%s' at line %d, col %d.\n",
+              token->text, line, col);
+      return 1;
+    }
+    SyntaxTreeArray_push_back(&trees, st);
+  }
+  benchmark_stage_end(&stage);
+  size_t num_nodes = 0;
+  SyntaxTreeArrayIterator iter;
+  SyntaxTreeArray_iterator(&iter, &trees);
+  for (; SyntaxTreeArray_has_next(&iter); SyntaxTreeArray_next(&iter)) {
+    num_nodes += benchmark_count_nodes(*SyntaxTreeArray_value(&iter));
+  }
+  benchmark_report(&stage, num_tokens, num_nodes, stdout);
+
+  // Semantic analyzer.
+  benchmark_stage_start(&stage, "analyze");
+  SemanticAnalyzer analyzer;
+  semantic_analyzer_init(&analyzer, grammar->init_semantics);
+  ExpressionTreeArray etrees;
+  ExpressionTreeArray_init(&etrees);
+  SyntaxTreeArray_iterator(&iter, &trees);
+  for (; SyntaxTreeArray_has_next(&iter); SyntaxTreeArray_next(&iter)) {
+    ExpressionTreeArray_push_back(
+        &etrees,
+        semantic_analyzer_populate(&analyzer, *SyntaxTreeArray_value(&iter)));
+  }
+  benchmark_stage_end(&stage);
+  benchmark_report(&stage, num_tokens, num_nodes, stdout);
+
+  // Teardown. Trees are deleted last to first so that their tokens are
+  // returned to the array in order. Trees parsed in parallel are freed with
+  // the parser.
+  benchmark_stage_start(&stage, "delete");
+  for (int i = 0; i < ExpressionTreeArray_size(&etrees); ++i) {
+    semantic_analyzer_delete(&analyzer,
+                             ExpressionTreeArray_get_unchecked(&etrees, i));
+  }
+  ExpressionTreeArray_finalize(&etrees);
+  semantic_analyzer_finalize(&analyzer);
+  for (int i = SyntaxTreeArray_size(&trees) - 1; num_threads <= 1 && i >= 0;
+       --i) {
+    parser_delete_st(&parser, SyntaxTreeArray_get_unchecked(&trees, i));
+  }
+  SyntaxTreeArray_finalize(&trees);
+  parser_finalize(&parser);
+  TokenArray_finalize(&tokens);
+  token_finalize_all();
+  file_info_delete(file);
+  benchmark_stage_end(&stage);
+  benchmark_report(&stage, num_tokens, num_nodes, stdout);
+
+#ifdef LANGUAGE_TOOLS_MEMORY_STATS
+  // Peaks are over the whole run, and only interned strings are still live.
+  LtMemoryStats memory;
+  lt_memory_stats(&memory);
+  fprintf(stdout, "\n");
+  lt_memory_stats_print(&memory, stdout);
+#endif
+
+  global_string_intern_pool_finalize();
+  return 0;
+}
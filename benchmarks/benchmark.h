@@ -0,0 +1,62 @@
+#ifndef COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_BENCHMARKS_BENCHMARK_H_
+#define COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_BENCHMARKS_BENCHMARK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "file-utils/file_info.h"
+#include "language-tools/lexer/token.h"
+#include "language-tools/parser/parser.h"
+#include "language-tools/semantic_analyzer/semantic_analyzer.h"
+
+typedef void (*TokenizeFn)(FileInfo *file, TokenArray *tokens);
+
+// Everything needed to run a generated lexer, parser and semantic analyzer
+// end-to-end over a corpus.
+typedef struct {
+  const char *name;
+  TokenizeFn tokenize;
+  RuleFn root;
+  TokenBoundaryFn token_boundary;
+  SemanticAnalyzerInitFn init_semantics;
+} BenchmarkGrammar;
+
+// A timed section of the pipeline. Allocations are only counted when the
+// benchmark is linked with malloc wrapped (see benchmarks/BUILD).
+typedef struct {
+  const char *name;
+  int64_t start_ns, elapsed_ns;
+  uint64_t start_allocations, allocations;
+} BenchmarkStage;
+
+void benchmark_stage_start(BenchmarkStage *stage, const char name[]);
+void benchmark_stage_end(BenchmarkStage *stage);
+
+// Prints a row for stage, with throughput computed over the given number of
+// tokens and syntax tree nodes.
+void benchmark_report_header(FILE *out);
+void benchmark_report(const BenchmarkStage *stage, size_t num_tokens,
+                      size_t num_nodes, FILE *out);
+
+// Peak resident set size of the process so far, in kilobytes.
+long benchmark_peak_rss_kb();
+
+// Number of malloc, calloc and realloc calls so far, or 0 if not counted.
+uint64_t benchmark_allocations();
+
+size_t benchmark_count_nodes(const SyntaxTree *st);
+
+// Runs each stage of grammar's pipeline over the corpus at the path in argv
+// and reports on it. Returns the process exit code.
+int benchmark_main(const BenchmarkGrammar *grammar, int argc,
+                   const char *argv[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_BENCHMARKS_BENCHMARK_H_ */
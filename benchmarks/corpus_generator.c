@@ -0,0 +1,229 @@
+// Generates synthetic benchmark inputs for examples/lisp and for the
+// production-rules grammar.
+//
+// Usage:
+//   corpus_generator --grammar=lisp|production --size=<bytes>[K|M|G]
+//                    [--depth=N] [--width=N] [--seed=N] [--out=<file>]
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  FILE *out;
+  uint64_t written;
+  int depth;
+  int width;
+  int num_rules;
+} Corpus;
+
+static const char *LISP_FUNCTIONS_[] = {"and", "or", "not", "if",
+                                        "+",   "-",  "*",   "/"};
+static const char *PRODUCTION_TOKENS_[] = {
+    "TOKEN_WORD", "TOKEN_INTEGER", "SYMBOL_LPAREN", "SYMBOL_RPAREN",
+    "SYMBOL_COMMA", "KEYWORD_IF", "KEYWORD_ELSE", "SYMBOL_EQUALS"};
+
+#define NUM_ELEMENTS_(array) (sizeof(array) / sizeof(array[0]))
+
+static void emit_(Corpus *corpus, const char fmt[], ...) {
+  va_list args;
+  va_start(args, fmt);
+  const int len = vfprintf(corpus->out, fmt, args);
+  va_end(args);
+  if (len < 0) {
+    fprintf(stderr, "Failed to write corpus.\n");
+    exit(1);
+  }
+  corpus->written += len;
+}
+
+static void lisp_number_(Corpus *corpus) {
+  if (rand() % 2) {
+    emit_(corpus, "%d", rand() % 1000);
+  } else {
+    emit_(corpus, "%d.%d", rand() % 1000, rand() % 100);
+  }
+}
+
+static void lisp_expression_(Corpus *corpus, int depth) {
+  if (depth <= 0) {
+    lisp_number_(corpus);
+    return;
+  }
+  const char *function =
+      LISP_FUNCTIONS_[rand() % NUM_ELEMENTS_(LISP_FUNCTIONS_)];
+  emit_(corpus, "(%s", function);
+  int width = 1 + rand() % corpus->width;
+  // Keep forms evaluable: not takes one argument and if two or three.
+  if (0 == strcmp("not", function)) {
+    width = 1;
+  } else if (0 == strcmp("if", function)) {
+    width = 2 + rand() % 2;
+  }
+  for (int i = 0; i < width; ++i) {
+    emit_(corpus, " ");
+    // The first argument always nests so that every form reaches depth.
+    if (0 == i || rand() % 2) {
+      lisp_expression_(corpus, depth - 1);
+    } else {
+      lisp_number_(corpus);
+    }
+  }
+  emit_(corpus, ")");
+}
+
+static void lisp_form_(Corpus *corpus) {
+  lisp_expression_(corpus, 1 + rand() % corpus->depth);
+  emit_(corpus, "\n");
+}
+
+static void production_leaf_(Corpus *corpus) {
+  switch (rand() % 4) {
+    case 0:
+      // References are to rules that precede it.
+      emit_(corpus, "rule:rule%d",
+            corpus->num_rules > 0 ? rand() % corpus->num_rules : 0);
+      return;
+    case 1:
+      emit_(corpus, "E");
+      return;
+    default:
+      emit_(corpus, "token:%s",
+            PRODUCTION_TOKENS_[rand() % NUM_ELEMENTS_(PRODUCTION_TOKENS_)]);
+      return;
+  }
+}
+
+static void production_expression_(Corpus *corpus, int depth) {
+  if (depth <= 0) {
+    production_leaf_(corpus);
+    return;
+  }
+  switch (rand() % 5) {
+    case 0:
+      emit_(corpus, "OPTIONAL(");
+      production_expression_(corpus, depth - 1);
+      emit_(corpus, ")");
+      return;
+    case 1:
+      emit_(corpus, "LIST(");
+      production_leaf_(corpus);
+      emit_(corpus, ", ");
+      production_expression_(corpus, depth - 1);
+      emit_(corpus, ")");
+      return;
+    default:
+      break;
+  }
+  emit_(corpus, rand() % 2 ? "AND(" : "OR(");
+  // The production-rules semantics require at least two elements.
+  const int width = 2 + rand() % (corpus->width > 1 ? corpus->width - 1 : 1);
+  for (int i = 0; i < width; ++i) {
+    if (i > 0) {
+      emit_(corpus, ", ");
+    }
+    if (0 == i || rand() % 2) {
+      production_expression_(corpus, depth - 1);
+    } else {
+      production_leaf_(corpus);
+    }
+  }
+  emit_(corpus, ")");
+}
+
+static void production_form_(Corpus *corpus) {
+  emit_(corpus, "rule%d ->\n  ", corpus->num_rules);
+  production_expression_(corpus, 1 + rand() % corpus->depth);
+  emit_(corpus, ";\n\n");
+  corpus->num_rules++;
+}
+
+static uint64_t parse_size_(const char text[]) {
+  char *end;
+  uint64_t size = strtoull(text, &end, 10);
+  switch (*end) {
+    case 'G':
+    case 'g':
+      size *= 1024;
+      // Fallthrough.
+    case 'M':
+    case 'm':
+      size *= 1024;
+      // Fallthrough.
+    case 'K':
+    case 'k':
+      size *= 1024;
+      break;
+    case '\0':
+      break;
+    default:
+      fprintf(stderr, "Invalid size: '%s'.\n", text);
+      exit(1);
+  }
+  return size;
+}
+
+static bool flag_(const char arg[], const char name[], const char **value) {
+  const size_t len = strlen(name);
+  if (0 != strncmp(arg, name, len) || '=' != arg[len]) {
+    return false;
+  }
+  *value = arg + len + 1;
+  return true;
+}
+
+int main(int argc, const char *argv[]) {
+  const char *grammar = NULL, *out_path = NULL, *value;
+  uint64_t size = 1024;
+  unsigned int seed = 1;
+  Corpus corpus = {.out = stdout, .written = 0, .depth = 8, .width = 4};
+  for (int i = 1; i < argc; ++i) {
+    if (flag_(argv[i], "--grammar", &value)) {
+      grammar = value;
+    } else if (flag_(argv[i], "--size", &value)) {
+      size = parse_size_(value);
+    } else if (flag_(argv[i], "--depth", &value)) {
+      corpus.depth = atoi(value);
+    } else if (flag_(argv[i], "--width", &value)) {
+      corpus.width = atoi(value);
+    } else if (flag_(argv[i], "--seed", &value)) {
+      seed = (unsigned int)atoi(value);
+    } else if (flag_(argv[i], "--out", &value)) {
+      out_path = value;
+    } else {
+      fprintf(stderr, "Unknown argument: '%s'.\n", argv[i]);
+      return 1;
+    }
+  }
+  if (corpus.depth < 1 || corpus.width < 1) {
+    fprintf(stderr, "--depth and --width must be positive.\n");
+    return 1;
+  }
+  void (*form)(Corpus *);
+  if (NULL != grammar && 0 == strcmp("lisp", grammar)) {
+    form = lisp_form_;
+  } else if (NULL != grammar && 0 == strcmp("production", grammar)) {
+    form = production_form_;
+  } else {
+    fprintf(stderr, "--grammar must be one of: lisp, production.\n");
+    return 1;
+  }
+  if (NULL != out_path && NULL == (corpus.out = fopen(out_path, "w"))) {
+    fprintf(stderr, "Could not open '%s'.\n", out_path);
+    return 1;
+  }
+
+  srand(seed);
+  // Whole forms are written, so the corpus may exceed size by one form.
+  while (corpus.written < size) {
+    form(&corpus);
+  }
+
+  if (NULL != out_path) {
+    fclose(corpus.out);
+  }
+  return 0;
+}
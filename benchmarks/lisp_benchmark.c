@@ -0,0 +1,13 @@
+#include "benchmarks/benchmark.h"
+#include "examples/lisp/lisp_lexer.h"
+#include "examples/lisp/lisp_parser.h"
+#include "examples/lisp/semantics.h"
+
+int main(int argc, const char *argv[]) {
+  const BenchmarkGrammar lisp = {.name = "lisp",
+                                 .tokenize = lisp_lexer_tokenize,
+                                 .root = rule_expression,
+                                 .token_boundary = lisp_token_type_boundary,
+                                 .init_semantics = init_semantics};
+  return benchmark_main(&lisp, argc, argv);
+}
@@ -0,0 +1,17 @@
+#include "benchmarks/benchmark.h"
+#include "language-tools/parser/production_lexer/production_lexer.h"
+#include "language-tools/parser/production_parser/production_parser_semantics.h"
+#include "language-tools/parser/production_parser/production_rules.h"
+
+int main(int argc, const char *argv[]) {
+  // Rules are parsed one at a time rather than as a single
+  // production_rule_set, whose right recursion is as deep as the corpus is
+  // long.
+  const BenchmarkGrammar production = {
+      .name = "production",
+      .tokenize = lexer_tokenize,
+      .root = rule_production_rule,
+      .token_boundary = token_type_boundary,
+      .init_semantics = production_parser_init_semantics};
+  return benchmark_main(&production, argc, argv);
+}
@@ -0,0 +1,255 @@
+#include "examples/lisp/bytecode.h"
+
+#include <stdlib.h>
+
+IMPL_ARRAYLIKE(LispInstructionArray, LispInstruction);
+IMPL_ARRAYLIKE(LispConstantArray, double);
+
+// Stacks at most this deep are kept on the C stack during execution.
+#define LISP_INLINE_STACK_SIZE_ 64
+
+void lisp_bytecode_init(LispBytecode *bytecode) {
+  LispInstructionArray_init(&bytecode->code);
+  LispConstantArray_init(&bytecode->constants);
+  bytecode->stack_depth = 0;
+  bytecode->max_stack_depth = 0;
+}
+
+void lisp_bytecode_finalize(LispBytecode *bytecode) {
+  LispInstructionArray_finalize(&bytecode->code);
+  LispConstantArray_finalize(&bytecode->constants);
+}
+
+void lisp_bytecode_clear(LispBytecode *bytecode) {
+  while (!LispInstructionArray_is_empty(&bytecode->code)) {
+    LispInstructionArray_pop_back_unchecked(&bytecode->code);
+  }
+  while (!LispConstantArray_is_empty(&bytecode->constants)) {
+    LispConstantArray_pop_back_unchecked(&bytecode->constants);
+  }
+  bytecode->stack_depth = bytecode->max_stack_depth = 0;
+}
+
+static int stack_effect_(LispOp op) {
+  switch (op) {
+    case OP_PUSH:
+      return 1;
+    case OP_ADD:
+    case OP_SUBTRACT:
+    case OP_MULTIPLY:
+    case OP_DIVIDE:
+    case OP_JUMP_IF_FALSE:
+    case OP_RETURN:
+      return -1;
+    // Measured along the path that does not jump.
+    case OP_AND:
+    case OP_OR:
+      return -1;
+    default:
+      return 0;
+  }
+}
+
+int lisp_bytecode_emit(LispBytecode *bytecode, LispOp op, int32_t arg) {
+  LispInstruction *instruction =
+      LispInstructionArray_push_back_ref(&bytecode->code);
+  instruction->op = op;
+  instruction->arg = arg;
+  bytecode->stack_depth += stack_effect_(op);
+  if (bytecode->stack_depth > bytecode->max_stack_depth) {
+    bytecode->max_stack_depth = bytecode->stack_depth;
+  }
+  return LispInstructionArray_size(&bytecode->code) - 1;
+}
+
+void lisp_bytecode_emit_constant(LispBytecode *bytecode, double value) {
+  LispConstantArray_push_back(&bytecode->constants, value);
+  lisp_bytecode_emit(bytecode, OP_PUSH,
+                     LispConstantArray_size(&bytecode->constants) - 1);
+}
+
+void lisp_bytecode_patch_jump(LispBytecode *bytecode, int index) {
+  LispInstructionArray_mutable_ref_unchecked(&bytecode->code, index)->arg =
+      LispInstructionArray_size(&bytecode->code);
+}
+
+double lisp_bytecode_execute(const LispBytecode *bytecode) {
+  const LispInstruction *code =
+      LispInstructionArray_mutable_ref_unchecked(
+          (LispInstructionArray *)&bytecode->code, 0);
+  const double *constants =
+      LispConstantArray_is_empty(&bytecode->constants)
+          ? NULL
+          : LispConstantArray_mutable_ref_unchecked(
+                (LispConstantArray *)&bytecode->constants, 0);
+  double inline_stack[LISP_INLINE_STACK_SIZE_];
+  double *stack = bytecode->max_stack_depth <= LISP_INLINE_STACK_SIZE_
+                      ? inline_stack
+                      : malloc(sizeof(double) * bytecode->max_stack_depth);
+  // Points at the top of the stack.
+  double *top = stack - 1;
+  const LispInstruction *instruction = code;
+  double result = 0;
+
+#if defined(__GNUC__)
+  // Threaded dispatch: each handler jumps straight to the next one.
+  static const void *handlers[] = {
+      [OP_PUSH] = &&label_OP_PUSH,
+      [OP_ADD] = &&label_OP_ADD,
+      [OP_SUBTRACT] = &&label_OP_SUBTRACT,
+      [OP_MULTIPLY] = &&label_OP_MULTIPLY,
+      [OP_DIVIDE] = &&label_OP_DIVIDE,
+      [OP_NOT] = &&label_OP_NOT,
+      [OP_BOOL] = &&label_OP_BOOL,
+      [OP_AND] = &&label_OP_AND,
+      [OP_OR] = &&label_OP_OR,
+      [OP_JUMP_IF_FALSE] = &&label_OP_JUMP_IF_FALSE,
+      [OP_JUMP] = &&label_OP_JUMP,
+      [OP_RETURN] = &&label_OP_RETURN,
+  };
+#define DISPATCH_() goto *handlers[instruction->op]
+#define CASE_(op) label_##op:
+#else
+#define DISPATCH_() goto dispatch
+#define CASE_(op) case op:
+#endif
+#define NEXT_()    \
+  ++instruction;   \
+  DISPATCH_()
+
+#if defined(__GNUC__)
+  DISPATCH_();
+  {
+#else
+dispatch:
+  switch (instruction->op) {
+#endif
+    CASE_(OP_PUSH) {
+      *++top = constants[instruction->arg];
+      NEXT_();
+    }
+    CASE_(OP_ADD) {
+      --top;
+      top[0] += top[1];
+      NEXT_();
+    }
+    CASE_(OP_SUBTRACT) {
+      --top;
+      top[0] -= top[1];
+      NEXT_();
+    }
+    CASE_(OP_MULTIPLY) {
+      --top;
+      top[0] *= top[1];
+      NEXT_();
+    }
+    CASE_(OP_DIVIDE) {
+      --top;
+      top[0] /= top[1];
+      NEXT_();
+    }
+    CASE_(OP_NOT) {
+      *top = !*top;
+      NEXT_();
+    }
+    CASE_(OP_BOOL) {
+      *top = !!*top;
+      NEXT_();
+    }
+    CASE_(OP_AND) {
+      if (!*top) {
+        *top = 0;
+        instruction = code + instruction->arg;
+        DISPATCH_();
+      }
+      --top;
+      NEXT_();
+    }
+    CASE_(OP_OR) {
+      if (*top) {
+        *top = 1;
+        instruction = code + instruction->arg;
+        DISPATCH_();
+      }
+      --top;
+      NEXT_();
+    }
+    CASE_(OP_JUMP_IF_FALSE) {
+      if (!*top--) {
+        instruction = code + instruction->arg;
+        DISPATCH_();
+      }
+      NEXT_();
+    }
+    CASE_(OP_JUMP) {
+      instruction = code + instruction->arg;
+      DISPATCH_();
+    }
+    CASE_(OP_RETURN) {
+      result = *top;
+      goto done;
+    }
+  }
+#undef NEXT_
+#undef CASE_
+#undef DISPATCH_
+
+done:
+  if (stack != inline_stack) {
+    free(stack);
+  }
+  return result;
+}
+
+static const char *op_name_(LispOp op) {
+  switch (op) {
+    case OP_PUSH:
+      return "PUSH";
+    case OP_ADD:
+      return "ADD";
+    case OP_SUBTRACT:
+      return "SUBTRACT";
+    case OP_MULTIPLY:
+      return "MULTIPLY";
+    case OP_DIVIDE:
+      return "DIVIDE";
+    case OP_NOT:
+      return "NOT";
+    case OP_BOOL:
+      return "BOOL";
+    case OP_AND:
+      return "AND";
+    case OP_OR:
+      return "OR";
+    case OP_JUMP_IF_FALSE:
+      return "JUMP_IF_FALSE";
+    case OP_JUMP:
+      return "JUMP";
+    case OP_RETURN:
+      return "RETURN";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+void lisp_bytecode_print(const LispBytecode *bytecode, FILE *out) {
+  int index = 0;
+  LispInstructionArrayIterator iter;
+  LispInstructionArray_iterator(&iter,
+                                (LispInstructionArray *)&bytecode->code);
+  for (; LispInstructionArray_has_next(&iter);
+       LispInstructionArray_next(&iter), ++index) {
+    const LispInstruction *instruction = LispInstructionArray_value(&iter);
+    fprintf(out, "%4d  %-14s", index, op_name_(instruction->op));
+    if (OP_PUSH == instruction->op) {
+      fprintf(out, "%g", LispConstantArray_get_unchecked(
+                             (LispConstantArray *)&bytecode->constants,
+                             instruction->arg));
+    } else if (OP_AND == instruction->op || OP_OR == instruction->op ||
+               OP_JUMP_IF_FALSE == instruction->op ||
+               OP_JUMP == instruction->op) {
+      fprintf(out, "%d", instruction->arg);
+    }
+    fprintf(out, "\n");
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_EXAMPLES_LISP_BYTECODE_H_
+#define COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_EXAMPLES_LISP_BYTECODE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "c-data-structures/arraylike.h"
+
+// Instructions of a stack machine over doubles. Jump targets are instruction
+// indices.
+typedef enum {
+  // Pushes constants[arg].
+  OP_PUSH,
+  OP_ADD,
+  OP_SUBTRACT,
+  OP_MULTIPLY,
+  OP_DIVIDE,
+  // Replaces the top of the stack with !top.
+  OP_NOT,
+  // Replaces the top of the stack with !!top.
+  OP_BOOL,
+  // If the top of the stack is false, replaces it with 0 and jumps to arg.
+  // Otherwise pops it.
+  OP_AND,
+  // If the top of the stack is true, replaces it with 1 and jumps to arg.
+  // Otherwise pops it.
+  OP_OR,
+  // Pops the top of the stack and jumps to arg if it is false.
+  OP_JUMP_IF_FALSE,
+  OP_JUMP,
+  // Ends execution with the top of the stack as the result.
+  OP_RETURN,
+} LispOp;
+
+typedef struct {
+  LispOp op;
+  int32_t arg;
+} LispInstruction;
+
+DEFINE_ARRAYLIKE(LispInstructionArray, LispInstruction);
+DEFINE_ARRAYLIKE(LispConstantArray, double);
+
+typedef struct {
+  LispInstructionArray code;
+  LispConstantArray constants;
+  // Stack depth at the current point of compilation, and the most needed.
+  int stack_depth, max_stack_depth;
+} LispBytecode;
+
+void lisp_bytecode_init(LispBytecode *bytecode);
+void lisp_bytecode_finalize(LispBytecode *bytecode);
+// Empties bytecode while keeping its storage, so that it can be reused to
+// compile another expression.
+void lisp_bytecode_clear(LispBytecode *bytecode);
+
+// Appends an instruction and returns its index, so that jumps can be patched
+// once their target is known.
+int lisp_bytecode_emit(LispBytecode *bytecode, LispOp op, int32_t arg);
+void lisp_bytecode_emit_constant(LispBytecode *bytecode, double value);
+// Points the jump at index to the next instruction to be emitted.
+void lisp_bytecode_patch_jump(LispBytecode *bytecode, int index);
+
+double lisp_bytecode_execute(const LispBytecode *bytecode);
+void lisp_bytecode_print(const LispBytecode *bytecode, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_EXAMPLES_LISP_BYTECODE_H_ */
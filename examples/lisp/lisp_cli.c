@@ -1,3 +1,18 @@
+// Evaluates LISP expressions.
+//
+// Usage:
+//   lisp_cli                             Interactive REPL on stdin.
+//   lisp_cli --batch [--quiet] [<file>]  Evaluates every expression in file
+//                                        (or stdin) and reports throughput.
+//
+// Expressions are constant-folded before they are compiled unless --no-fold
+// is given.
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "examples/lisp/bytecode.h"
 #include "examples/lisp/lisp_lexer.h"
 #include "examples/lisp/lisp_parser.h"
 #include "examples/lisp/semantics.h"
@@ -6,48 +21,214 @@
 #include "language-tools/intern.h"
 #include "language-tools/lexer/token.h"
 
-int main(int argc, const char *args[]) {
-  global_string_intern_pool_init();
+typedef enum {
+  STAGE_TOKENIZE,
+  STAGE_PARSE,
+  STAGE_ANALYZE,
+  STAGE_FOLD,
+  STAGE_COMPILE,
+  STAGE_EXECUTE,
+  STAGE_DELETE,
+  NUM_STAGES,
+} BatchStage;
+
+static const char *STAGE_NAMES_[] = {"tokenize", "parse",   "analyze",
+                                     "fold",     "compile", "execute",
+                                     "delete"};
+
+static int64_t now_ns_() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((int64_t)ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Adds the time since *start to stage and restarts the clock.
+static void lap_(int64_t stage_ns[], BatchStage stage, int64_t *start) {
+  const int64_t now = now_ns_();
+  stage_ns[stage] += now - *start;
+  *start = now;
+}
+
+static void report_(const int64_t stage_ns[], size_t num_expressions,
+                    size_t num_tokens, FILE *out) {
+  int64_t total_ns = 0;
+  for (int i = 0; i < NUM_STAGES; ++i) {
+    total_ns += stage_ns[i];
+  }
+  fprintf(out, "%-10s %12s %8s %16s\n", "stage", "ms", "%", "expressions/s");
+  for (int i = 0; i < NUM_STAGES; ++i) {
+    fprintf(out, "%-10s %12.3f %8.1f %16.0f\n", STAGE_NAMES_[i],
+            stage_ns[i] / 1e6,
+            total_ns > 0 ? 100.0 * stage_ns[i] / total_ns : 0,
+            stage_ns[i] > 0 ? num_expressions / (stage_ns[i] / 1e9) : 0);
+  }
+  fprintf(out, "%-10s %12.3f %8.1f %16.0f\n", "total", total_ns / 1e6, 100.0,
+          total_ns > 0 ? num_expressions / (total_ns / 1e9) : 0);
+  fprintf(out, "%lu expressions, %lu tokens.\n", (unsigned long)num_expressions,
+          (unsigned long)num_tokens);
+}
 
+// Evaluates every expression in file, reusing one parser, token array,
+// analyzer and bytecode buffer across all of them. Tokens are released all at
+// once with their arena.
+static int run_batch_(FileInfo *file, const RewritePass *folding,
+                      bool quiet) {
+  int64_t stage_ns[NUM_STAGES] = {0};
+  int64_t start = now_ns_();
+
+  TokenArena arena;
+  token_arena_init(&arena);
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  lisp_lexer_tokenize_in_arena(file, &tokens, &arena);
+  const size_t num_tokens = TokenArray_size(&tokens);
+  lap_(stage_ns, STAGE_TOKENIZE, &start);
+
+  Parser parser;
+  parser_init(&parser, rule_expression);
   SemanticAnalyzer analyzer;
   semantic_analyzer_init(&analyzer, init_semantics);
+  LispBytecode bytecode;
+  lisp_bytecode_init(&bytecode);
 
-  FileInfo *file = file_info_file(stdin);
-
+  size_t num_expressions = 0;
   while (true) {
-    TokenArray tokens;
-    TokenArray_init(&tokens);
+    SyntaxTree *stree = parser_parse(&parser, &tokens);
+    lap_(stage_ns, STAGE_PARSE, &start);
+    if (!stree->matched) {
+      if (TokenArray_is_empty(&tokens)) {
+        break;
+      }
+      const Token *token = TokenArray_get_unchecked(&tokens, 0);
+      int line, col;
+      token_line_col(&arena, token, &line, &col);
+      fprintf(stderr, "Failed to parse '%s' at line %d, col %d.\n",
+              token->text, line, col);
+      return 1;
+    }
+
+    ExpressionTree *etree = semantic_analyzer_populate(&analyzer, stree);
+    lap_(stage_ns, STAGE_ANALYZE, &start);
+
+    if (NULL != folding) {
+      etree = semantic_analyzer_rewrite(&analyzer, etree, folding);
+    }
+    lap_(stage_ns, STAGE_FOLD, &start);
+
+    lisp_bytecode_clear(&bytecode);
+    compile_lisp_expression(&analyzer, etree, &bytecode);
+    lap_(stage_ns, STAGE_COMPILE, &start);
 
+    double result = lisp_bytecode_execute(&bytecode);
+    lap_(stage_ns, STAGE_EXECUTE, &start);
+    if (!quiet) {
+      printf("%0.4f\n", result);
+    }
+
+    semantic_analyzer_delete(&analyzer, etree);
+    parser_reset(&parser);
+    lap_(stage_ns, STAGE_DELETE, &start);
+    ++num_expressions;
+  }
+
+  lisp_bytecode_finalize(&bytecode);
+  semantic_analyzer_finalize(&analyzer);
+  parser_finalize(&parser);
+  TokenArray_finalize(&tokens);
+  token_arena_finalize(&arena);
+  fflush(stdout);
+  report_(stage_ns, num_expressions, num_tokens, stderr);
+  return 0;
+}
+
+static void run_repl_(FileInfo *file, const RewritePass *folding) {
+  SemanticAnalyzer analyzer;
+  semantic_analyzer_init(&analyzer, init_semantics);
+  TokenArena arena;
+  token_arena_init(&arena);
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  Parser parser;
+  parser_init(&parser, rule_expression);
+
+  while (true) {
     printf("> ");
 
-    lisp_lexer_tokenize_line(file, &tokens);
+    lisp_lexer_tokenize_line_in_arena(file, &tokens, &arena);
 
-    Parser parser;
-    parser_init(&parser, rule_expression,
-                /*ignore_newline=*/true);
     SyntaxTree *stree = parser_parse(&parser, &tokens);
     // syntax_tree_print(stree, 0, stdout);
     // printf("\n");
 
     ExpressionTree *etree = semantic_analyzer_populate(&analyzer, stree);
+    if (NULL != folding) {
+      etree = semantic_analyzer_rewrite(&analyzer, etree, folding);
+    }
 
-    double result = evaluate_lisp_expression(etree, stdout);
+    LispBytecode bytecode;
+    lisp_bytecode_init(&bytecode);
+    compile_lisp_expression(&analyzer, etree, &bytecode);
+    double result = lisp_bytecode_execute(&bytecode);
     printf("<-- %0.4f\n", result);
+    lisp_bytecode_finalize(&bytecode);
 
     semantic_analyzer_delete(&analyzer, etree);
 
-    parser_delete_st(&parser, stree);
-    parser_finalize(&parser);
-    TokenArray_finalize(&tokens);
+    parser_reset(&parser);
+    token_array_reset(&tokens);
+    token_arena_reset(&arena);
   }
 
   // Below code not necessary as the program will immediately free all memory
   // upon exit.
 
+  // parser_finalize(&parser);
+  // TokenArray_finalize(&tokens);
+  // token_arena_finalize(&arena);
   // semantic_analyzer_finalize(&analyzer);
-  // file_info_delete(file);
-  // token_finalize_all();
-  // global_string_intern_pool_finalize();
+}
 
-  return 0;
-}
\ No newline at end of file
+int main(int argc, const char *args[]) {
+  bool batch = false, quiet = false, fold = true;
+  const char *path = NULL;
+  for (int i = 1; i < argc; ++i) {
+    if (0 == strcmp("--batch", args[i])) {
+      batch = true;
+    } else if (0 == strcmp("--quiet", args[i])) {
+      quiet = true;
+    } else if (0 == strcmp("--no-fold", args[i])) {
+      fold = false;
+    } else if ('-' != args[i][0] && NULL == path) {
+      path = args[i];
+    } else {
+      fprintf(stderr, "Usage: %s [--no-fold] [--batch [--quiet] [<file>]]\n",
+              args[0]);
+      return 1;
+    }
+  }
+  if (!batch && (quiet || NULL != path)) {
+    fprintf(stderr, "--quiet and <file> are only supported with --batch.\n");
+    return 1;
+  }
+
+  global_string_intern_pool_init();
+
+  RewritePass folding;
+  rewrite_pass_init(&folding, "fold", init_constant_folding);
+
+  FileInfo *file = NULL == path ? file_info_file(stdin) : file_info(path);
+  if (NULL == file) {
+    fprintf(stderr, "Failed to open '%s'.\n", path);
+    return 1;
+  }
+  if (!batch) {
+    run_repl_(file, fold ? &folding : NULL);
+    return 0;
+  }
+  const int status = run_batch_(file, fold ? &folding : NULL, quiet);
+
+  rewrite_pass_finalize(&folding);
+  file_info_delete(file);
+  global_string_intern_pool_finalize();
+  return status;
+}
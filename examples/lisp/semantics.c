@@ -49,6 +49,104 @@ POPULATE_IMPL(expression_function, const SyntaxTree *stree,
   }
 }
 
+// Emits code that evaluates each argument in turn, combining it with the
+// previous result using op.
+static void produce_fold_(SemanticAnalyzer *analyzer, ExpressionTreeArray *args,
+                          LispOp op, LispBytecode *target) {
+  ExpressionTreeArrayIterator it;
+  ExpressionTreeArray_iterator(&it, args);
+  semantic_analyzer_produce(analyzer, *ExpressionTreeArray_value(&it), target);
+  ExpressionTreeArray_next(&it);
+  for (; ExpressionTreeArray_has_next(&it); ExpressionTreeArray_next(&it)) {
+    semantic_analyzer_produce(analyzer, *ExpressionTreeArray_value(&it),
+                              target);
+    lisp_bytecode_emit(target, op, 0);
+  }
+}
+
+// Emits code for and/or, which short-circuit like their tree-walking
+// counterparts: every argument after the first is reduced to 0 or 1.
+static void produce_logical_(SemanticAnalyzer *analyzer,
+                             ExpressionTreeArray *args, LispOp op,
+                             LispBytecode *target) {
+  const int num_args = ExpressionTreeArray_size(args);
+  int *jumps = malloc(sizeof(int) * num_args);
+  ExpressionTreeArrayIterator it;
+  ExpressionTreeArray_iterator(&it, args);
+  semantic_analyzer_produce(analyzer, *ExpressionTreeArray_value(&it), target);
+  ExpressionTreeArray_next(&it);
+  int num_jumps = 0;
+  for (; ExpressionTreeArray_has_next(&it); ExpressionTreeArray_next(&it)) {
+    jumps[num_jumps++] = lisp_bytecode_emit(target, op, 0);
+    semantic_analyzer_produce(analyzer, *ExpressionTreeArray_value(&it),
+                              target);
+    lisp_bytecode_emit(target, OP_BOOL, 0);
+  }
+  for (int i = 0; i < num_jumps; ++i) {
+    lisp_bytecode_patch_jump(target, jumps[i]);
+  }
+  free(jumps);
+}
+
+PRODUCE_IMPL(expression_function, SemanticAnalyzer *analyzer,
+             LispBytecode *target) {
+  ExpressionTreeArray *args = &expression_function->args;
+  switch (expression_function->func) {
+    case FUNC_AND:
+      produce_logical_(analyzer, args, OP_AND, target);
+      break;
+    case FUNC_OR:
+      produce_logical_(analyzer, args, OP_OR, target);
+      break;
+    case FUNC_NOT:
+      semantic_analyzer_produce(analyzer, EXTRACT_TREE(args, 0), target);
+      lisp_bytecode_emit(target, OP_NOT, 0);
+      break;
+    case FUNC_IF: {
+      semantic_analyzer_produce(analyzer, EXTRACT_TREE(args, 0), target);
+      const int jump_to_else = lisp_bytecode_emit(target, OP_JUMP_IF_FALSE, 0);
+      semantic_analyzer_produce(analyzer, EXTRACT_TREE(args, 1), target);
+      const int jump_to_end = lisp_bytecode_emit(target, OP_JUMP, 0);
+      // Only one branch leaves its value on the stack.
+      target->stack_depth--;
+      lisp_bytecode_patch_jump(target, jump_to_else);
+      if (ExpressionTreeArray_size(args) > 2) {
+        semantic_analyzer_produce(analyzer, EXTRACT_TREE(args, 2), target);
+      } else {
+        lisp_bytecode_emit_constant(target, 0);
+      }
+      lisp_bytecode_patch_jump(target, jump_to_end);
+      break;
+    }
+    case FUNC_ADD: {
+      // Starts from 0 like the tree-walking evaluator.
+      lisp_bytecode_emit_constant(target, 0);
+      ExpressionTreeArrayIterator it;
+      ExpressionTreeArray_iterator(&it, args);
+      for (; ExpressionTreeArray_has_next(&it);
+           ExpressionTreeArray_next(&it)) {
+        semantic_analyzer_produce(analyzer, *ExpressionTreeArray_value(&it),
+                                  target);
+        lisp_bytecode_emit(target, OP_ADD, 0);
+      }
+      break;
+    }
+    case FUNC_SUBTRACT:
+      produce_fold_(analyzer, args, OP_SUBTRACT, target);
+      break;
+    case FUNC_MULTIPLY:
+      produce_fold_(analyzer, args, OP_MULTIPLY, target);
+      break;
+    case FUNC_DIVIDE:
+      produce_fold_(analyzer, args, OP_DIVIDE, target);
+      break;
+    default:
+      fprintf(stderr, "Unknown function\n");
+      exit(1);
+  }
+  return 0;
+}
+
 DELETE_IMPL(expression_function, SemanticAnalyzer *analyzer) {
   ExpressionTreeArrayIterator it;
   ExpressionTreeArray_iterator(&it, &expression_function->args);
@@ -59,14 +157,118 @@ DELETE_IMPL(expression_function, SemanticAnalyzer *analyzer) {
 }
 
 POPULATE_IMPL(expression, const SyntaxTree *stree, SemanticAnalyzer *analyzer) {
-  expression->floating = atof(stree->token->text);
+  expression->floating = TOKEN_INTEGER == stree->token->type
+                             ? (double)stree->token->value.integer
+                             : stree->token->value.floating;
+}
+
+PRODUCE_IMPL(expression, SemanticAnalyzer *analyzer, LispBytecode *target) {
+  lisp_bytecode_emit_constant(target, expression->floating);
+  return 0;
 }
 
 DELETE_IMPL(expression, SemanticAnalyzer *analyzer) {}
 
+static ExpressionTree *create_constant_(double value) {
+  ExpressionTree *tree = CREATE_EXPRESSION(expression);
+  EXTRACT_EXPRESSION(tree, expression)->floating = value;
+  return tree;
+}
+
+static ExpressionTree *replace_with_constant_(SemanticAnalyzer *analyzer,
+                                              ExpressionTree *tree,
+                                              double value) {
+  semantic_analyzer_delete(analyzer, tree);
+  return create_constant_(value);
+}
+
+// Replaces an if whose condition is constant with the branch it takes.
+static ExpressionTree *fold_if_(SemanticAnalyzer *analyzer,
+                                ExpressionTree *tree,
+                                Expression_expression_function *f) {
+  const int num_args = ExpressionTreeArray_size(&f->args);
+  ExpressionTree *condition = EXTRACT_TREE(&f->args, 0);
+  if (num_args < 2 || !IS_EXPRESSION(condition, expression)) {
+    return tree;
+  }
+  const int branch =
+      EXTRACT_EXPRESSION(condition, expression)->floating ? 1 : 2;
+  if (branch >= num_args) {
+    // Without an else, a false condition evaluates to 0.
+    return replace_with_constant_(analyzer, tree, 0);
+  }
+  ExpressionTreeArrayIterator it;
+  ExpressionTreeArray_iterator(&it, &f->args);
+  for (int i = 0; i < branch; ++i) {
+    ExpressionTreeArray_next(&it);
+  }
+  // Detach the branch so that it survives deleting the if.
+  ExpressionTree *taken = *ExpressionTreeArray_mutable_value(&it);
+  *ExpressionTreeArray_mutable_value(&it) = create_constant_(0);
+  semantic_analyzer_delete(analyzer, tree);
+  return taken;
+}
+
+REWRITE_IMPL(fold, expression_function, SemanticAnalyzer *analyzer) {
+  bool all_constant = true, any_true = false, any_false = false;
+  ExpressionTreeArrayIterator it;
+  ExpressionTreeArray_iterator(&it, &expression_function->args);
+  for (; ExpressionTreeArray_has_next(&it); ExpressionTreeArray_next(&it)) {
+    ExpressionTree **arg = ExpressionTreeArray_mutable_value(&it);
+    *arg = semantic_analyzer_rewrite(analyzer, *arg, pass);
+    if (!IS_EXPRESSION(*arg, expression)) {
+      all_constant = false;
+    } else if (EXTRACT_EXPRESSION(*arg, expression)->floating) {
+      any_true = true;
+    } else {
+      any_false = true;
+    }
+  }
+  // Expressions have no side effects, so a single constant argument can decide
+  // and/or regardless of the others. With one argument they return it as is.
+  const bool many_args =
+      ExpressionTreeArray_size(&expression_function->args) > 1;
+  switch (expression_function->func) {
+    case FUNC_IF:
+      return fold_if_(analyzer, tree, expression_function);
+    case FUNC_AND:
+      if (many_args && any_false) {
+        return replace_with_constant_(analyzer, tree, 0);
+      }
+      break;
+    case FUNC_OR:
+      if (many_args && any_true) {
+        return replace_with_constant_(analyzer, tree, 1);
+      }
+      break;
+    default:
+      break;
+  }
+  if (!all_constant) {
+    return tree;
+  }
+  // Folds with the evaluator so that the result is exactly what evaluating
+  // the arguments in order would give.
+  const double value = evaluate_lisp_expression(tree, NULL);
+  return replace_with_constant_(analyzer, tree, value);
+}
+
+IMPL_SEMANTIC_ANALYZER_PRODUCE_FN(LispBytecode);
+
 void init_semantics(SAMap *populators, SAMap *producers, SAMap *deleters) {
-  REGISTER_EXPRESSION(expression_function);
-  REGISTER_EXPRESSION(expression);
+  REGISTER_EXPRESSION_WITH_PRODUCER(expression_function);
+  REGISTER_EXPRESSION_WITH_PRODUCER(expression);
+}
+
+void init_constant_folding(SAMap *rewriters) {
+  REGISTER_REWRITE(fold, expression_function);
+}
+
+void compile_lisp_expression(SemanticAnalyzer *analyzer,
+                             const ExpressionTree *tree,
+                             LispBytecode *bytecode) {
+  semantic_analyzer_produce(analyzer, tree, bytecode);
+  lisp_bytecode_emit(bytecode, OP_RETURN, 0);
 }
 
 double evaluate_lisp_expression(ExpressionTree *tree, FILE *file) {
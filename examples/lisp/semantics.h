@@ -5,12 +5,16 @@
 extern "C" {
 #endif
 
+#include "examples/lisp/bytecode.h"
 #include "examples/lisp/lisp_parser.h"
 #include "language-tools/lexer/token.h"
 #include "language-tools/semantic_analyzer/expression_tree.h"
 #include "language-tools/semantic_analyzer/semantic_analyzer.h"
 
-DEFINE_EXPRESSION(expression_function) {
+// Expressions are compiled to bytecode by producing into a LispBytecode.
+DEFINE_SEMANTIC_ANALYZER_PRODUCE_FN(LispBytecode);
+
+DEFINE_EXPRESSION(expression_function, LispBytecode) {
   enum {
     FUNC_AND,
     FUNC_OR,
@@ -24,12 +28,25 @@ DEFINE_EXPRESSION(expression_function) {
   ExpressionTreeArray args;
 };
 
-DEFINE_EXPRESSION(expression) { double floating; };
+DEFINE_EXPRESSION(expression, LispBytecode) { double floating; };
 
 void init_semantics(SAMap *populators, SAMap *producers, SAMap *deleters);
 
+// A rewrite pass that folds arithmetic over constants, e.g. (+ 1 2 3) to 6,
+// short-circuits and/or on a constant argument and replaces an if on a
+// constant condition with the branch it takes.
+// Arithmetic mixing constants and other expressions is left as written, since
+// reordering floating-point operations could change the result.
+void init_constant_folding(SAMap *rewriters);
+
 double evaluate_lisp_expression(ExpressionTree *tree, FILE *file);
 
+// Compiles tree into bytecode, which must have been initialized. The result
+// can be executed any number of times with lisp_bytecode_execute().
+void compile_lisp_expression(SemanticAnalyzer *analyzer,
+                             const ExpressionTree *tree,
+                             LispBytecode *bytecode);
+
 #ifdef __cplusplus
 }
 #endif
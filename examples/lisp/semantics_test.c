@@ -0,0 +1,99 @@
+#include "examples/lisp/semantics.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "examples/lisp/lisp_lexer.h"
+#include "examples/lisp/lisp_parser.h"
+#include "file-utils/file_info.h"
+#include "language-tools/intern.h"
+#include "language-tools/parser/parser.h"
+#include "language-tools/semantic_analyzer/expression_tree.h"
+#include "language-tools/semantic_analyzer/semantic_analyzer.h"
+#include "language-tools/testing/check.h"
+
+// Writes a function of width arguments nested depth levels deep, so that
+// there are many subtrees to populate as tasks.
+static void write_expression_(FILE *out, int depth, int width, int *counter) {
+  static const char *FUNCTIONS[] = {"+", "-", "*", "/", "and", "or"};
+  if (0 == depth) {
+    fprintf(out, "%d", ++*counter % 10 + 1);
+    return;
+  }
+  fprintf(out, "(%s", FUNCTIONS[*counter % 6]);
+  for (int i = 0; i < width; ++i) {
+    fprintf(out, " ");
+    write_expression_(out, depth - 1, width, counter);
+  }
+  fprintf(out, ")");
+}
+
+static bool trees_equal_(ExpressionTree *a, ExpressionTree *b) {
+  if (a->type != b->type) {
+    return false;
+  }
+  if (IS_EXPRESSION(a, expression)) {
+    return EXTRACT_EXPRESSION(a, expression)->floating ==
+           EXTRACT_EXPRESSION(b, expression)->floating;
+  }
+  Expression_expression_function *fa =
+      EXTRACT_EXPRESSION(a, expression_function);
+  Expression_expression_function *fb =
+      EXTRACT_EXPRESSION(b, expression_function);
+  const int num_args = ExpressionTreeArray_size(&fa->args);
+  if (fa->func != fb->func || num_args != ExpressionTreeArray_size(&fb->args)) {
+    return false;
+  }
+  for (int i = 0; i < num_args; ++i) {
+    if (!trees_equal_(EXTRACT_TREE(&fa->args, i),
+                      EXTRACT_TREE(&fb->args, i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void test_parallel_matches_sequential_() {
+  char *text;
+  size_t size;
+  FILE *out = open_memstream(&text, &size);
+  int counter = 0;
+  write_expression_(out, /*depth=*/6, /*width=*/4, &counter);
+  fclose(out);
+
+  FileInfo *file = file_info_file(fmemopen(text, size, "r"));
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  lisp_lexer_tokenize(file, &tokens);
+  Parser parser;
+  parser_init(&parser, rule_expression);
+  const SyntaxTree *stree = parser_parse(&parser, &tokens);
+  CHECK(stree->matched);
+
+  SemanticAnalyzer analyzer;
+  semantic_analyzer_init(&analyzer, init_semantics);
+  ExpressionTree *sequential = semantic_analyzer_populate(&analyzer, stree);
+  CHECK(!semantic_analyzer_is_parallel_());
+  for (int num_threads = 1; num_threads <= 4; ++num_threads) {
+    // Every subtree is a task.
+    ExpressionTree *parallel = semantic_analyzer_populate_parallel(
+        &analyzer, stree, num_threads, /*min_task_nodes=*/1);
+    CHECK(trees_equal_(sequential, parallel));
+    semantic_analyzer_delete(&analyzer, parallel);
+  }
+  semantic_analyzer_delete(&analyzer, sequential);
+
+  semantic_analyzer_finalize(&analyzer);
+  parser_finalize(&parser);
+  TokenArray_finalize(&tokens);
+  file_info_delete(file);
+  free(text);
+}
+
+int main(int argc, const char *argv[]) {
+  global_string_intern_pool_init();
+  test_parallel_matches_sequential_();
+  global_string_intern_pool_finalize();
+  return 0;
+}
@@ -0,0 +1,61 @@
+#include "language-tools/allocator.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *malloc_(void *context, size_t size) { return malloc(size); }
+
+static void *realloc_(void *context, void *ptr, size_t old_size,
+                      size_t new_size) {
+  return realloc(ptr, new_size);
+}
+
+static void free_(void *context, void *ptr, size_t size) { free(ptr); }
+
+static const LtAllocator DEFAULT_ALLOCATOR_ = {malloc_, realloc_, free_, NULL};
+
+static LtAllocator allocator_ = {malloc_, realloc_, free_, NULL};
+
+void lt_allocator_set(const LtAllocator *allocator) {
+  allocator_ = NULL == allocator ? DEFAULT_ALLOCATOR_ : *allocator;
+}
+
+const LtAllocator *lt_allocator_get() { return &allocator_; }
+
+static void *check_(void *ptr, size_t size) {
+  if (NULL == ptr && size > 0) {
+    fprintf(stderr, "Failed to allocate %zu bytes.\n", size);
+    exit(1);
+  }
+  return ptr;
+}
+
+void *lt_malloc(size_t size) {
+  return check_(allocator_.malloc(allocator_.context, size), size);
+}
+
+void *lt_calloc(size_t num, size_t size) {
+  if (0 != size && num > SIZE_MAX / size) {
+    fprintf(stderr, "Failed to allocate %zu elements of %zu bytes.\n", num,
+            size);
+    exit(1);
+  }
+  void *ptr = lt_malloc(num * size);
+  memset(ptr, 0, num * size);
+  return ptr;
+}
+
+void *lt_realloc(void *ptr, size_t old_size, size_t new_size) {
+  return check_(
+      allocator_.realloc(allocator_.context, ptr, old_size, new_size),
+      new_size);
+}
+
+void lt_free(void *ptr, size_t size) {
+  if (NULL == ptr) {
+    return;
+  }
+  allocator_.free(allocator_.context, ptr, size);
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_ALLOCATOR_H_
+#define COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_ALLOCATOR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+// Allocates the memory of the lexer, parser, intern pool and semantic
+// analyzer, and of generated lexers. Every call is given the size of the
+// memory involved, so allocators need not track it themselves.
+typedef struct {
+  void *(*malloc)(void *context, size_t size);
+  // ptr holds old_size bytes, and is NULL if old_size is 0.
+  void *(*realloc)(void *context, void *ptr, size_t old_size,
+                   size_t new_size);
+  // ptr holds size bytes. Never called with NULL.
+  void (*free)(void *context, void *ptr, size_t size);
+  void *context;
+} LtAllocator;
+
+// Routes later allocations through a copy of allocator, or malloc if it is
+// NULL. Memory is returned to whichever allocator is set when it is freed, so
+// this must be called before anything is allocated, or once everything
+// allocated has been freed.
+void lt_allocator_set(const LtAllocator *allocator);
+const LtAllocator *lt_allocator_get();
+
+// These exit with an error if the memory cannot be allocated.
+void *lt_malloc(size_t size);
+// Also exits if num * size does not fit in a size_t.
+void *lt_calloc(size_t num, size_t size);
+void *lt_realloc(void *ptr, size_t old_size, size_t new_size);
+// Does nothing if ptr is NULL.
+void lt_free(void *ptr, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_ALLOCATOR_H_ */
\ No newline at end of file
@@ -1,9 +1,21 @@
 #include "language-tools/intern.h"
 
+#include "language-tools/allocator.h"
+#include "language-tools/memory_stats.h"
+
 IMPL_INTERN_POOL(GlobalStringInternPool, char);
 
 static GlobalStringInternPool global_intern_pool_;
 
+#ifdef LANGUAGE_TOOLS_MEMORY_STATS
+// Strings returned by the pool so far, so that each one's bytes are counted
+// toward LT_MEMORY_INTERN only when first interned. The pool does not report
+// whether it inserted a string, so this costs a second probe per call and is
+// only kept when memory stats are compiled in.
+static const char **interned_ = NULL;
+static size_t num_interned_ = 0, interned_capacity_ = 0, interned_bytes_ = 0;
+#endif
+
 // https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
 #define FNV_32_PRIME (0x01000193)
 #define FNV_1A_32_OFFSET (0x811C9DC5)
@@ -37,6 +49,51 @@ int32_t compare_strings_(const char *ptr1, uint32_t size1, const char *ptr2,
   return memcmp(ptr1, ptr2, size1 > size2 ? size1 : size2);
 }
 
+#ifdef LANGUAGE_TOOLS_MEMORY_STATS
+// Returns the slot holding interned, or the empty slot where it belongs.
+static size_t interned_index_(const char *interned) {
+  const uint64_t hash = (uint64_t)(uintptr_t)interned * 0x9E3779B97F4A7C15ull;
+  size_t i = (size_t)(hash >> 32) & (interned_capacity_ - 1);
+  while (NULL != interned_[i] && interned != interned_[i]) {
+    i = (i + 1) & (interned_capacity_ - 1);
+  }
+  return i;
+}
+
+static void grow_interned_() {
+  const char **old = interned_;
+  const size_t old_capacity = interned_capacity_;
+  interned_capacity_ = old_capacity > 0 ? 2 * old_capacity : 1024;
+  lt_memory_stats_resize(LT_MEMORY_INTERN, sizeof(char *) * old_capacity,
+                         sizeof(char *) * interned_capacity_);
+  interned_ = lt_calloc(interned_capacity_, sizeof(char *));
+  for (size_t i = 0; i < old_capacity; ++i) {
+    if (NULL != old[i]) {
+      interned_[interned_index_(old[i])] = old[i];
+    }
+  }
+  lt_free(old, sizeof(char *) * old_capacity);
+}
+
+static const char *count_interned_(const char *interned, size_t size) {
+  if (2 * (num_interned_ + 1) > interned_capacity_) {
+    grow_interned_();
+  }
+  const size_t i = interned_index_(interned);
+  if (NULL == interned_[i]) {
+    interned_[i] = interned;
+    ++num_interned_;
+    interned_bytes_ += size;
+    lt_memory_stats_alloc(LT_MEMORY_INTERN, size);
+  }
+  return interned;
+}
+#else
+static const char *count_interned_(const char *interned, size_t size) {
+  return interned;
+}
+#endif
+
 void global_string_intern_pool_init() {
   GlobalStringInternPool_init(&global_intern_pool_, /*threadsafe=*/false,
                               hash_string_, compare_strings_);
@@ -44,17 +101,27 @@ void global_string_intern_pool_init() {
 
 void global_string_intern_pool_finalize() {
   GlobalStringInternPool_finalize(&global_intern_pool_);
+#ifdef LANGUAGE_TOOLS_MEMORY_STATS
+  lt_memory_stats_free(LT_MEMORY_INTERN,
+                       interned_bytes_ + sizeof(char *) * interned_capacity_);
+  lt_free(interned_, sizeof(char *) * interned_capacity_);
+  interned_ = NULL;
+  num_interned_ = interned_capacity_ = interned_bytes_ = 0;
+#endif
 }
 
 const char *global_intern(const char text[]) {
-  return GlobalStringInternPool_intern(&global_intern_pool_, text,
-                                       strlen(text) + 1);
+  const size_t size = strlen(text) + 1;
+  return count_interned_(
+      GlobalStringInternPool_intern(&global_intern_pool_, text, size), size);
 }
 
 const char *global_intern_range(const char text[], int start, int len) {
-  char *cpy = strndup(text + start, len);
+  char *cpy = lt_malloc(len + 1);
+  memcpy(cpy, text + start, len);
+  cpy[len] = '\0';
   const char *interned =
       GlobalStringInternPool_intern(&global_intern_pool_, cpy, len + 1);
-  free(cpy);
-  return interned;
+  lt_free(cpy, len + 1);
+  return count_interned_(interned, len + 1);
 }
\ No newline at end of file
@@ -17,16 +17,33 @@ def _lexer_builder_impl(ctx):
         ctx.attr.fn_prefix,
         ctx.attr.enum_prefix,
     ])
+    inputs = [
+        ctx.file.symbols,
+        ctx.file.keywords,
+        ctx.file.comments,
+        ctx.file.strings,
+    ]
+    if ctx.attr.keep_newlines:
+        args.add("--keep_newlines")
+    elif ctx.file.rules:
+        args.add(ctx.file.rules, format = "--newlines_from=%s")
+        inputs.append(ctx.file.rules)
+    if ctx.attr.code_point_columns:
+        args.add("--code_point_columns")
+    if ctx.file.numbers:
+        args.add(ctx.file.numbers, format = "--numbers=%s")
+        inputs.append(ctx.file.numbers)
+    if ctx.file.patterns:
+        args.add(ctx.file.patterns, format = "--patterns=%s")
+        inputs.append(ctx.file.patterns)
+    if ctx.file.modes:
+        args.add(ctx.file.modes, format = "--modes=%s")
+        inputs.append(ctx.file.modes)
     ctx.actions.run(
         mnemonic = "LexerBuilder",
         executable = ctx.executable.lexer_builder_main,
         arguments = [args],
-        inputs = depset([
-            ctx.file.symbols,
-            ctx.file.keywords,
-            ctx.file.comments,
-            ctx.file.strings,
-        ]),
+        inputs = depset(inputs),
         outputs = [lexer_builder_output],
     )
     return [
@@ -66,6 +83,30 @@ _lexer_builder = rule(
             allow_single_file = True,
             doc = "strings txt file.",
         ),
+        "numbers": attr.label(
+            allow_single_file = True,
+            doc = "numbers txt file listing numeric literal forms: hex, octal or underscores.",
+        ),
+        "patterns": attr.label(
+            allow_single_file = True,
+            doc = "patterns txt file with lines of <token_name>,<regex>.",
+        ),
+        "modes": attr.label(
+            allow_single_file = True,
+            doc = "modes txt file with lines of <mode>,<token_name>,<action>,<regex>.",
+        ),
+        "code_point_columns": attr.bool(
+            default = False,
+            doc = "should count token columns in code points instead of bytes.",
+        ),
+        "rules": attr.label(
+            allow_single_file = True,
+            doc = "parser rules txt file. Newlines are only tokenized if it matches TOKEN_NEWLINE.",
+        ),
+        "keep_newlines": attr.bool(
+            default = False,
+            doc = "should always tokenize newlines.",
+        ),
         "lexer_builder_main": attr.label(
             default = Label("//language-tools/lexer:lexer_builder_main"),
             executable = True,
@@ -82,7 +123,13 @@ def lexer_builder(
         comments,
         strings,
         fn_prefix = None,
-        enum_prefix = None):
+        enum_prefix = None,
+        rules = None,
+        keep_newlines = False,
+        numbers = None,
+        code_point_columns = False,
+        patterns = None,
+        modes = None):
     _lexer_builder(
         name = "%s_h" % name,
         header = True,
@@ -92,6 +139,12 @@ def lexer_builder(
         strings = strings,
         fn_prefix = fn_prefix,
         enum_prefix = enum_prefix,
+        rules = rules,
+        keep_newlines = keep_newlines,
+        numbers = numbers,
+        code_point_columns = code_point_columns,
+        patterns = patterns,
+        modes = modes,
     )
     _lexer_builder(
         name = "%s_c" % name,
@@ -101,12 +154,19 @@ def lexer_builder(
         strings = strings,
         fn_prefix = fn_prefix,
         enum_prefix = enum_prefix,
+        rules = rules,
+        keep_newlines = keep_newlines,
+        numbers = numbers,
+        code_point_columns = code_point_columns,
+        patterns = patterns,
+        modes = modes,
     )
     return cc_library(
         name = name,
         hdrs = [":%s_h" % name],
         srcs = [":%s_c" % name],
         deps = [
+            Label("//language-tools:allocator"),
             Label("//language-tools/lexer:lexer_helper"),
             Label("//language-tools/lexer:token"),
             Label("@jeffmanzione_file_utils//file-utils:string_utils"),
@@ -1,65 +1,73 @@
 #include "language-tools/lexer/lexer_builder.h"
 
+#include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "file-utils/file_info.h"
 #include "file-utils/string_utils.h"
+#include "language-tools/allocator.h"
 #include "language-tools/intern.h"
 #include "language-tools/lexer/lexer_helper.h"
+#include "language-tools/lexer/pattern_compiler.h"
 
 IMPL_ARRAYLIKE(TokenDefArray, TokenDef_);
 IMPL_ARRAYLIKE(OpenCloseDefArray, OpenCloseDef_);
+IMPL_ARRAYLIKE(PatternDefArray, PatternDef_);
 
-Trie_ *trie_create_() {
-  Trie_ *trie = calloc(1, sizeof(Trie_));
-  return trie;
+int compare_token_defs_(const void *a, const void *b) {
+  const TokenDef_ *lhs = *(TokenDef_ *const *)a;
+  const TokenDef_ *rhs = *(TokenDef_ *const *)b;
+  const int cmp = strcmp(lhs->escaped_token, rhs->escaped_token);
+  if (0 != cmp) {
+    return cmp;
+  }
+  // Keep duplicates in file order so that the last definition wins.
+  return (lhs > rhs) - (lhs < rhs);
 }
 
-void trie_delete_(Trie_ *trie) {
+void trie_init_(Trie_ *trie, TokenDefArray *tokens) {
+  trie->num_tokens = TokenDefArray_size(tokens);
+  trie->tokens = malloc(sizeof(TokenDef_ *) * (trie->num_tokens + 1));
   int i;
-  for (i = 0; i < TRIE_MAX_CHAR_; ++i) {
-    Trie_ *child = trie->chars[i];
-    if (NULL != child) {
-      trie_delete_(child);
-    }
+  for (i = 0; i < trie->num_tokens; ++i) {
+    trie->tokens[i] = TokenDefArray_mutable_ref_unchecked(tokens, i);
   }
-  free(trie);
+  qsort(trie->tokens, trie->num_tokens, sizeof(TokenDef_ *),
+        compare_token_defs_);
 }
 
-bool has_child_trie_(Trie_ *trie) {
+void trie_finalize_(Trie_ *trie) { free(trie->tokens); }
+
+// Returns the token that ends at depth within the node tokens[begin, end), or
+// NULL if there is none. Sets *children to the start of the node's children.
+TokenDef_ *trie_node_(const Trie_ *trie, int begin, int end, int depth,
+                      int *children) {
+  TokenDef_ *has = NULL;
   int i;
-  for (i = 0; i < TRIE_MAX_CHAR_; ++i) {
-    Trie_ *child = trie->chars[i];
-    if (NULL != child) {
-      return true;
-    }
+  for (i = begin;
+       i < end && '\0' == trie->tokens[i]->escaped_token[depth]; ++i) {
+    has = trie->tokens[i];
   }
-  return false;
+  *children = i;
+  return has;
 }
 
-Trie_ *create_trie_from_symbols_(TokenDefArray *symbols) {
-  Trie_ *base = trie_create_();
-  TokenDefArrayIterator iter;
-  TokenDefArray_iterator(&iter, symbols);
-  for (; TokenDefArray_has_next(&iter); TokenDefArray_next(&iter)) {
-    TokenDef_ *token_def = TokenDefArray_mutable_value(&iter);
-    int i;
-    Trie_ *cur = base;
-    for (i = 0; i < strlen(token_def->escaped_token); ++i) {
-      if (NULL == cur->chars[(uint32_t)token_def->escaped_token[i]]) {
-        cur->chars[(uint32_t)token_def->escaped_token[i]] = trie_create_();
-      }
-      cur = cur->chars[(uint32_t)token_def->escaped_token[i]];
-    }
-    cur->has = token_def;
+// Returns the end of the child starting at tokens[begin].
+int trie_child_end_(const Trie_ *trie, int begin, int end, int depth) {
+  const char c = trie->tokens[begin]->escaped_token[depth];
+  int i;
+  for (i = begin + 1; i < end && c == trie->tokens[i]->escaped_token[depth];
+       ++i) {
   }
-  return base;
+  return i;
 }
 
 const char *escape_interned_(const char *str) {
   char *tmp = escape_string(str);
   const char *interned = global_intern(tmp);
-  free(tmp);
+  lt_free(tmp, strlen(tmp) + 1);
   return interned;
 }
 
@@ -106,14 +114,14 @@ void build_open_close_list_(FileInfo *file, OpenCloseDefArray *tokens) {
     def->open.token = open;
     def->open.escaped_token = escape_interned_(open);
     def->open.token_len = strlen(open);
-    free(token_unesc);
+    lt_free(token_unesc, strlen(token_unesc) + 1);
 
     token_unesc = strip_return_char(comma2, 1, strlen(comma2 + 1));
     const char *close = global_intern(token_unesc);
     def->close.token = close;
     def->close.escaped_token = escape_interned_(close);
     def->close.token_len = strlen(close);
-    free(token_unesc);
+    lt_free(token_unesc, strlen(token_unesc) + 1);
     def->open.token_name =
         string_copy_and_append_(li->line_text, comma1 - li->line_text, "_OPEN");
     def->close.token_name = string_copy_and_append_(
@@ -127,8 +135,179 @@ void lexer_builder_init(LexerBuilder *lb, FileInfo *symbols, FileInfo *keywords,
   build_token_list_(keywords, &lb->keywords);
   build_open_close_list_(comments, &lb->comments);
   build_open_close_list_(strings, &lb->strings);
-  lb->symbols_trie = create_trie_from_symbols_(&lb->symbols);
-  lb->keywords_trie = create_trie_from_symbols_(&lb->keywords);
+  trie_init_(&lb->symbols_trie, &lb->symbols);
+  trie_init_(&lb->keywords_trie, &lb->keywords);
+  PatternDefArray_init(&lb->patterns);
+  lb->keep_newlines = false;
+  lb->number_literals = 0;
+  lb->code_point_columns = false;
+}
+
+bool is_option_(const char option[], int option_len, const char name[]) {
+  return option_len == strlen(name) && 0 == strncmp(name, option, option_len);
+}
+
+void lexer_builder_set_number_literals(LexerBuilder *lb, FileInfo *numbers) {
+  LineInfo *li;
+  while (NULL != (li = file_info_getline(numbers))) {
+    const char *option = li->line_text;
+    int option_len = strlen(option);
+    while (option_len > 0 && is_any_space(option[option_len - 1])) {
+      --option_len;
+    }
+    if (0 == option_len) {
+      continue;
+    }
+    if (is_option_(option, option_len, "hex")) {
+      lb->number_literals |= NUMBER_LITERAL_HEX;
+    } else if (is_option_(option, option_len, "octal")) {
+      lb->number_literals |= NUMBER_LITERAL_OCTAL;
+    } else if (is_option_(option, option_len, "underscores")) {
+      lb->number_literals |= NUMBER_LITERAL_UNDERSCORES;
+    } else {
+      fprintf(stderr, "Unknown number literal option: '%.*s'\n", option_len,
+              option);
+      exit(1);
+    }
+  }
+}
+
+// Returns the length of line without its line ending.
+int line_len_(const char line[]) {
+  int line_len = strlen(line);
+  while (line_len > 0 &&
+         ('\n' == line[line_len - 1] || '\r' == line[line_len - 1])) {
+    --line_len;
+  }
+  return line_len;
+}
+
+void lexer_builder_set_patterns(LexerBuilder *lb, FileInfo *patterns) {
+  LineInfo *li;
+  while (NULL != (li = file_info_getline(patterns))) {
+    const char *line = li->line_text;
+    const int line_len = line_len_(line);
+    if (0 == line_len) {
+      continue;
+    }
+    const char *comma = memchr(line, ',', line_len);
+    if (NULL == comma || comma == line || comma + 1 == line + line_len) {
+      fprintf(stderr, "Expected <token_name>,<regex> on line %d: '%.*s'\n",
+              li->line_num, line_len, line);
+      exit(1);
+    }
+    PatternDef_ *def = PatternDefArray_push_back_ref(&lb->patterns);
+    def->token_name = global_intern_range(line, 0, comma - line);
+    def->regex = global_intern_range(line, comma - line + 1,
+                                     line + line_len - comma - 1);
+    def->mode = NULL;
+    def->action = PATTERN_STAY_;
+    def->push_mode = NULL;
+  }
+}
+
+// Returns the interned name of a mode, or NULL for the default mode.
+const char *mode_name_(const char name[], int name_len) {
+  return is_option_(name, name_len, "DEFAULT")
+             ? NULL
+             : global_intern_range(name, 0, name_len);
+}
+
+void lexer_builder_set_modes(LexerBuilder *lb, FileInfo *modes) {
+  LineInfo *li;
+  while (NULL != (li = file_info_getline(modes))) {
+    const char *line = li->line_text;
+    const int line_len = line_len_(line);
+    if (0 == line_len) {
+      continue;
+    }
+    // The regex comes last so that it may contain commas.
+    const char *fields[4] = {line};
+    int field_lens[4];
+    for (int i = 1; i < 4; ++i) {
+      const char *comma =
+          memchr(fields[i - 1], ',', line + line_len - fields[i - 1]);
+      if (NULL == comma) {
+        fields[0] = NULL;
+        break;
+      }
+      field_lens[i - 1] = comma - fields[i - 1];
+      fields[i] = comma + 1;
+    }
+    if (NULL != fields[0]) {
+      field_lens[3] = line + line_len - fields[3];
+    }
+    if (NULL == fields[0] || 0 == field_lens[0] || 0 == field_lens[1] ||
+        0 == field_lens[3]) {
+      fprintf(stderr,
+              "Expected <mode>,<token_name>,<action>,<regex> on line %d: "
+              "'%.*s'\n",
+              li->line_num, line_len, line);
+      exit(1);
+    }
+    PatternDef_ *def = PatternDefArray_push_back_ref(&lb->patterns);
+    def->mode = mode_name_(fields[0], field_lens[0]);
+    def->token_name = global_intern_range(fields[1], 0, field_lens[1]);
+    def->regex = global_intern_range(fields[3], 0, field_lens[3]);
+    def->push_mode = NULL;
+    const char *action = fields[2];
+    const int action_len = field_lens[2];
+    if (0 == action_len) {
+      def->action = PATTERN_STAY_;
+    } else if (is_option_(action, action_len, "pop")) {
+      def->action = PATTERN_POP_;
+    } else if (action_len > strlen("push:") &&
+               0 == strncmp("push:", action, strlen("push:"))) {
+      def->action = PATTERN_PUSH_;
+      def->push_mode = mode_name_(action + strlen("push:"),
+                                  action_len - strlen("push:"));
+    } else {
+      fprintf(stderr, "Unknown lexer mode action on line %d: '%.*s'\n",
+              li->line_num, action_len, action);
+      exit(1);
+    }
+  }
+}
+
+static bool is_identifier_char_(char c) {
+  return isalnum((unsigned char)c) || '_' == c;
+}
+
+void lexer_builder_newlines_from_rules(LexerBuilder *lb, FileInfo *rules) {
+  const int newline_len = strlen("TOKEN_NEWLINE");
+  bool in_comment = false;
+  LineInfo *li;
+  while (NULL != (li = file_info_getline(rules))) {
+    const char *line = li->line_text;
+    const char *text = line;
+    while ('\0' != *text) {
+      if (in_comment) {
+        const char *end = strstr(text, "*/");
+        if (NULL == end) {
+          break;
+        }
+        in_comment = false;
+        text = end + 2;
+        continue;
+      }
+      if (0 == strncmp("//", text, 2)) {
+        break;
+      }
+      if (0 == strncmp("/*", text, 2)) {
+        in_comment = true;
+        text += 2;
+        continue;
+      }
+      // Only the whole identifier, not e.g. TOKEN_NEWLINES.
+      if (0 == strncmp("TOKEN_NEWLINE", text, newline_len) &&
+          (text == line || !is_identifier_char_(text[-1])) &&
+          !is_identifier_char_(text[newline_len])) {
+        lb->keep_newlines = true;
+        return;
+      }
+      ++text;
+    }
+  }
 }
 
 void write_source_includes_(LexerBuilder *lb, FILE *file,
@@ -136,11 +315,50 @@ void write_source_includes_(LexerBuilder *lb, FILE *file,
   // Includes.
   fprintf(file,
           "#include \"%s\"\n\n"
+          "#include \"language-tools/allocator.h\"\n"
           "#include \"language-tools/lexer/lexer_helper.h\"\n"
+          "#include \"language-tools/lexer/unicode.h\"\n"
           "#include \"file-utils/string_utils.h\"\n\n",
           h_file_path);
 }
 
+bool token_defs_name_(TokenDefArray *defs, const char token_name[]) {
+  for (int i = 0; i < TokenDefArray_size(defs); ++i) {
+    // Names are interned.
+    if (TokenDefArray_get_unchecked(defs, i).token_name == token_name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Whether the pattern at index names a token type not declared before it, so
+// that patterns can also produce builtin, symbol and keyword types.
+bool pattern_declares_type_(LexerBuilder *lb, int index) {
+  const char *token_name =
+      PatternDefArray_get_unchecked(&lb->patterns, index).token_name;
+  if (0 == strcmp("TOKEN_NEWLINE", token_name) ||
+      0 == strcmp("TOKEN_WORD", token_name) ||
+      0 == strcmp("TOKEN_INTEGER", token_name) ||
+      0 == strcmp("TOKEN_FLOATING", token_name)) {
+    return false;
+  }
+  for (int i = 0; i < OpenCloseDefArray_size(&lb->strings); ++i) {
+    if (OpenCloseDefArray_get_unchecked(&lb->strings, i).token_name ==
+        token_name) {
+      return false;
+    }
+  }
+  for (int i = 0; i < index; ++i) {
+    if (PatternDefArray_get_unchecked(&lb->patterns, i).token_name ==
+        token_name) {
+      return false;
+    }
+  }
+  return !token_defs_name_(&lb->symbols, token_name) &&
+         !token_defs_name_(&lb->keywords, token_name);
+}
+
 void write_token_type_enum_(LexerBuilder *lb, FILE *file,
                             const char enum_prefix[]) {
   fprintf(file,
@@ -168,6 +386,12 @@ void write_token_type_enum_(LexerBuilder *lb, FILE *file,
     TokenDef_ *token_def = TokenDefArray_mutable_value(&td_iter);
     fprintf(file, "  %s,\n", token_def->token_name);
   }
+  for (int i = 0; i < PatternDefArray_size(&lb->patterns); ++i) {
+    if (pattern_declares_type_(lb, i)) {
+      fprintf(file, "  %s,\n",
+              PatternDefArray_get_unchecked(&lb->patterns, i).token_name);
+    }
+  }
   fprintf(file, "  TOKEN_NOP\n");
   fprintf(file, "} %sLexType;\n\n", enum_prefix);
 }
@@ -204,6 +428,13 @@ void write_token_type_to_str_(LexerBuilder *lb, FILE *file,
     fprintf(file, "    case %s: return \"%s\";\n", token_def->token_name,
             token_def->escaped_token);
   }
+  for (int i = 0; i < PatternDefArray_size(&lb->patterns); ++i) {
+    if (pattern_declares_type_(lb, i)) {
+      const char *token_name =
+          PatternDefArray_get_unchecked(&lb->patterns, i).token_name;
+      fprintf(file, "    case %s: return \"%s\";\n", token_name, token_name);
+    }
+  }
   fprintf(file, "    default: return \"UNKNOWN\";\n  }\n}\n\n");
 }
 
@@ -239,6 +470,14 @@ void write_token_name_to_token_type_(LexerBuilder *lb, FILE *file,
     fprintf(file, "  if (0 == strcmp(\"%s\", str)) return %s;\n",
             token_def->token_name, token_def->token_name);
   }
+  for (int i = 0; i < PatternDefArray_size(&lb->patterns); ++i) {
+    if (pattern_declares_type_(lb, i)) {
+      const char *token_name =
+          PatternDefArray_get_unchecked(&lb->patterns, i).token_name;
+      fprintf(file, "  if (0 == strcmp(\"%s\", str)) return %s;\n",
+              token_name, token_name);
+    }
+  }
   fprintf(file, "    return 0;\n}\n\n");
 }
 
@@ -274,50 +513,62 @@ void write_token_type_to_name_(LexerBuilder *lb, FILE *file,
     fprintf(file, "    case %s: return \"%s\";\n", token_def->token_name,
             token_def->token_name);
   }
+  for (int i = 0; i < PatternDefArray_size(&lb->patterns); ++i) {
+    if (pattern_declares_type_(lb, i)) {
+      const char *token_name =
+          PatternDefArray_get_unchecked(&lb->patterns, i).token_name;
+      fprintf(file, "    case %s: return \"%s\";\n", token_name, token_name);
+    }
+  }
   fprintf(file, "    default: return \"UNKNOWN\";\n  }\n}\n\n");
 }
 
-void write_switch_for_symbol_resolve_(Trie_ *trie, int index, FILE *file) {
-  int i;
-  const bool has_children = has_child_trie_(trie);
-  if (has_children) {
-    fprintf(file, "%*sswitch (word[%d]) {\n", index * 2, "", index - 1);
-    for (i = 0; i < TRIE_MAX_CHAR_; ++i) {
-      Trie_ *child = trie->chars[i];
-      if (NULL == child) {
-        continue;
-      }
-      if (((char)i) == '\\') {
-        fprintf(file, "%*scase '\\\\':\n", index * 2, "");
-      } else {
-        fprintf(file, "%*scase '%c':\n", index * 2, "", (char)i);
-      }
-      write_switch_for_symbol_resolve_(child, index + 1, file);
+void write_case_(char c, int index, FILE *file) {
+  if ('\\' == c) {
+    fprintf(file, "%*scase '\\\\':\n", index * 2, "");
+  } else if (0 != (c & 0x80)) {
+    fprintf(file, "%*scase '\\x%02x':\n", index * 2, "", (unsigned char)c);
+  } else {
+    fprintf(file, "%*scase '%c':\n", index * 2, "", c);
+  }
+}
+
+void write_switch_for_symbol_resolve_(const Trie_ *trie, int begin, int end,
+                                      int index, FILE *file) {
+  const int depth = index - 1;
+  int child, child_end;
+  const TokenDef_ *has = trie_node_(trie, begin, end, depth, &child);
+  if (child < end) {
+    fprintf(file, "%*sswitch (word[%d]) {\n", index * 2, "", depth);
+    for (; child < end; child = child_end) {
+      child_end = trie_child_end_(trie, child, end, depth);
+      write_case_(trie->tokens[child]->escaped_token[depth], index, file);
+      write_switch_for_symbol_resolve_(trie, child, child_end, index + 1, file);
     }
     fprintf(file, "%*sdefault: break;\n", index * 2, "");
     fprintf(file, "%*s}\n", index * 2, "");
   }
-  if (trie->has) {
-    fprintf(file, "%*sreturn %s;\n", index * 2, "", trie->has->token_name);
+  if (has) {
+    fprintf(file, "%*sreturn %s;\n", index * 2, "", has->token_name);
   }
 }
 
-void write_switch_for_keyword_resolve_(Trie_ *trie, int index, FILE *file) {
-  int i;
-  const bool has_children = has_child_trie_(trie);
-  if (trie->has) {
+void write_switch_for_keyword_resolve_(const Trie_ *trie, int begin, int end,
+                                       int index, FILE *file) {
+  const int depth = index - 1;
+  int child, child_end;
+  const TokenDef_ *has = trie_node_(trie, begin, end, depth, &child);
+  if (has) {
     fprintf(file, "%*sif (word_len == %d) { return %s; }\n", index * 2, "",
-            index - 1, trie->has->token_name);
+            depth, has->token_name);
   }
-  if (has_children) {
-    fprintf(file, "%*sswitch (word[%d]) {\n", index * 2, "", index - 1);
-    for (i = 0; i < TRIE_MAX_CHAR_; ++i) {
-      Trie_ *child = trie->chars[i];
-      if (NULL == child) {
-        continue;
-      }
-      fprintf(file, "%*scase '%c':\n", index * 2, "", (char)i);
-      write_switch_for_keyword_resolve_(child, index + 1, file);
+  if (child < end) {
+    fprintf(file, "%*sswitch (word[%d]) {\n", index * 2, "", depth);
+    for (; child < end; child = child_end) {
+      child_end = trie_child_end_(trie, child, end, depth);
+      write_case_(trie->tokens[child]->escaped_token[depth], index, file);
+      write_switch_for_keyword_resolve_(trie, child, child_end, index + 1,
+                                        file);
     }
     fprintf(file, "%*sdefault: return TOKENTYPE_UNKNOWN;\n", index * 2, "");
     fprintf(file, "%*s}\n", index * 2, "");
@@ -329,13 +580,15 @@ void write_resolve_type_(LexerBuilder *lb, FILE *file, const char fn_prefix[],
                          const char enum_prefix[]) {
   fprintf(file, "%sLexType %ssymbol_token_type(const char word[]) {\n",
           enum_prefix, fn_prefix);
-  write_switch_for_symbol_resolve_(lb->symbols_trie, 1, file);
+  write_switch_for_symbol_resolve_(&lb->symbols_trie, 0,
+                                   lb->symbols_trie.num_tokens, 1, file);
   fprintf(file, "  return TOKENTYPE_UNKNOWN;\n}\n\n");
 
   fprintf(file, "%sLexType keyword_type_(const char word[], int word_len) {\n",
           enum_prefix);
   fprintf(file, "  if (word_len <= 0) { return TOKEN_NEWLINE; }\n");
-  write_switch_for_keyword_resolve_(lb->keywords_trie, 1, file);
+  write_switch_for_keyword_resolve_(&lb->keywords_trie, 0,
+                                    lb->keywords_trie.num_tokens, 1, file);
   fprintf(file, "}\n\n");
 
   fprintf(file, "%sLexType %sresolve_type(const char word[], int word_len) {\n",
@@ -357,18 +610,13 @@ void write_resolve_type_(LexerBuilder *lb, FILE *file, const char fn_prefix[],
 void write_is_start_of_symbol_(LexerBuilder *lb, FILE *file,
                                const char fn_prefix[]) {
   fprintf(file, "bool %sis_start_of_symbol(const char word[]) {\n", fn_prefix);
-  int i;
+  const Trie_ *trie = &lb->symbols_trie;
+  int child, child_end;
+  trie_node_(trie, 0, trie->num_tokens, 0, &child);
   fprintf(file, "  switch (word[0]) {\n");
-  for (i = 0; i < TRIE_MAX_CHAR_; ++i) {
-    Trie_ *child = lb->symbols_trie->chars[i];
-    if (NULL == child) {
-      continue;
-    }
-    if (((char)i) == '\\') {
-      fprintf(file, "    case '\\\\':\n");
-    } else {
-      fprintf(file, "    case '%c':\n", (char)i);
-    }
+  for (; child < trie->num_tokens; child = child_end) {
+    child_end = trie_child_end_(trie, child, trie->num_tokens, 0);
+    write_case_(trie->tokens[child]->escaped_token[0], 2, file);
   }
   fprintf(file,
           "      return true;\n"
@@ -395,6 +643,45 @@ void write_token_type_is_string_(LexerBuilder *lb, FILE *file,
           "  }\n}\n\n");
 }
 
+// Returns the name of the symbol with text, which must not need escaping, or
+// NULL if there is none.
+const char *symbol_token_name_(LexerBuilder *lb, const char text[]) {
+  for (int i = 0; i < TokenDefArray_size(&lb->symbols); ++i) {
+    const TokenDef_ def = TokenDefArray_get_unchecked(&lb->symbols, i);
+    if (0 == strcmp(text, def.escaped_token)) {
+      return def.token_name;
+    }
+  }
+  return NULL;
+}
+
+// Brackets are only item boundaries when the grammar has both halves.
+void write_token_type_boundary_(LexerBuilder *lb, FILE *file,
+                                const char fn_prefix[]) {
+  static const char *BRACKET_PAIRS[][2] = {{"(", ")"}, {"[", "]"}, {"{", "}"}};
+  fprintf(file, "TokenBoundary %stoken_type_boundary(int token_type) {\n",
+          fn_prefix);
+  fprintf(file, "  switch (token_type) {\n");
+  for (int i = 0; i < sizeof(BRACKET_PAIRS) / sizeof(BRACKET_PAIRS[0]); ++i) {
+    const char *open = symbol_token_name_(lb, BRACKET_PAIRS[i][0]);
+    const char *close = symbol_token_name_(lb, BRACKET_PAIRS[i][1]);
+    if (NULL == open || NULL == close) {
+      continue;
+    }
+    fprintf(file,
+            "    case %s: return TOKEN_BOUNDARY_OPEN;\n"
+            "    case %s: return TOKEN_BOUNDARY_CLOSE;\n",
+            open, close);
+  }
+  const char *end = symbol_token_name_(lb, ";");
+  if (NULL != end) {
+    fprintf(file, "    case %s: return TOKEN_BOUNDARY_END;\n", end);
+  }
+  fprintf(file,
+          "    default: return TOKEN_BOUNDARY_NONE;\n"
+          "  }\n}\n\n");
+}
+
 void write_is_start_comment_(LexerBuilder *lb, FILE *file,
                              const char fn_prefix[]) {
   fprintf(file,
@@ -435,35 +722,265 @@ void write_is_start_string_(LexerBuilder *lb, FILE *file,
   fprintf(file, "  return false;\n}\n\n");
 }
 
+// Returns the index of mode in modes, adding it if it is new.
+int mode_index_(const char *modes[], int *num_modes, const char *mode) {
+  for (int i = 0; i < *num_modes; ++i) {
+    if (modes[i] == mode) {
+      return i;
+    }
+  }
+  modes[*num_modes] = mode;
+  return (*num_modes)++;
+}
+
+// Writes the automaton of every lexer mode and match_pattern_(), which returns
+// the length of the longest match of a mode's patterns at the start of text
+// and sets *rule to the pattern matched, or returns 0 if none match.
+void write_pattern_automata_(LexerBuilder *lb, FILE *file) {
+  const int num_patterns = PatternDefArray_size(&lb->patterns);
+  // The default mode is always mode 0.
+  const char **modes = malloc(sizeof(char *) * (num_patterns + 1));
+  int num_modes = 0;
+  mode_index_(modes, &num_modes, NULL);
+  for (int i = 0; i < num_patterns; ++i) {
+    mode_index_(modes, &num_modes,
+                PatternDefArray_get_unchecked(&lb->patterns, i).mode);
+  }
+  fprintf(file,
+          "#define MODE_STAY_ -1\n"
+          "#define MODE_POP_ -2\n\n"
+          "typedef struct {\n"
+          "  int type;\n"
+          "  // MODE_STAY_, MODE_POP_ or the mode pushed.\n"
+          "  int next_mode;\n"
+          "} PatternRule_;\n\n");
+  fprintf(file, "static const char *const MODE_NAMES_[%d] = {", num_modes);
+  for (int m = 0; m < num_modes; ++m) {
+    fprintf(file, "%s\"%s\"", 0 == m ? "" : ", ",
+            NULL == modes[m] ? "DEFAULT" : modes[m]);
+  }
+  fprintf(file, "};\n\n");
+  if (0 == num_patterns) {
+    fprintf(file,
+            "static int match_pattern_(int mode, const char text[],\n"
+            "                          const PatternRule_ **rule) {\n"
+            "  return 0;\n"
+            "}\n\n");
+    free(modes);
+    return;
+  }
+
+  fprintf(file, "static const PatternRule_ PATTERN_RULES_[%d] = {\n",
+          num_patterns);
+  for (int i = 0; i < num_patterns; ++i) {
+    const PatternDef_ def = PatternDefArray_get_unchecked(&lb->patterns, i);
+    if (PATTERN_PUSH_ == def.action) {
+      const int num_known = num_modes;
+      const int next_mode = mode_index_(modes, &num_modes, def.push_mode);
+      if (next_mode == num_known) {
+        fprintf(stderr, "Unknown lexer mode %s entered by %s.\n",
+                def.push_mode, def.token_name);
+        exit(1);
+      }
+      fprintf(file, "    {%s, %d},\n", def.token_name, next_mode);
+    } else {
+      fprintf(file, "    {%s, %s},\n", def.token_name,
+              PATTERN_POP_ == def.action ? "MODE_POP_" : "MODE_STAY_");
+    }
+  }
+  fprintf(file, "};\n\n");
+
+  const char **patterns = malloc(sizeof(char *) * num_patterns);
+  const char **names = malloc(sizeof(char *) * num_patterns);
+  int *rules = malloc(sizeof(int) * num_patterns);
+  int *num_classes = calloc(num_modes, sizeof(int));
+  for (int m = 0; m < num_modes; ++m) {
+    int num_rules = 0;
+    for (int i = 0; i < num_patterns; ++i) {
+      const PatternDef_ def = PatternDefArray_get_unchecked(&lb->patterns, i);
+      if (def.mode == modes[m]) {
+        patterns[num_rules] = def.regex;
+        names[num_rules] = def.token_name;
+        rules[num_rules++] = i;
+      }
+    }
+    if (0 == num_rules) {
+      continue;
+    }
+    PatternDfa dfa;
+    pattern_dfa_compile(&dfa, patterns, names, num_rules);
+    num_classes[m] = dfa.num_classes;
+    fprintf(file, "static const uint8_t PATTERN_BYTE_CLASSES_%d_[256] = {", m);
+    for (int c = 0; c < 256; ++c) {
+      fprintf(file, "%s%d,", 0 == c % 16 ? "\n    " : " ",
+              dfa.byte_classes[c]);
+    }
+    fprintf(file, "\n};\n\n");
+    fprintf(file, "static const uint16_t PATTERN_TRANSITIONS_%d_[%d] = {\n",
+            m, dfa.num_states * dfa.num_classes);
+    for (int d = 0; d < dfa.num_states; ++d) {
+      fprintf(file, "   ");
+      for (int c = 0; c < dfa.num_classes; ++c) {
+        fprintf(file, " %d,", dfa.transitions[d * dfa.num_classes + c]);
+      }
+      fprintf(file, "\n");
+    }
+    fprintf(file, "};\n\n");
+    fprintf(file, "static const int PATTERN_ACCEPTS_%d_[%d] = {", m,
+            dfa.num_states);
+    for (int d = 0; d < dfa.num_states; ++d) {
+      fprintf(file, "%s%d,", 0 == d % 16 ? "\n    " : " ",
+              dfa.accepts[d] < 0 ? -1 : rules[dfa.accepts[d]]);
+    }
+    fprintf(file, "\n};\n\n");
+    pattern_dfa_finalize(&dfa);
+  }
+
+  fprintf(file,
+          "// A DFA over byte classes. State 0 is dead and state 1 is the "
+          "start.\n"
+          "typedef struct {\n"
+          "  const uint8_t *byte_classes;\n"
+          "  const uint16_t *transitions;\n"
+          "  int num_classes;\n"
+          "  // Index in PATTERN_RULES_ of the pattern accepted by each state, "
+          "or -1.\n"
+          "  const int *accepts;\n"
+          "} PatternAutomaton_;\n\n");
+  fprintf(file, "static const PatternAutomaton_ PATTERN_AUTOMATA_[%d] = {\n",
+          num_modes);
+  for (int m = 0; m < num_modes; ++m) {
+    if (0 == num_classes[m]) {
+      fprintf(file, "    {NULL, NULL, 0, NULL},\n");
+    } else {
+      fprintf(file,
+              "    {PATTERN_BYTE_CLASSES_%d_, PATTERN_TRANSITIONS_%d_, %d, "
+              "PATTERN_ACCEPTS_%d_},\n",
+              m, m, num_classes[m], m);
+    }
+  }
+  fprintf(file, "};\n\n");
+  fprintf(file,
+          "static int match_pattern_(int mode, const char text[],\n"
+          "                          const PatternRule_ **rule) {\n"
+          "  const PatternAutomaton_ *automaton = &PATTERN_AUTOMATA_[mode];\n"
+          "  if (NULL == automaton->transitions) {\n"
+          "    return 0;\n"
+          "  }\n"
+          "  int state = 1, len = 0, match_len = 0;\n"
+          "  while (0 != state) {\n"
+          "    if (automaton->accepts[state] >= 0) {\n"
+          "      match_len = len;\n"
+          "      *rule = &PATTERN_RULES_[automaton->accepts[state]];\n"
+          "    }\n"
+          "    // Every pattern rejects '\\0', so this stops at the end.\n"
+          "    state = automaton->transitions[\n"
+          "        state * automaton->num_classes +\n"
+          "        automaton->byte_classes[(uint8_t)text[len++]]];\n"
+          "  }\n"
+          "  return match_len;\n"
+          "}\n\n");
+
+  free(modes);
+  free(patterns);
+  free(names);
+  free(rules);
+  free(num_classes);
+}
+
 const char TOKENIZE_FUNCTIONS_TEXT_[] =
     "\n\
-int tokenize_number_(const LineInfo *li, TokenArray *tokens, int col_num) {\n\
+// Converts the byte columns of a line to the columns reported on its tokens.\n\
+typedef struct {\n\
+  const char *line;\n\
+  // Whether columns are the same as byte columns, as they are for lines with\n\
+  // only ASCII characters.\n\
+  bool in_bytes;\n\
+  // Tokens are created left to right, so counting continues from the last\n\
+  // column converted.\n\
+  int byte_col, code_point_col;\n\
+} Columns_;\n\
+\n\
+static int column_(Columns_ *columns, int byte_col) {\n\
+  if (columns->in_bytes) {\n\
+    return byte_col;\n\
+  }\n\
+  if (byte_col < columns->byte_col) {\n\
+    columns->byte_col = columns->code_point_col = 0;\n\
+  }\n\
+  columns->code_point_col += utf8_count_code_points(\n\
+      columns->line + columns->byte_col, byte_col - columns->byte_col);\n\
+  columns->byte_col = byte_col;\n\
+  return columns->code_point_col;\n\
+}\n\
+\n\
+int tokenize_number_(const LineInfo *li, TokenArray *tokens, TokenArena *arena,\n\
+                Columns_ *columns, int col_num) {\n\
   char *line = li->line_text;\n\
-  int start = col_num;\n\
-  bool is_decimal = false;\n\
-  while (is_number(line[col_num])) {\n\
-    if ('.' == line[col_num]) {\n\
-      // Decimals cannot have more than 1 decimal point.\n\
-      if (is_decimal) {\n\
-        break;\n\
-      } else {\n\
-        is_decimal = true;\n\
-      }\n\
+  bool is_decimal;\n\
+  int64_t integer;\n\
+  double floating;\n\
+  const int len = scan_number(line + col_num, NUMBER_LITERALS_, &is_decimal,\n\
+                              &integer, &floating);\n\
+  if (len < 0) {\n\
+    fprintf(stderr, \"INTEGER OUT OF RANGE at line %%d, col %%d\\n\",\n\
+            li->line_num, col_num);\n\
+    exit(1);\n\
+  }\n\
+  Token *token =\n\
+      token_arena_create(arena, is_decimal ? TOKEN_FLOATING : TOKEN_INTEGER, li->line_num,\n\
+                   column_(columns, col_num), line + col_num, len);\n\
+  if (is_decimal) {\n\
+    token->value.floating = floating;\n\
+  } else {\n\
+    token->value.integer = integer;\n\
+  }\n\
+  *TokenArray_push_back_ref(tokens) = token;\n\
+  return col_num + len;\n\
+}\n\
+\n\
+// The lexer modes entered and not yet left, innermost last. The default mode\n\
+// is below them all and is never left.\n\
+typedef struct {\n\
+  int *modes;\n\
+  int depth, capacity;\n\
+} ModeStack_;\n\
+\n\
+static int current_mode_(const ModeStack_ *stack) {\n\
+  return 0 == stack->depth ? 0 : stack->modes[stack->depth - 1];\n\
+}\n\
+\n\
+static void mode_stack_enter_(ModeStack_ *stack, int next_mode) {\n\
+  if (MODE_STAY_ == next_mode) {\n\
+    return;\n\
+  }\n\
+  if (MODE_POP_ == next_mode) {\n\
+    if (stack->depth > 0) {\n\
+      --stack->depth;\n\
     }\n\
-    ++col_num;\n\
+    return;\n\
   }\n\
-  if ('f' == line[col_num]) {\n\
-    is_decimal = true;\n\
-    ++col_num;\n\
+  if (stack->depth == stack->capacity) {\n\
+    const int old_capacity = stack->capacity;\n\
+    stack->capacity = old_capacity > 0 ? 2 * old_capacity : 8;\n\
+    stack->modes = lt_realloc(stack->modes, sizeof(int) * old_capacity,\n\
+                              sizeof(int) * stack->capacity);\n\
   }\n\
+  stack->modes[stack->depth++] = next_mode;\n\
+}\n\
+\n\
+int tokenize_pattern_(const LineInfo *li, TokenArray *tokens, TokenArena *arena,\n\
+                Columns_ *columns, int col_num, const PatternRule_ *rule, int len,\n\
+                ModeStack_ *modes) {\n\
   Token *token =\n\
-      token_create(is_decimal ? TOKEN_FLOATING : TOKEN_INTEGER, li->line_num,\n\
-                   start, line + start, col_num - start);\n\
+      token_arena_create(arena, rule->type, li->line_num, column_(columns, col_num), li->line_text + col_num, len);\n\
   *TokenArray_push_back_ref(tokens) = token;\n\
-  return col_num;\n\
+  mode_stack_enter_(modes, rule->next_mode);\n\
+  return col_num + len;\n\
 }\n\
 \n\
-int tokenize_symbol_(const LineInfo *li, TokenArray *tokens, int col_num) {\n\
+int tokenize_symbol_(const LineInfo *li, TokenArray *tokens, TokenArena *arena,\n\
+                Columns_ *columns, int col_num) {\n\
   char *line = li->line_text;\n\
   %sLexType type = %ssymbol_token_type(line + col_num);\n\
   if (TOKENTYPE_UNKNOWN == type) {\n\
@@ -472,43 +989,68 @@ int tokenize_symbol_(const LineInfo *li, TokenArray *tokens, int col_num) {\n\
   }\n\
   const int token_length = strlen(%stoken_type_to_str(type));\n\
   Token *token =\n\
-      token_create(type, li->line_num, col_num, line + col_num, token_length);\n\
+      token_arena_create(arena, type, li->line_num, column_(columns, col_num), line + col_num, token_length);\n\
   *TokenArray_push_back_ref(tokens) = token;\n\
   col_num += token_length;\n\
   return col_num;\n\
 }\n\
 \n\
-int tokenize_word_(const LineInfo *li, TokenArray *tokens, int col_num) {\n\
+int tokenize_word_(const LineInfo *li, TokenArray *tokens, TokenArena *arena,\n\
+                Columns_ *columns, int col_num) {\n\
   char *line = li->line_text;\n\
-  int start = col_num++;\n\
-  while (is_alphanumeric(line[col_num])) {\n\
-    ++col_num;\n\
-  }\n\
+  int start = col_num;\n\
+  col_num += identifier_length(line + col_num);\n\
   %sLexType token_type = keyword_type_(line + start, col_num - start);\n\
-  Token *token = token_create(\n\
+  Token *token = token_arena_create(arena, \n\
       token_type == TOKENTYPE_UNKNOWN ? TOKEN_WORD : token_type,\n\
       li->line_num,\n\
-      start,\n\
+      column_(columns, start),\n\
       line + start,\n\
       col_num - start);\n\
   *TokenArray_push_back_ref(tokens) = token;\n\
   return col_num;\n\
 }\n\
 \n\
-int tokenize_newline_(const LineInfo *li, TokenArray *tokens, int col_num) {\n\
+int tokenize_newline_(const LineInfo *li, TokenArray *tokens, TokenArena *arena,\n\
+                Columns_ *columns, int col_num) {\n\
+  if (!KEEP_NEWLINES_) {\n\
+    return col_num + 1;\n\
+  }\n\
   char *line = li->line_text;\n\
   Token *last = TokenArray_is_empty(tokens) ? NULL : TokenArray_get_unchecked(tokens, TokenArray_size(tokens) - 1);\n\
   if (NULL == last || last->type != TOKEN_NEWLINE) {\n\
     Token *token =\n\
-        token_create(TOKEN_NEWLINE, li->line_num, col_num, line + col_num, 1);\n\
+        token_arena_create(arena, TOKEN_NEWLINE, li->line_num, column_(columns, col_num), line + col_num, 1);\n\
     *TokenArray_push_back_ref(tokens) = token;\n\
   }\n\
   ++col_num;\n\
   return col_num;\n\
 }\n\
 \n\
+// Holds the text of a string that spans lines. It grows by doubling and is\n\
+// reused for every such string, so accumulating one is linear in its length.\n\
+typedef struct {\n\
+  char *text;\n\
+  int len, capacity;\n\
+} StringBuffer_;\n\
+\n\
+static void string_buffer_append_(StringBuffer_ *buffer, const char text[], int len) {\n\
+  if (buffer->len + len + 1 > buffer->capacity) {\n\
+    const int old_capacity = buffer->capacity;\n\
+    buffer->capacity = 2 * old_capacity > buffer->len + len + 1\n\
+                           ? 2 * old_capacity\n\
+                           : buffer->len + len + 1;\n\
+    buffer->text = lt_realloc(buffer->text, sizeof(char) * old_capacity,\n\
+                              sizeof(char) * buffer->capacity);\n\
+  }\n\
+  memcpy(buffer->text + buffer->len, text, len);\n\
+  buffer->len += len;\n\
+  buffer->text[buffer->len] = '\\0';\n\
+}\n\
+\n\
 bool lexer_tokenize_line_(FileInfo *fi, TokenArray *tokens, bool *in_comment, bool *in_string,\n\
-                          char **comment_end, char **string_end, %sLexType *string_type, char **string_buffer) {\n\
+                          char **comment_end, char **string_end, %sLexType *string_type, StringBuffer_ *string_buffer,\n\
+                          ModeStack_ *modes, TokenArena *arena) {\n\
   LineInfo *li = file_info_getline(fi);\n\
   if (NULL == li) {\n\
     return false;\n\
@@ -516,16 +1058,36 @@ bool lexer_tokenize_line_(FileInfo *fi, TokenArray *tokens, bool *in_comment, bo
   int col_num = 0;\n\
   int string_start_col = 0;\n\
   char *line = li->line_text;\n\
+  const int line_len = strlen(line);\n\
+  token_arena_start_line(arena, li->line_num, line_len);\n\
+  Columns_ columns = {line, !CODE_POINT_COLUMNS_ || is_ascii(line, line_len), 0, 0};\n\
   while (true) {\n\
     if ('\\0' == line[col_num]) {\n\
       break;\n\
     }\n\
+    // Modes other than the default match only their own patterns, and keep\n\
+    // whitespace.\n\
+    const int mode = current_mode_(modes);\n\
+    const PatternRule_ *pattern_rule;\n\
+    int pattern_len;\n\
+    if (0 != mode) {\n\
+      if ((pattern_len = match_pattern_(mode, line + col_num, &pattern_rule)) > 0) {\n\
+        col_num = tokenize_pattern_(li, tokens, arena, &columns, col_num, pattern_rule, pattern_len, modes);\n\
+      } else if ('\\n' == line[col_num] || '\\r' == line[col_num]) {\n\
+        col_num = tokenize_newline_(li, tokens, arena, &columns, col_num);\n\
+      } else {\n\
+        fprintf(stderr, \"UNKNOWN TOKEN in mode %%s at line %%d, col %%d\\n\",\n\
+                MODE_NAMES_[mode], li->line_num, col_num);\n\
+        exit(1);\n\
+      }\n\
+      continue;\n\
+    }\n\
     while (is_whitespace(line[col_num])) {\n\
       ++col_num;\n\
     }\n\
     if (*in_comment) {\n\
-      char *eoc = (strlen(*comment_end) > strlen(line) - col_num) ? NULL : find_str(line + col_num,\n\
-                            strlen(line) - col_num, *comment_end,\n\
+      char *eoc = (strlen(*comment_end) > line_len - col_num) ? NULL : find_str(line + col_num,\n\
+                            line_len - col_num, *comment_end,\n\
                             strlen(*comment_end));\n\
       // End of comment not found.\n\
       if (NULL == eoc) {\n\
@@ -544,37 +1106,32 @@ bool lexer_tokenize_line_(FileInfo *fi, TokenArray *tokens, bool *in_comment, bo
       char *eos = line + col_num - 1;\n\
       while (true) {\n\
         eos = find_str(eos + 1,\n\
-                       strlen(line) - (eos - line + 1), *string_end, \n\
+                       line_len - (eos - line + 1), *string_end, \n\
                        strlen(*string_end)); \n\
-        if (NULL == eos ||  *(eos - 1) != '\\\\') {\n\
+        if (NULL == eos || line == eos || *(eos - 1) != '\\\\') {\n\
           break;\n\
         }\n\
       }\n\
       if (NULL == eos) {\n\
-        eos = line + strlen(line);\n\
+        eos = line + line_len;\n\
       }\n\
       col_num = eos - line;\n\
-      if (NULL == *string_buffer) {\n\
-        *string_buffer = malloc(sizeof(char) * (col_num - string_start_col + 1));\n\
-        memcpy(*string_buffer, line + string_start_col, col_num - string_start_col);\n\
-        (*string_buffer)[col_num - string_start_col] = '\\0';\n\
-      } else {\n\
-        char *new_string_buffer =\n\
-            malloc(sizeof(char) *( strlen(*string_buffer) + col_num - string_start_col + 1));\n\
-        memcpy(new_string_buffer, *string_buffer, strlen(*string_buffer));\n\
-        memcpy(new_string_buffer + strlen(*string_buffer),  line + string_start_col, col_num - string_start_col);\n\
-        new_string_buffer[strlen(*string_buffer) + col_num - string_start_col] = '\\0';\n\
-        free(*string_buffer);\n\
-        *string_buffer = new_string_buffer;\n\
-      }\n\
       // End of string not found.\n\
-      if (line + strlen(line) == eos) {\n\
+      if (line + line_len == eos) {\n\
+        string_buffer_append_(string_buffer, line + string_start_col, col_num - string_start_col);\n\
         return true;\n\
       }\n\
-      Token *token = token_create(*string_type,\n\
-                   li->line_num, string_start_col, *string_buffer, strlen(*string_buffer));\n\
-      free(*string_buffer);\n\
-      *string_buffer = NULL;\n\
+      Token *token;\n\
+      if (0 == string_buffer->len) {\n\
+        // The string is on one line, so it is taken from the line directly.\n\
+        token = token_arena_create(arena, *string_type, li->line_num, column_(&columns, string_start_col),\n\
+                             line + string_start_col, col_num - string_start_col);\n\
+      } else {\n\
+        string_buffer_append_(string_buffer, line + string_start_col, col_num - string_start_col);\n\
+        token = token_arena_create(arena, *string_type, li->line_num, column_(&columns, string_start_col),\n\
+                             string_buffer->text, string_buffer->len);\n\
+        string_buffer->len = 0;\n\
+      }\n\
       *TokenArray_push_back_ref(tokens) = token;\n\
       col_num = eos - line + strlen(*string_end);\n\
       *in_string = false;\n\
@@ -596,45 +1153,87 @@ bool lexer_tokenize_line_(FileInfo *fi, TokenArray *tokens, bool *in_comment, bo
     }\n\
     if ('\\0' == line[col_num]) {\n\
       continue;\n\
+    } else if ((pattern_len = match_pattern_(mode, line + col_num, &pattern_rule)) > 0 &&\n\
+               pattern_len >= builtin_length_(line + col_num)) {\n\
+      col_num = tokenize_pattern_(li, tokens, arena, &columns, col_num, pattern_rule, pattern_len, modes);\n\
     } else if (is_numeric(line[col_num])) {\n\
-      col_num = tokenize_number_(li, tokens, col_num);\n\
+      col_num = tokenize_number_(li, tokens, arena, &columns, col_num);\n\
     } else if (%sis_start_of_symbol(line + col_num)) {\n\
-      col_num = tokenize_symbol_(li, tokens, col_num);\n\
-    } else if (is_alphanumeric(line[col_num])) {\n\
-      col_num = tokenize_word_(li, tokens, col_num);\n\
+      col_num = tokenize_symbol_(li, tokens, arena, &columns, col_num);\n\
+    } else if (identifier_start_length(line + col_num) > 0) {\n\
+      col_num = tokenize_word_(li, tokens, arena, &columns, col_num);\n\
     } else if ('\\n' == line[col_num] || '\\r' == line[col_num]) {\n\
-      col_num = tokenize_newline_(li, tokens, col_num);\n\
+      col_num = tokenize_newline_(li, tokens, arena, &columns, col_num);\n\
     } else {\n\
-      printf(\"%%d:%%d \\\"%%c\\\"\\n\", li->line_num, col_num, line[col_num]);\n\
-      printf(\"line: \\\"%%s\\\"\\n\", line);\n\
-      fflush(stdout);\n\
-      fprintf(stderr, \"NEVER HERE!\\n\");\n\
+      fprintf(stderr, \"UNEXPECTED CHARACTER 0x%%02X at line %%d, col %%d\\n\",\n\
+              (unsigned char)line[col_num], li->line_num, column_(&columns, col_num));\n\
       exit(1);\n\
     }\n\
   }\n\
   return true;\n\
 }\n\
 \n\
-void %slexer_tokenize_line(FileInfo *file, TokenArray *tokens) {\n\
+void %slexer_tokenize_line_in_arena(FileInfo *file, TokenArray *tokens, TokenArena *arena) {\n\
   bool in_comment = false;\n\
   char *comment_end = NULL;\n\
   bool in_string = false;\n\
   char *string_end = NULL;\n\
   %sLexType string_type = TOKENTYPE_UNKNOWN;\n\
-  char *string_buffer = NULL;\n\
-  lexer_tokenize_line_(file, tokens, &in_comment, &in_string, &comment_end, &string_end, &string_type, &string_buffer);\n\
+  StringBuffer_ string_buffer = {NULL, 0, 0};\n\
+  ModeStack_ modes = {NULL, 0, 0};\n\
+  lexer_tokenize_line_(file, tokens, &in_comment, &in_string, &comment_end, &string_end, &string_type, &string_buffer, &modes, arena);\n\
+  lt_free(string_buffer.text, string_buffer.capacity);\n\
+  lt_free(modes.modes, sizeof(int) * modes.capacity);\n\
 }\n\
-void %slexer_tokenize(FileInfo *file, TokenArray *tokens) {\n\
+\n\
+void %slexer_tokenize_line(FileInfo *file, TokenArray *tokens) {\n\
+  %slexer_tokenize_line_in_arena(file, tokens, NULL);\n\
+}\n\
+\n\
+void %slexer_tokenize_in_arena(FileInfo *file, TokenArray *tokens, TokenArena *arena) {\n\
   bool in_comment = false;\n\
   char *comment_end = NULL;\n\
   bool in_string = false;\n\
   char *string_end = NULL;\n\
   %sLexType string_type;\n\
-  char *string_buffer = NULL;\n\
-  while (lexer_tokenize_line_(file, tokens, &in_comment, &in_string, &comment_end, &string_end, &string_type, &string_buffer))\n\
+  StringBuffer_ string_buffer = {NULL, 0, 0};\n\
+  ModeStack_ modes = {NULL, 0, 0};\n\
+  while (lexer_tokenize_line_(file, tokens, &in_comment, &in_string, &comment_end, &string_end, &string_type, &string_buffer, &modes, arena))\n\
     ;\n\
+  lt_free(string_buffer.text, string_buffer.capacity);\n\
+  lt_free(modes.modes, sizeof(int) * modes.capacity);\n\
+}\n\
+\n\
+void %slexer_tokenize(FileInfo *file, TokenArray *tokens) {\n\
+  %slexer_tokenize_in_arena(file, tokens, NULL);\n\
 }\n";
 
+// Writes builtin_length_(), which returns the length of the number, symbol or
+// word at the start of text. A pattern is only taken if it matches at least as
+// much, so that it cannot split a longer builtin token.
+void write_builtin_length_(FILE *file, const char fn_prefix[],
+                           const char enum_prefix[]) {
+  fprintf(file,
+          "static int builtin_length_(const char text[]) {\n"
+          "  if (is_numeric(text[0])) {\n"
+          "    bool is_decimal;\n"
+          "    int64_t integer;\n"
+          "    double floating;\n"
+          "    return scan_number(text, NUMBER_LITERALS_, &is_decimal, "
+          "&integer,\n"
+          "                       &floating);\n"
+          "  }\n"
+          "  if (%sis_start_of_symbol(text)) {\n"
+          "    const %sLexType type = %ssymbol_token_type(text);\n"
+          "    return TOKENTYPE_UNKNOWN == type ? 0 : "
+          "strlen(%stoken_type_to_str(type));\n"
+          "  }\n"
+          "  return identifier_start_length(text) > 0 ? "
+          "identifier_length(text) : 0;\n"
+          "}\n\n",
+          fn_prefix, enum_prefix, fn_prefix, fn_prefix);
+}
+
 void lexer_builder_write_c_file(LexerBuilder *lb, FILE *file,
                                 const char h_file_path[],
                                 const char fn_prefix[],
@@ -648,9 +1247,20 @@ void lexer_builder_write_c_file(LexerBuilder *lb, FILE *file,
   write_is_start_comment_(lb, file, fn_prefix);
   write_is_start_string_(lb, file, fn_prefix, enum_prefix);
   write_token_type_is_string_(lb, file, fn_prefix, enum_prefix);
+  write_token_type_boundary_(lb, file, fn_prefix);
+  // Grammars that do not match newlines never see them, so that parsers need
+  // not skip them.
+  fprintf(file, "#define KEEP_NEWLINES_ %s\n\n",
+          lb->keep_newlines ? "true" : "false");
+  fprintf(file, "#define NUMBER_LITERALS_ %d\n\n", lb->number_literals);
+  fprintf(file, "#define CODE_POINT_COLUMNS_ %s\n\n",
+          lb->code_point_columns ? "true" : "false");
+  write_pattern_automata_(lb, file);
+  write_builtin_length_(file, fn_prefix, enum_prefix);
   fprintf(file, TOKENIZE_FUNCTIONS_TEXT_, enum_prefix, fn_prefix, fn_prefix,
           enum_prefix, enum_prefix, fn_prefix, fn_prefix, fn_prefix, fn_prefix,
-          enum_prefix, fn_prefix, enum_prefix);
+          enum_prefix, fn_prefix, fn_prefix, fn_prefix, enum_prefix, fn_prefix,
+          fn_prefix);
 }
 
 void lexer_builder_write_h_file(LexerBuilder *lb, FILE *file,
@@ -688,12 +1298,22 @@ void lexer_builder_write_h_file(LexerBuilder *lb, FILE *file,
           fn_prefix, enum_prefix);
   fprintf(file, "bool %stoken_type_is_string(%sLexType type);\n", fn_prefix,
           enum_prefix);
+  fprintf(file, "TokenBoundary %stoken_type_boundary(int token_type);\n",
+          fn_prefix);
   fprintf(file,
           "void %slexer_tokenize_line(FileInfo *file, TokenArray "
           "*tokens);\n",
           fn_prefix);
   fprintf(file, "void %slexer_tokenize(FileInfo *file, TokenArray *tokens);\n",
           fn_prefix);
+  fprintf(file,
+          "void %slexer_tokenize_line_in_arena(FileInfo *file, TokenArray "
+          "*tokens, TokenArena *arena);\n",
+          fn_prefix);
+  fprintf(file,
+          "void %slexer_tokenize_in_arena(FileInfo *file, TokenArray *tokens, "
+          "TokenArena *arena);\n",
+          fn_prefix);
   fprintf(file,
           "\n#ifdef __cplusplus\n}\n#endif\n\n"
           "#endif /* COM_GITHUB_LANGUAGE_TOOLS_LEXER_CUSTOM_LEXER_H_%s */\n",
@@ -703,7 +1323,8 @@ void lexer_builder_write_h_file(LexerBuilder *lb, FILE *file,
 void lexer_builder_finalize(LexerBuilder *lb) {
   TokenDefArray_finalize(&lb->symbols);
   TokenDefArray_finalize(&lb->keywords);
-  trie_delete_(lb->symbols_trie);
-  trie_delete_(lb->keywords_trie);
+  PatternDefArray_finalize(&lb->patterns);
+  trie_finalize_(&lb->symbols_trie);
+  trie_finalize_(&lb->keywords_trie);
   OpenCloseDefArray_finalize(&lb->comments);
 }
@@ -5,13 +5,12 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stdio.h>
 
 #include "c-data-structures/arraylike.h"
 #include "file-utils/file_info.h"
 
-#define TRIE_MAX_CHAR_ 256
-
 typedef struct {
   const char *token;
   const char *escaped_token;
@@ -29,24 +28,67 @@ typedef struct {
 
 DEFINE_ARRAYLIKE(OpenCloseDefArray, OpenCloseDef_);
 
-typedef struct Trie__ Trie_;
+typedef enum {
+  PATTERN_STAY_,
+  PATTERN_PUSH_,
+  PATTERN_POP_,
+} PatternAction_;
+
+typedef struct {
+  const char *token_name;
+  const char *regex;
+  // Lexer mode the pattern is matched in, or NULL for the default mode.
+  const char *mode;
+  PatternAction_ action;
+  // Mode entered by PATTERN_PUSH_, or NULL for the default mode.
+  const char *push_mode;
+} PatternDef_;
+
+DEFINE_ARRAYLIKE(PatternDefArray, PatternDef_);
 
-struct Trie__ {
-  Trie_ *chars[TRIE_MAX_CHAR_];
-  TokenDef_ *has;
-};
+// A trie over the escaped tokens, stored as the tokens sorted by their bytes.
+// A node at depth d is a run of tokens sharing their first d bytes; its
+// children are the sub-runs sharing byte d as well, already in case order.
+typedef struct {
+  TokenDef_ **tokens;
+  int num_tokens;
+} Trie_;
 
 typedef struct {
   TokenDefArray symbols;
   TokenDefArray keywords;
-  Trie_ *symbols_trie;
-  Trie_ *keywords_trie;
+  Trie_ symbols_trie;
+  Trie_ keywords_trie;
   OpenCloseDefArray comments;
   OpenCloseDefArray strings;
+  // Patterns of every lexer mode, in order of priority.
+  PatternDefArray patterns;
+  // Whether the generated lexer emits newline tokens. Defaults to false.
+  bool keep_newlines;
+  // Mask of NumberLiteralOptions. Defaults to none.
+  int number_literals;
+  // Whether token columns count code points rather than bytes. Defaults to
+  // false.
+  bool code_point_columns;
 } LexerBuilder;
 
 void lexer_builder_init(LexerBuilder *lb, FileInfo *symbols, FileInfo *keywords,
                         FileInfo *comments, FileInfo *strings);
+// Keeps newlines only if the grammar in rules, a parser rules.txt, matches
+// token:TOKEN_NEWLINE.
+void lexer_builder_newlines_from_rules(LexerBuilder *lb, FileInfo *rules);
+// Reads the numeric literal forms to accept from numbers, a file with one of
+// hex, octal or underscores per line.
+void lexer_builder_set_number_literals(LexerBuilder *lb, FileInfo *numbers);
+// Reads token types matched by regular expressions from patterns, a file with
+// lines of <token_name>,<regex>. Of the patterns matching at a position, the
+// longest match wins, then the earliest line.
+void lexer_builder_set_patterns(LexerBuilder *lb, FileInfo *patterns);
+// Reads lexer modes from modes, a file with lines of
+// <mode>,<token_name>,<action>,<regex>. Each mode other than DEFAULT is
+// matched only by its own patterns. action is empty to stay in the mode, pop
+// to return to the mode before it, or push:<mode> to enter another.
+void lexer_builder_set_modes(LexerBuilder *lb, FileInfo *modes);
 void lexer_builder_write_c_file(LexerBuilder *lb, FILE *file,
                                 const char h_file_path[],
                                 const char fn_prefix[],
@@ -1,14 +1,66 @@
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "file-utils/file_info.h"
 #include "file-utils/file_utils.h"
 #include "language-tools/intern.h"
 #include "language-tools/lexer/lexer_builder.h"
 
-int main(int argc, const char *argv[]) {
+// Usage: lexer_builder_main <header|src_header_path> <out_file> <symbols>
+//            <keywords> <comments> <strings> <fn_prefix> <enum_prefix>
+//            [--newlines_from=<rules.txt>] [--keep_newlines]
+//            [--numbers=<numbers.txt>] [--code_point_columns]
+//            [--patterns=<patterns.txt>] [--modes=<modes.txt>]
+//
+// Newlines are dropped unless --newlines_from is given and the grammar in
+// rules.txt matches them, or --keep_newlines always keeps them. --numbers lists the numeric literal
+// forms to accept. --code_point_columns counts token columns in code points
+// instead of bytes. --patterns defines token types by regular expressions.
+// --modes defines lexer modes with their own patterns.
+int main(int argc, const char *args[]) {
   global_string_intern_pool_init();
 
+  const char *argv[9];
+  int num_positional = 0;
+  const char *newlines_from = NULL;
+  bool keep_newlines = false;
+  const char *numbers_from = NULL;
+  bool code_point_columns = false;
+  const char *patterns_from = NULL;
+  const char *modes_from = NULL;
+  for (int i = 0; i < argc; ++i) {
+    if (0 == strncmp("--newlines_from=", args[i], strlen("--newlines_from="))) {
+      newlines_from = args[i] + strlen("--newlines_from=");
+    } else if (0 == strncmp("--numbers=", args[i], strlen("--numbers="))) {
+      numbers_from = args[i] + strlen("--numbers=");
+    } else if (0 == strncmp("--patterns=", args[i], strlen("--patterns="))) {
+      patterns_from = args[i] + strlen("--patterns=");
+    } else if (0 == strncmp("--modes=", args[i], strlen("--modes="))) {
+      modes_from = args[i] + strlen("--modes=");
+    } else if (0 == strcmp("--keep_newlines", args[i])) {
+      keep_newlines = true;
+    } else if (0 == strcmp("--code_point_columns", args[i])) {
+      code_point_columns = true;
+    } else if (num_positional < 9) {
+      argv[num_positional++] = args[i];
+    } else {
+      num_positional = 0;
+      break;
+    }
+  }
+  if (9 != num_positional) {
+    fprintf(stderr,
+            "Usage: %s <header|src_header_path> <out_file> <symbols> "
+            "<keywords> <comments> <strings> <fn_prefix> <enum_prefix> "
+            "[--newlines_from=<rules.txt>] [--keep_newlines] "
+            "[--numbers=<numbers.txt>] [--code_point_columns] "
+            "[--patterns=<patterns.txt>] [--modes=<modes.txt>]\n",
+            args[0]);
+    exit(1);
+  }
+
   const char *src_header_path = global_intern(argv[1]);
   const char *out_file_path = global_intern(argv[2]);
   FileInfo *symbols_file = file_info_file(FILE_FN(argv[3], "r"));
@@ -23,6 +75,29 @@ int main(int argc, const char *argv[]) {
   LexerBuilder lb;
   lexer_builder_init(&lb, symbols_file, keywords_file, comments_file,
                      strings_file);
+  lb.code_point_columns = code_point_columns;
+  if (keep_newlines) {
+    lb.keep_newlines = true;
+  } else if (NULL != newlines_from) {
+    FileInfo *rules_file = file_info_file(FILE_FN(newlines_from, "r"));
+    lexer_builder_newlines_from_rules(&lb, rules_file);
+    file_info_delete(rules_file);
+  }
+  if (NULL != numbers_from) {
+    FileInfo *numbers_file = file_info_file(FILE_FN(numbers_from, "r"));
+    lexer_builder_set_number_literals(&lb, numbers_file);
+    file_info_delete(numbers_file);
+  }
+  if (NULL != patterns_from) {
+    FileInfo *patterns_file = file_info_file(FILE_FN(patterns_from, "r"));
+    lexer_builder_set_patterns(&lb, patterns_file);
+    file_info_delete(patterns_file);
+  }
+  if (NULL != modes_from) {
+    FileInfo *modes_file = file_info_file(FILE_FN(modes_from, "r"));
+    lexer_builder_set_modes(&lb, modes_file);
+    file_info_delete(modes_file);
+  }
 
   const bool is_header = 0 == strcmp("header", src_header_path);
   if (is_header) {
@@ -2,6 +2,9 @@
 
 #include <stdlib.h>
 
+#include "language-tools/allocator.h"
+#include "language-tools/lexer/unicode.h"
+
 bool is_numeric(const char c) { return ('0' <= c && '9' >= c); }
 
 bool is_number(const char c) { return is_numeric(c) || '.' == c; }
@@ -93,13 +96,14 @@ char *escape_string(const char str[]) {
   }
   const char *ptr = str;
   char c;
-  char *escaped_str = malloc(sizeof(char) * DEFAULT_ESCAPED_STRING_SZ);
+  char *escaped_str = lt_malloc(sizeof(char) * DEFAULT_ESCAPED_STRING_SZ);
   int escaped_len = 0, escaped_buffer_sz = DEFAULT_ESCAPED_STRING_SZ;
   while ('\0' != (c = *ptr)) {
     if (escaped_len > escaped_buffer_sz - 3) {
-      escaped_str = realloc(
-          escaped_str,
-          sizeof(char) * (escaped_buffer_sz += DEFAULT_ESCAPED_STRING_SZ));
+      escaped_str = lt_realloc(
+          escaped_str, sizeof(char) * escaped_buffer_sz,
+          sizeof(char) * (escaped_buffer_sz + DEFAULT_ESCAPED_STRING_SZ));
+      escaped_buffer_sz += DEFAULT_ESCAPED_STRING_SZ;
     }
     if ('\r' == c) {
       ptr++;
@@ -112,7 +116,8 @@ char *escape_string(const char str[]) {
     ptr++;
   }
   escaped_str[escaped_len] = '\0';
-  return realloc(escaped_str, sizeof(char) * (escaped_len + 1));
+  return lt_realloc(escaped_str, sizeof(char) * escaped_buffer_sz,
+                    sizeof(char) * (escaped_len + 1));
 }
 
 char *strip_return_char(const char *str, int start, int end) {
@@ -121,13 +126,15 @@ char *strip_return_char(const char *str, int start, int end) {
   }
   const char *ptr = str;
   char c;
-  char *new_str = malloc(sizeof(char) * DEFAULT_ESCAPED_STRING_SZ);
+  char *new_str = lt_malloc(sizeof(char) * DEFAULT_ESCAPED_STRING_SZ);
   int len = 0, buffer_sz = DEFAULT_ESCAPED_STRING_SZ;
   for (int i = start; i < end; ++i) {
     c = ptr[i];
     if (len > buffer_sz - 3) {
-      new_str = realloc(
-          new_str, sizeof(char) * (buffer_sz += DEFAULT_ESCAPED_STRING_SZ));
+      new_str = lt_realloc(
+          new_str, sizeof(char) * buffer_sz,
+          sizeof(char) * (buffer_sz + DEFAULT_ESCAPED_STRING_SZ));
+      buffer_sz += DEFAULT_ESCAPED_STRING_SZ;
     }
     if ('\r' == c) {
       i++;
@@ -136,5 +143,169 @@ char *strip_return_char(const char *str, int start, int end) {
     new_str[len++] = excape_char_(c);
   }
   new_str[len] = '\0';
-  return realloc(new_str, sizeof(char) * (len + 1));
+  return lt_realloc(new_str, sizeof(char) * buffer_sz,
+                    sizeof(char) * (len + 1));
+}
+
+// Digits with more than this many significant digits, or with more fractional
+// digits than powers of ten that are exact in a double, are converted with
+// strtod().
+#define MAX_FAST_DIGITS_ 15
+#define MAX_FAST_FRACTION_DIGITS_ 22
+
+static const double POWERS_OF_TEN_[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static int digit_value_(char c) {
+  if ('0' <= c && '9' >= c) {
+    return c - '0';
+  }
+  if ('a' <= c && 'f' >= c) {
+    return c - 'a' + 10;
+  }
+  if ('A' <= c && 'F' >= c) {
+    return c - 'A' + 10;
+  }
+  return 16;
+}
+
+static bool is_separator_(const char text[], int i, int base, int options) {
+  return (options & NUMBER_LITERAL_UNDERSCORES) && '_' == text[i] && i > 0 &&
+         digit_value_(text[i - 1]) < base && digit_value_(text[i + 1]) < base;
+}
+
+static int scan_radix_integer_(const char text[], int start, int base,
+                               int options, int64_t *integer) {
+  int64_t value = 0;
+  int i = start;
+  for (;; ++i) {
+    if (is_separator_(text, i, base, options)) {
+      continue;
+    }
+    const int digit = digit_value_(text[i]);
+    if (digit >= base) {
+      break;
+    }
+    if (value > (INT64_MAX - digit) / base) {
+      return -1;
+    }
+    value = value * base + digit;
+  }
+  *integer = value;
+  return i;
+}
+
+// Converts the digits and '.' in text[0, len), skipping underscores, with
+// strtod(), which rounds correctly however many digits there are.
+static double slow_floating_(const char text[], int len) {
+  char buffer[64];
+  char *digits = len < (int)sizeof(buffer) ? buffer : lt_malloc(len + 1);
+  int num_digits = 0;
+  for (int i = 0; i < len; ++i) {
+    if ('_' != text[i]) {
+      digits[num_digits++] = text[i];
+    }
+  }
+  digits[num_digits] = '\0';
+  const double value = strtod(digits, NULL);
+  if (buffer != digits) {
+    lt_free(digits, len + 1);
+  }
+  return value;
+}
+
+int scan_number(const char text[], int options, bool *is_floating,
+                int64_t *integer, double *floating) {
+  *is_floating = false;
+  if ('0' == text[0]) {
+    if ((options & NUMBER_LITERAL_HEX) && ('x' == text[1] || 'X' == text[1]) &&
+        digit_value_(text[2]) < 16) {
+      return scan_radix_integer_(text, 2, 16, options, integer);
+    }
+    if ((options & NUMBER_LITERAL_OCTAL) &&
+        ('o' == text[1] || 'O' == text[1]) && digit_value_(text[2]) < 8) {
+      return scan_radix_integer_(text, 2, 8, options, integer);
+    }
+  }
+  uint64_t mantissa = 0;
+  int num_significant = 0, num_fraction = 0;
+  bool overflow = false;
+  int i = 0;
+  for (;; ++i) {
+    if ('.' == text[i]) {
+      // Decimals cannot have more than 1 decimal point.
+      if (*is_floating) {
+        break;
+      }
+      *is_floating = true;
+      continue;
+    }
+    if (is_separator_(text, i, 10, options)) {
+      continue;
+    }
+    if (!is_numeric(text[i])) {
+      break;
+    }
+    const int digit = text[i] - '0';
+    if (*is_floating) {
+      ++num_fraction;
+    }
+    if (0 == mantissa && 0 == digit) {
+      continue;
+    }
+    if (++num_significant > 19) {
+      overflow = true;
+    } else {
+      mantissa = mantissa * 10 + digit;
+    }
+  }
+  const int len = i;
+  if ('f' == text[i]) {
+    *is_floating = true;
+    ++i;
+  }
+  if (!*is_floating) {
+    if (overflow || mantissa > INT64_MAX) {
+      return -1;
+    }
+    *integer = (int64_t)mantissa;
+    return i;
+  }
+  // Both operands are exact, so the one rounding of the division gives the
+  // correctly rounded result.
+  *floating = num_significant <= MAX_FAST_DIGITS_ &&
+                      num_fraction <= MAX_FAST_FRACTION_DIGITS_
+                  ? (double)mantissa / POWERS_OF_TEN_[num_fraction]
+                  : slow_floating_(text, len);
+  return i;
+}
+
+int identifier_start_length(const char text[]) {
+  if (0 == (text[0] & 0x80)) {
+    return is_alphanumeric(text[0]) ? 1 : 0;
+  }
+  uint32_t code_point;
+  const int len = utf8_decode(text, &code_point);
+  return len > 0 && is_xid_start(code_point) ? len : 0;
+}
+
+int identifier_length(const char text[]) {
+  int len = 0;
+  while (true) {
+    // ASCII characters are checked without decoding.
+    if (0 == (text[len] & 0x80)) {
+      if (!is_alphanumeric(text[len])) {
+        return len;
+      }
+      ++len;
+      continue;
+    }
+    uint32_t code_point;
+    const int char_len = utf8_decode(text + len, &code_point);
+    if (0 == char_len || !is_xid_continue(code_point)) {
+      return len;
+    }
+    len += char_len;
+  }
 }
\ No newline at end of file
@@ -6,6 +6,18 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
+
+// Numeric literal forms a lexer accepts besides decimal digits with at most one
+// '.' and an optional trailing 'f'.
+typedef enum {
+  // 0x1F
+  NUMBER_LITERAL_HEX = 1 << 0,
+  // 0o17
+  NUMBER_LITERAL_OCTAL = 1 << 1,
+  // 1_000_000, with underscores only between digits.
+  NUMBER_LITERAL_UNDERSCORES = 1 << 2,
+} NumberLiteralOption;
 
 bool is_number(const char c);
 bool is_numeric(const char c);
@@ -14,9 +26,27 @@ bool is_alphanumeric(const char c);
 bool is_whitespace(const char c);
 bool is_any_space(const char c);
 char char_unesc(char u);
+// These return strings from lt_malloc(), to be freed with
+// lt_free(str, strlen(str) + 1).
 char *escape_string(const char str[]);
 char *strip_return_char(const char *str, int start, int end);
 
+// Returns the length in bytes of the character at the start of text if it can
+// start an identifier, or 0 if it cannot. ASCII letters, '_' and '$' and
+// UTF-8 encoded XID_Start code points can start one.
+int identifier_start_length(const char text[]);
+// Returns the length in bytes of the identifier characters at the start of
+// text: ASCII letters, digits, '_' and '$' and UTF-8 encoded XID_Continue code
+// points.
+int identifier_length(const char text[]);
+
+// Scans the numeric literal at the start of text, which must be a digit, in the
+// forms allowed by options, a mask of NumberLiteralOptions. Sets *is_floating
+// and decodes the literal into *integer or *floating. Returns the length of the
+// literal, or -1 if it is an integer that does not fit in an int64_t.
+int scan_number(const char text[], int options, bool *is_floating,
+                int64_t *integer, double *floating);
+
 #ifdef __cplusplus
 }
 #endif
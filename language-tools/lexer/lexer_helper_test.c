@@ -0,0 +1,148 @@
+#include "language-tools/lexer/lexer_helper.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "language-tools/testing/check.h"
+
+#define ALL_OPTIONS_                                     \
+  (NUMBER_LITERAL_HEX | NUMBER_LITERAL_OCTAL |           \
+   NUMBER_LITERAL_UNDERSCORES)
+
+// Scans text as an integer literal, checking that it is len characters long
+// and decodes to value.
+static void check_integer_(const char text[], int options, int len,
+                           int64_t value) {
+  bool is_floating;
+  int64_t integer = -1;
+  double floating;
+  CHECK_EQ_INT(len, scan_number(text, options, &is_floating, &integer,
+                                &floating));
+  CHECK(!is_floating);
+  CHECK_EQ_INT(value, integer);
+}
+
+static void check_floating_(const char text[], int options, int len,
+                            double value) {
+  bool is_floating;
+  int64_t integer;
+  double floating = -1;
+  CHECK_EQ_INT(len, scan_number(text, options, &is_floating, &integer,
+                                &floating));
+  CHECK(is_floating);
+  CHECK(value == floating);
+}
+
+static void check_overflows_(const char text[], int options) {
+  bool is_floating;
+  int64_t integer;
+  double floating;
+  CHECK_EQ_INT(-1,
+               scan_number(text, options, &is_floating, &integer, &floating));
+}
+
+static void test_decimal_() {
+  check_integer_("0", 0, 1, 0);
+  check_integer_("42;", 0, 2, 42);
+  check_integer_("007", 0, 3, 7);
+  check_integer_("9223372036854775807", 0, 19, INT64_MAX);
+  check_overflows_("9223372036854775808", 0);
+  check_overflows_("00000000000000000000123456789012345678901", 0);
+}
+
+static void test_floating_() {
+  check_floating_("3.25", 0, 4, 3.25);
+  check_floating_("1.", 0, 2, 1.0);
+  check_floating_("0.1", 0, 3, 0.1);
+  // Too many digits to convert exactly without strtod().
+  check_floating_("0.1000000000000000055511151231257827", 0, 36, 0.1);
+  check_floating_("123456789012345678901.5", 0, 23, 123456789012345678901.5);
+}
+
+static void test_hex_and_octal_() {
+  check_integer_("0x1F", NUMBER_LITERAL_HEX, 4, 31);
+  check_integer_("0XfF+", NUMBER_LITERAL_HEX, 4, 255);
+  check_integer_("0x7fffffffffffffff", NUMBER_LITERAL_HEX, 18, INT64_MAX);
+  check_overflows_("0x8000000000000000", NUMBER_LITERAL_HEX);
+  check_integer_("0o17", NUMBER_LITERAL_OCTAL, 4, 15);
+  check_integer_("0o19", NUMBER_LITERAL_OCTAL, 3, 1);
+}
+
+static void test_underscores_() {
+  check_integer_("1_000_000", NUMBER_LITERAL_UNDERSCORES, 9, 1000000);
+  check_integer_("0xFF_FF", ALL_OPTIONS_, 7, 0xFFFF);
+  check_floating_("1_0.2_5", NUMBER_LITERAL_UNDERSCORES, 7, 10.25);
+  // Underscores must be between digits.
+  check_integer_("1__0", NUMBER_LITERAL_UNDERSCORES, 1, 1);
+  check_integer_("1_", NUMBER_LITERAL_UNDERSCORES, 1, 1);
+  check_integer_("1_.5", NUMBER_LITERAL_UNDERSCORES, 1, 1);
+}
+
+// A trailing 'f' makes any decimal floating.
+static void test_suffix_() {
+  check_floating_("2f", 0, 2, 2.0);
+  check_floating_("1.5f", 0, 4, 1.5);
+  check_integer_("2F", 0, 1, 2);
+  check_integer_("0x1f", NUMBER_LITERAL_HEX, 4, 31);
+}
+
+// Exponents are not part of a literal, so "1e5" is 1 followed by e5.
+static void test_exponent_() {
+  check_integer_("1e5", ALL_OPTIONS_, 1, 1);
+  check_floating_("2.5E-3", ALL_OPTIONS_, 3, 2.5);
+}
+
+// Text that only starts like another form is scanned as a decimal.
+static void test_malformed_() {
+  check_integer_("0x", NUMBER_LITERAL_HEX, 1, 0);
+  check_integer_("0xg", NUMBER_LITERAL_HEX, 1, 0);
+  check_integer_("0x_1", ALL_OPTIONS_, 1, 0);
+  check_integer_("0o8", NUMBER_LITERAL_OCTAL, 1, 0);
+  // Forms that are not enabled.
+  check_integer_("0x1F", NUMBER_LITERAL_OCTAL, 1, 0);
+  check_integer_("0o17", NUMBER_LITERAL_HEX, 1, 0);
+  check_integer_("1_000", NUMBER_LITERAL_HEX, 1, 1);
+  // A second '.' ends the literal.
+  check_floating_("1.2.3", 0, 3, 1.2);
+}
+
+static void test_identifier_length_() {
+  CHECK_EQ_INT(1, identifier_start_length("x1"));
+  CHECK_EQ_INT(1, identifier_start_length("_"));
+  CHECK_EQ_INT(0, identifier_start_length("-x"));
+  CHECK_EQ_INT(5, identifier_length("x1_$y-z"));
+  // U+00EF and U+53D8 U+91CF: letters, 2 and 3 bytes long.
+  CHECK_EQ_INT(2, identifier_start_length("\xC3\xAFve"));
+  CHECK_EQ_INT(6, identifier_length("na\xC3\xAFve+"));
+  CHECK_EQ_INT(3, identifier_start_length("\xE5\x8F\x98\xE9\x87\x8F"));
+  CHECK_EQ_INT(6, identifier_length("\xE5\x8F\x98\xE9\x87\x8F"));
+  // U+0301, a combining accent, continues an identifier but cannot start one.
+  CHECK_EQ_INT(0, identifier_start_length("\xCC\x81" "e"));
+  CHECK_EQ_INT(3, identifier_length("e\xCC\x81 "));
+  // U+1F600, an emoji, is not an identifier character.
+  CHECK_EQ_INT(0, identifier_start_length("\xF0\x9F\x98\x80"));
+  CHECK_EQ_INT(1, identifier_length("a\xF0\x9F\x98\x80"));
+}
+
+// Malformed UTF-8 ends an identifier.
+static void test_identifier_length_malformed_() {
+  // Truncated, overlong and surrogate encodings.
+  CHECK_EQ_INT(0, identifier_start_length("\xC3"));
+  CHECK_EQ_INT(1, identifier_length("a\xE5\x8F"));
+  CHECK_EQ_INT(0, identifier_start_length("\xC1\x81"));
+  CHECK_EQ_INT(1, identifier_length("a\xED\xA0\x80"));
+  CHECK_EQ_INT(0, identifier_start_length("\x80"));
+}
+
+int main(int argc, const char *argv[]) {
+  test_decimal_();
+  test_floating_();
+  test_hex_and_octal_();
+  test_underscores_();
+  test_suffix_();
+  test_exponent_();
+  test_malformed_();
+  test_identifier_length_();
+  test_identifier_length_malformed_();
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include <stddef.h>
+
+#include "language-tools/intern.h"
+#include "language-tools/lexer/modes_lexer.h"
+#include "language-tools/testing/token_testing.h"
+
+static const char *type_name_(int token_type) {
+  return modes_token_type_to_name(token_type);
+}
+
+// Text in a template keeps its whitespace, and "${" returns to DEFAULT until
+// its matching '}', even within a nested template.
+static void test_nested_templates_() {
+  check_tokens(modes_lexer_tokenize, type_name_, "`a ${f(`b`)} c`", 12,
+               (int[]){TEMPLATE_START, TEMPLATE_TEXT, INTERP_OPEN, TOKEN_WORD,
+                       SYMBOL_LPAREN, TEMPLATE_START, TEMPLATE_TEXT,
+                       TEMPLATE_END, SYMBOL_RPAREN, SYMBOL_RBRACE,
+                       TEMPLATE_TEXT, TEMPLATE_END},
+               (const char *[]){"`", "a ", "${", "f", "(", "`", "b", "`", ")",
+                                "}", " c", "`"},
+               NULL);
+}
+
+// Braces pushed in DEFAULT are popped by their own '}', not the
+// interpolation's.
+static void test_braces_in_interpolation_() {
+  check_tokens(modes_lexer_tokenize, type_name_, "`${{x}}$`", 8,
+               (int[]){TEMPLATE_START, INTERP_OPEN, SYMBOL_LBRACE, TOKEN_WORD,
+                       SYMBOL_RBRACE, SYMBOL_RBRACE, TEMPLATE_TEXT,
+                       TEMPLATE_END},
+               (const char *[]){"`", "${", "{", "x", "}", "}", "$", "`"},
+               NULL);
+}
+
+// Other modes only match their own patterns, so a comment or keyword in a
+// template is text.
+static void test_mode_patterns_only_() {
+  check_tokens(modes_lexer_tokenize, type_name_, "if `if ; x`", 4,
+               (int[]){KEYWORD_IF, TEMPLATE_START, TEMPLATE_TEXT,
+                       TEMPLATE_END},
+               (const char *[]){"if", "`", "if ; x", "`"}, NULL);
+}
+
+// Popping at the bottom of the stack stays in DEFAULT.
+static void test_pop_at_bottom_() {
+  check_tokens(modes_lexer_tokenize, type_name_, "} x", 2,
+               (int[]){SYMBOL_RBRACE, TOKEN_WORD}, (const char *[]){"}", "x"},
+               NULL);
+}
+
+// The mode stack carries over to the next line.
+static void test_across_lines_() {
+  check_tokens(modes_lexer_tokenize, type_name_, "x `a\nb` y", 6,
+               (int[]){TOKEN_WORD, TEMPLATE_START, TEMPLATE_TEXT,
+                       TEMPLATE_TEXT, TEMPLATE_END, TOKEN_WORD},
+               (const char *[]){"x", "`", "a", "b", "`", "y"}, NULL);
+}
+
+int main(int argc, const char *argv[]) {
+  global_string_intern_pool_init();
+  test_nested_templates_();
+  test_braces_in_interpolation_();
+  test_mode_patterns_only_();
+  test_pop_at_bottom_();
+  test_across_lines_();
+  global_string_intern_pool_finalize();
+  return 0;
+}
@@ -0,0 +1,644 @@
+#include "language-tools/lexer/pattern_compiler.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Repetitions are expanded into copies, so bounds are kept small.
+#define MAX_REPEAT_ 1000
+#define MAX_DFA_STATES_ 65535
+
+typedef uint8_t ByteSet_[32];
+
+static void set_add_(ByteSet_ set, int c) { set[c >> 3] |= 1 << (c & 7); }
+
+static bool set_has_(const ByteSet_ set, int c) {
+  return 0 != (set[c >> 3] & (1 << (c & 7)));
+}
+
+static void set_add_range_(ByteSet_ set, int low, int high) {
+  for (int c = low; c <= high; ++c) {
+    set_add_(set, c);
+  }
+}
+
+static void set_invert_(ByteSet_ set) {
+  for (int i = 0; i < 32; ++i) {
+    set[i] = ~set[i];
+  }
+}
+
+// Lexers match within a line, so neither the end of the line nor of the text
+// is ever part of a match.
+static void set_remove_line_end_(ByteSet_ set) {
+  set['\0' >> 3] &= ~(1 << ('\0' & 7));
+  set['\n' >> 3] &= ~(1 << ('\n' & 7));
+}
+
+typedef enum {
+  NODE_EMPTY_,
+  NODE_SET_,
+  NODE_CONCAT_,
+  NODE_ALT_,
+  NODE_REPEAT_,
+} NodeType_;
+
+typedef struct Node__ Node_;
+
+struct Node__ {
+  NodeType_ type;
+  ByteSet_ set;
+  Node_ *left, *right;
+  // Bounds of NODE_REPEAT_. max is -1 if unbounded.
+  int min, max;
+};
+
+typedef struct {
+  const char *pattern, *name;
+  int pos;
+} Parser_;
+
+static void fail_(const Parser_ *p, const char message[]) {
+  fprintf(stderr, "Invalid pattern for %s at %d: %s\n  %s\n", p->name, p->pos,
+          message, p->pattern);
+  exit(1);
+}
+
+static Node_ *node_create_(NodeType_ type, Node_ *left, Node_ *right) {
+  Node_ *node = calloc(1, sizeof(Node_));
+  node->type = type;
+  node->left = left;
+  node->right = right;
+  return node;
+}
+
+static void node_delete_(Node_ *node) {
+  if (NULL == node) {
+    return;
+  }
+  node_delete_(node->left);
+  node_delete_(node->right);
+  free(node);
+}
+
+static char peek_(const Parser_ *p) { return p->pattern[p->pos]; }
+
+static int hex_digit_(char c) {
+  if ('0' <= c && '9' >= c) {
+    return c - '0';
+  }
+  if ('a' <= c && 'f' >= c) {
+    return c - 'a' + 10;
+  }
+  if ('A' <= c && 'F' >= c) {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Parses the escape after a '\\' into set. Returns the byte escaped, or -1 if
+// it stands for a class of bytes.
+static int parse_escape_(Parser_ *p, ByteSet_ set) {
+  const char c = p->pattern[p->pos++];
+  ByteSet_ class = {0};
+  switch (c) {
+    case '\0':
+      --p->pos;
+      fail_(p, "trailing '\\'");
+      return -1;
+    case 'n':
+      set_add_(set, '\n');
+      return '\n';
+    case 't':
+      set_add_(set, '\t');
+      return '\t';
+    case 'r':
+      set_add_(set, '\r');
+      return '\r';
+    case 'x': {
+      const int high = hex_digit_(p->pattern[p->pos]);
+      const int low = high < 0 ? -1 : hex_digit_(p->pattern[p->pos + 1]);
+      if (low < 0) {
+        fail_(p, "expected two hex digits after \\x");
+      }
+      p->pos += 2;
+      set_add_(set, high * 16 + low);
+      return high * 16 + low;
+    }
+    case 'd':
+    case 'D':
+      set_add_range_(class, '0', '9');
+      break;
+    case 'w':
+    case 'W':
+      set_add_range_(class, '0', '9');
+      set_add_range_(class, 'a', 'z');
+      set_add_range_(class, 'A', 'Z');
+      set_add_(class, '_');
+      break;
+    case 's':
+    case 'S':
+      set_add_(class, ' ');
+      set_add_range_(class, '\t', '\r');
+      break;
+    default:
+      if (('a' <= c && 'z' >= c) || ('A' <= c && 'Z' >= c) ||
+          ('0' <= c && '9' >= c)) {
+        --p->pos;
+        fail_(p, "unknown escape");
+      }
+      set_add_(set, (uint8_t)c);
+      return (uint8_t)c;
+  }
+  if ('A' <= c && 'Z' >= c) {
+    set_invert_(class);
+  }
+  for (int i = 0; i < 32; ++i) {
+    set[i] |= class[i];
+  }
+  return -1;
+}
+
+// Parses a class after its '['.
+static Node_ *parse_class_(Parser_ *p) {
+  Node_ *node = node_create_(NODE_SET_, NULL, NULL);
+  const bool negated = '^' == peek_(p);
+  if (negated) {
+    ++p->pos;
+  }
+  bool first = true;
+  while (']' != peek_(p) || first) {
+    first = false;
+    if ('\0' == peek_(p)) {
+      fail_(p, "unterminated '['");
+    }
+    int low;
+    if ('\\' == peek_(p)) {
+      ++p->pos;
+      low = parse_escape_(p, node->set);
+    } else {
+      low = (uint8_t)p->pattern[p->pos++];
+      set_add_(node->set, low);
+    }
+    if ('-' != peek_(p) || ']' == p->pattern[p->pos + 1] || low < 0) {
+      continue;
+    }
+    ++p->pos;
+    int high;
+    if ('\0' == peek_(p)) {
+      fail_(p, "unterminated '['");
+    }
+    if ('\\' == peek_(p)) {
+      ++p->pos;
+      ByteSet_ ignored = {0};
+      high = parse_escape_(p, ignored);
+      if (high < 0) {
+        fail_(p, "range ends with a class");
+      }
+    } else {
+      high = (uint8_t)p->pattern[p->pos++];
+    }
+    if (high < low) {
+      fail_(p, "range out of order");
+    }
+    set_add_range_(node->set, low, high);
+  }
+  ++p->pos;
+  if (negated) {
+    set_invert_(node->set);
+  }
+  set_remove_line_end_(node->set);
+  return node;
+}
+
+static Node_ *parse_alt_(Parser_ *p);
+
+static Node_ *parse_atom_(Parser_ *p) {
+  const char c = p->pattern[p->pos++];
+  Node_ *node;
+  switch (c) {
+    case '(':
+      node = parse_alt_(p);
+      if (')' != peek_(p)) {
+        fail_(p, "expected ')'");
+      }
+      ++p->pos;
+      return node;
+    case '[':
+      return parse_class_(p);
+    case '.':
+      node = node_create_(NODE_SET_, NULL, NULL);
+      set_invert_(node->set);
+      break;
+    case '\\':
+      node = node_create_(NODE_SET_, NULL, NULL);
+      parse_escape_(p, node->set);
+      break;
+    case '*':
+    case '+':
+    case '?':
+    case '{':
+      --p->pos;
+      fail_(p, "nothing to repeat");
+      return NULL;
+    default:
+      node = node_create_(NODE_SET_, NULL, NULL);
+      set_add_(node->set, (uint8_t)c);
+      break;
+  }
+  set_remove_line_end_(node->set);
+  return node;
+}
+
+static int parse_count_(Parser_ *p) {
+  if ('0' > peek_(p) || '9' < peek_(p)) {
+    fail_(p, "expected a count");
+  }
+  int count = 0;
+  while ('0' <= peek_(p) && '9' >= peek_(p)) {
+    count = count * 10 + (p->pattern[p->pos++] - '0');
+    if (count > MAX_REPEAT_) {
+      fail_(p, "count too large");
+    }
+  }
+  return count;
+}
+
+static Node_ *parse_repeat_(Parser_ *p) {
+  Node_ *node = parse_atom_(p);
+  while (true) {
+    int min, max;
+    switch (peek_(p)) {
+      case '*':
+        min = 0, max = -1;
+        break;
+      case '+':
+        min = 1, max = -1;
+        break;
+      case '?':
+        min = 0, max = 1;
+        break;
+      case '{':
+        ++p->pos;
+        min = max = parse_count_(p);
+        if (',' == peek_(p)) {
+          ++p->pos;
+          max = '}' == peek_(p) ? -1 : parse_count_(p);
+        }
+        if ('}' != peek_(p)) {
+          fail_(p, "expected '}'");
+        }
+        if (max >= 0 && max < min) {
+          fail_(p, "repetition out of order");
+        }
+        break;
+      default:
+        return node;
+    }
+    ++p->pos;
+    node = node_create_(NODE_REPEAT_, node, NULL);
+    node->min = min;
+    node->max = max;
+  }
+}
+
+static Node_ *parse_concat_(Parser_ *p) {
+  Node_ *node = node_create_(NODE_EMPTY_, NULL, NULL);
+  while ('\0' != peek_(p) && '|' != peek_(p) && ')' != peek_(p)) {
+    node = node_create_(NODE_CONCAT_, node, parse_repeat_(p));
+  }
+  return node;
+}
+
+static Node_ *parse_alt_(Parser_ *p) {
+  Node_ *node = parse_concat_(p);
+  while ('|' == peek_(p)) {
+    ++p->pos;
+    node = node_create_(NODE_ALT_, node, parse_concat_(p));
+  }
+  return node;
+}
+
+// A Thompson NFA state. One with a set moves to out on any byte in it;
+// otherwise out and out1 are epsilon moves, or -1.
+typedef struct {
+  bool has_set;
+  ByteSet_ set;
+  int out, out1;
+  // Index of the pattern accepted here, or -1.
+  int accept;
+} NfaState_;
+
+typedef struct {
+  NfaState_ *states;
+  int num_states, capacity;
+} Nfa_;
+
+// A piece of an NFA. end has no moves until the piece is joined to another.
+typedef struct {
+  int start, end;
+} Fragment_;
+
+static int nfa_add_(Nfa_ *nfa) {
+  if (nfa->num_states == nfa->capacity) {
+    nfa->capacity = nfa->capacity > 0 ? 2 * nfa->capacity : 256;
+    nfa->states = realloc(nfa->states, sizeof(NfaState_) * nfa->capacity);
+  }
+  NfaState_ *state = &nfa->states[nfa->num_states];
+  memset(state, 0, sizeof(NfaState_));
+  state->out = state->out1 = state->accept = -1;
+  return nfa->num_states++;
+}
+
+static Fragment_ nfa_build_(Nfa_ *nfa, const Node_ *node);
+
+static Fragment_ nfa_concat_(Nfa_ *nfa, Fragment_ first, Fragment_ second) {
+  nfa->states[first.end].out = second.start;
+  return (Fragment_){first.start, second.end};
+}
+
+// Matches node zero or one times, or any number of times if unbounded.
+static Fragment_ nfa_optional_(Nfa_ *nfa, const Node_ *node, bool unbounded) {
+  const Fragment_ body = nfa_build_(nfa, node);
+  const int start = nfa_add_(nfa);
+  const int end = nfa_add_(nfa);
+  nfa->states[start].out = body.start;
+  nfa->states[start].out1 = end;
+  nfa->states[body.end].out = unbounded ? body.start : end;
+  nfa->states[body.end].out1 = unbounded ? end : -1;
+  return (Fragment_){start, end};
+}
+
+static Fragment_ nfa_build_(Nfa_ *nfa, const Node_ *node) {
+  switch (node->type) {
+    case NODE_SET_: {
+      const int start = nfa_add_(nfa);
+      const int end = nfa_add_(nfa);
+      nfa->states[start].has_set = true;
+      memcpy(nfa->states[start].set, node->set, sizeof(ByteSet_));
+      nfa->states[start].out = end;
+      return (Fragment_){start, end};
+    }
+    case NODE_CONCAT_:
+      return nfa_concat_(nfa, nfa_build_(nfa, node->left),
+                         nfa_build_(nfa, node->right));
+    case NODE_ALT_: {
+      const Fragment_ left = nfa_build_(nfa, node->left);
+      const Fragment_ right = nfa_build_(nfa, node->right);
+      const int start = nfa_add_(nfa);
+      const int end = nfa_add_(nfa);
+      nfa->states[start].out = left.start;
+      nfa->states[start].out1 = right.start;
+      nfa->states[left.end].out = end;
+      nfa->states[right.end].out = end;
+      return (Fragment_){start, end};
+    }
+    case NODE_REPEAT_: {
+      const int empty = nfa_add_(nfa);
+      Fragment_ fragment = {empty, empty};
+      for (int i = 0; i < node->min; ++i) {
+        fragment = nfa_concat_(nfa, fragment, nfa_build_(nfa, node->left));
+      }
+      if (node->max < 0) {
+        return nfa_concat_(nfa, fragment,
+                           nfa_optional_(nfa, node->left, true));
+      }
+      for (int i = node->min; i < node->max; ++i) {
+        fragment = nfa_concat_(nfa, fragment,
+                               nfa_optional_(nfa, node->left, false));
+      }
+      return fragment;
+    }
+    case NODE_EMPTY_:
+    default: {
+      const int state = nfa_add_(nfa);
+      return (Fragment_){state, state};
+    }
+  }
+}
+
+// A set of NFA states, sorted, that is one DFA state.
+typedef struct {
+  int *states;
+  int num_states;
+} StateSet_;
+
+typedef struct {
+  StateSet_ *sets;
+  int num_sets, capacity;
+  // Open-addressed indices of sets plus one, or 0 where empty.
+  int *table;
+  int table_size;
+} DfaBuilder_;
+
+static uint32_t hash_set_(const int states[], int num_states) {
+  uint32_t hash = 0x811C9DC5;
+  for (int i = 0; i < num_states; ++i) {
+    hash = (hash ^ (uint32_t)states[i]) * 0x01000193;
+  }
+  return hash;
+}
+
+static void table_insert_(DfaBuilder_ *builder, int index) {
+  const StateSet_ *set = &builder->sets[index];
+  int i = hash_set_(set->states, set->num_states) & (builder->table_size - 1);
+  while (0 != builder->table[i]) {
+    i = (i + 1) & (builder->table_size - 1);
+  }
+  builder->table[i] = index + 1;
+}
+
+// Returns the index of the DFA state for states, adding it if it is new.
+static int dfa_state_(DfaBuilder_ *builder, const int states[],
+                      int num_states) {
+  int i = hash_set_(states, num_states) & (builder->table_size - 1);
+  for (; 0 != builder->table[i]; i = (i + 1) & (builder->table_size - 1)) {
+    const StateSet_ *set = &builder->sets[builder->table[i] - 1];
+    if (set->num_states == num_states &&
+        0 == memcmp(set->states, states, sizeof(int) * num_states)) {
+      return builder->table[i] - 1;
+    }
+  }
+  if (builder->num_sets == builder->capacity) {
+    builder->capacity = builder->capacity > 0 ? 2 * builder->capacity : 64;
+    builder->sets =
+        realloc(builder->sets, sizeof(StateSet_) * builder->capacity);
+  }
+  StateSet_ *set = &builder->sets[builder->num_sets];
+  set->states = malloc(sizeof(int) * (num_states > 0 ? num_states : 1));
+  memcpy(set->states, states, sizeof(int) * num_states);
+  set->num_states = num_states;
+  if (2 * (builder->num_sets + 1) > builder->table_size) {
+    free(builder->table);
+    builder->table_size *= 2;
+    builder->table = calloc(builder->table_size, sizeof(int));
+    for (int j = 0; j < builder->num_sets; ++j) {
+      table_insert_(builder, j);
+    }
+  }
+  table_insert_(builder, builder->num_sets);
+  return builder->num_sets++;
+}
+
+static int compare_ints_(const void *a, const void *b) {
+  return *(const int *)a - *(const int *)b;
+}
+
+// Replaces states[0, *num_states) with its epsilon closure, sorted. states
+// has room for every NFA state, and on_stack is cleared before returning.
+static void closure_(const Nfa_ *nfa, int states[], int *num_states,
+                     bool on_stack[], int stack[]) {
+  int num_stack = 0;
+  for (int i = 0; i < *num_states; ++i) {
+    on_stack[states[i]] = true;
+    stack[num_stack++] = states[i];
+  }
+  *num_states = 0;
+  while (num_stack > 0) {
+    const int state = stack[--num_stack];
+    states[(*num_states)++] = state;
+    const NfaState_ *nfa_state = &nfa->states[state];
+    if (nfa_state->has_set) {
+      continue;
+    }
+    const int outs[] = {nfa_state->out, nfa_state->out1};
+    for (int i = 0; i < 2; ++i) {
+      if (outs[i] >= 0 && !on_stack[outs[i]]) {
+        on_stack[outs[i]] = true;
+        stack[num_stack++] = outs[i];
+      }
+    }
+  }
+  for (int i = 0; i < *num_states; ++i) {
+    on_stack[states[i]] = false;
+  }
+  qsort(states, *num_states, sizeof(int), compare_ints_);
+}
+
+// Splits bytes into classes that no set in nfa tells apart.
+static void byte_classes_(const Nfa_ *nfa, PatternDfa *dfa) {
+  memset(dfa->byte_classes, 0, sizeof(dfa->byte_classes));
+  dfa->num_classes = 1;
+  for (int s = 0; s < nfa->num_states; ++s) {
+    if (!nfa->states[s].has_set) {
+      continue;
+    }
+    // Each class splits into the bytes in the set and those outside it.
+    int split[256][2];
+    memset(split, -1, sizeof(split));
+    int num_classes = 0;
+    for (int c = 0; c < 256; ++c) {
+      int *class = &split[dfa->byte_classes[c]][set_has_(
+          nfa->states[s].set, c)];
+      if (*class < 0) {
+        *class = num_classes++;
+      }
+      dfa->byte_classes[c] = *class;
+    }
+    dfa->num_classes = num_classes;
+  }
+}
+
+void pattern_dfa_compile(PatternDfa *dfa, const char *patterns[],
+                         const char *names[], int num_patterns) {
+  Nfa_ nfa = {NULL, 0, 0};
+  // Alternates between every pattern from a single start.
+  const int start = nfa_add_(&nfa);
+  int prev = start;
+  for (int i = 0; i < num_patterns; ++i) {
+    Parser_ p = {patterns[i], names[i], 0};
+    Node_ *node = parse_alt_(&p);
+    if ('\0' != peek_(&p)) {
+      fail_(&p, "unmatched ')'");
+    }
+    const Fragment_ fragment = nfa_build_(&nfa, node);
+    node_delete_(node);
+    nfa.states[fragment.end].accept = i;
+    const int next = nfa_add_(&nfa);
+    nfa.states[prev].out = fragment.start;
+    nfa.states[prev].out1 = next;
+    prev = next;
+  }
+
+  byte_classes_(&nfa, dfa);
+  int representatives[256];
+  for (int c = 255; c >= 0; --c) {
+    representatives[dfa->byte_classes[c]] = c;
+  }
+
+  DfaBuilder_ builder = {NULL, 0, 0, calloc(64, sizeof(int)), 64};
+  int *states = malloc(sizeof(int) * nfa.num_states);
+  int *stack = malloc(sizeof(int) * nfa.num_states);
+  bool *on_stack = calloc(nfa.num_states, sizeof(bool));
+  // State 0 is the empty set, which is dead.
+  dfa_state_(&builder, states, 0);
+  int num_states = 1;
+  states[0] = start;
+  closure_(&nfa, states, &num_states, on_stack, stack);
+  dfa_state_(&builder, states, num_states);
+
+  int capacity = 64;
+  dfa->transitions = malloc(sizeof(uint16_t) * capacity * dfa->num_classes);
+  dfa->accepts = malloc(sizeof(int) * capacity);
+  // Sets are added as they are first reached, so this visits each once.
+  for (int d = 0; d < builder.num_sets; ++d) {
+    if (d >= MAX_DFA_STATES_) {
+      fprintf(stderr, "Patterns need more than %d DFA states.\n",
+              MAX_DFA_STATES_);
+      exit(1);
+    }
+    if (d == capacity) {
+      capacity *= 2;
+      dfa->transitions = realloc(dfa->transitions, sizeof(uint16_t) *
+                                                       capacity *
+                                                       dfa->num_classes);
+      dfa->accepts = realloc(dfa->accepts, sizeof(int) * capacity);
+    }
+    dfa->accepts[d] = -1;
+    const StateSet_ *set = &builder.sets[d];
+    for (int i = 0; i < set->num_states; ++i) {
+      const int accept = nfa.states[set->states[i]].accept;
+      if (accept >= 0 && (dfa->accepts[d] < 0 || accept < dfa->accepts[d])) {
+        dfa->accepts[d] = accept;
+      }
+    }
+    for (int c = 0; c < dfa->num_classes; ++c) {
+      num_states = 0;
+      // builder.sets may move when a state is added.
+      const int *set_states = builder.sets[d].states;
+      const int set_size = builder.sets[d].num_states;
+      for (int i = 0; i < set_size; ++i) {
+        const NfaState_ *nfa_state = &nfa.states[set_states[i]];
+        if (nfa_state->has_set &&
+            set_has_(nfa_state->set, representatives[c]) &&
+            !on_stack[nfa_state->out]) {
+          on_stack[nfa_state->out] = true;
+          states[num_states++] = nfa_state->out;
+        }
+      }
+      for (int i = 0; i < num_states; ++i) {
+        on_stack[states[i]] = false;
+      }
+      closure_(&nfa, states, &num_states, on_stack, stack);
+      dfa->transitions[d * dfa->num_classes + c] =
+          dfa_state_(&builder, states, num_states);
+    }
+  }
+  dfa->num_states = builder.num_sets;
+
+  for (int d = 0; d < builder.num_sets; ++d) {
+    free(builder.sets[d].states);
+  }
+  free(builder.sets);
+  free(builder.table);
+  free(states);
+  free(stack);
+  free(on_stack);
+  free(nfa.states);
+}
+
+void pattern_dfa_finalize(PatternDfa *dfa) {
+  free(dfa->transitions);
+  free(dfa->accepts);
+}
\ No newline at end of file
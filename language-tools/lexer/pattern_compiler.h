@@ -0,0 +1,35 @@
+#ifndef COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_LEXER_PATTERN_COMPILER_H_
+#define COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_LEXER_PATTERN_COMPILER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// A DFA over bytes recognizing a list of regular expressions. State 0 is dead
+// and state 1 is the start. Bytes are mapped to classes that every state
+// treats alike, so a row of transitions has one entry per class.
+typedef struct {
+  int num_states, num_classes;
+  uint8_t byte_classes[256];
+  // num_states rows of num_classes next states.
+  uint16_t *transitions;
+  // Index of the first pattern listed that accepts at each state, or -1.
+  int *accepts;
+} PatternDfa;
+
+// Compiles patterns, which are regular expressions, into dfa. Supported are
+// literals, '.', classes such as [a-z_] and [^0-9], escapes such as \. \d \w
+// \s \xHH, groups, '|', and the repetitions *, +, ?, {n}, {n,} and {n,m}.
+// Matches never include '\0' or '\n'. Exits naming names[i] if patterns[i] is
+// invalid.
+void pattern_dfa_compile(PatternDfa *dfa, const char *patterns[],
+                         const char *names[], int num_patterns);
+void pattern_dfa_finalize(PatternDfa *dfa);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_LEXER_PATTERN_COMPILER_H_ */
\ No newline at end of file
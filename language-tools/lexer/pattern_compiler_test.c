@@ -0,0 +1,112 @@
+#include "language-tools/lexer/pattern_compiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "language-tools/testing/check.h"
+
+#define COMPILE_(dfa, ...)                                           \
+  do {                                                               \
+    const char *patterns[] = {__VA_ARGS__};                          \
+    const int num_patterns = sizeof(patterns) / sizeof(patterns[0]); \
+    pattern_dfa_compile(dfa, patterns, patterns, num_patterns);      \
+  } while (0)
+
+// Runs dfa over text like a generated lexer does. Returns the length of the
+// longest match at the start of text, or 0, and sets *pattern to the pattern
+// it accepts.
+static int match_(const PatternDfa *dfa, const char text[], int *pattern) {
+  int state = 1, len = 0;
+  *pattern = -1;
+  for (int i = 0; 0 != state; ++i) {
+    if (dfa->accepts[state] >= 0) {
+      len = i;
+      *pattern = dfa->accepts[state];
+    }
+    if ('\0' == text[i]) {
+      break;
+    }
+    const int byte_class = dfa->byte_classes[(unsigned char)text[i]];
+    state = dfa->transitions[state * dfa->num_classes + byte_class];
+  }
+  return len;
+}
+
+static int match_len_(const PatternDfa *dfa, const char text[]) {
+  int pattern;
+  return match_(dfa, text, &pattern);
+}
+
+static void test_literals_and_classes_() {
+  PatternDfa dfa;
+  COMPILE_(&dfa, "ab[c-e]+[^0-9]");
+  CHECK_EQ_INT(5, match_len_(&dfa, "abcdx"));
+  CHECK_EQ_INT(6, match_len_(&dfa, "abeecz0"));
+  CHECK_EQ_INT(0, match_len_(&dfa, "abc9"));
+  CHECK_EQ_INT(0, match_len_(&dfa, "ab"));
+  pattern_dfa_finalize(&dfa);
+}
+
+static void test_escapes_() {
+  PatternDfa dfa;
+  COMPILE_(&dfa, "\\d+\\.\\w\\s\\x41");
+  CHECK_EQ_INT(6, match_len_(&dfa, "12.a A"));
+  CHECK_EQ_INT(0, match_len_(&dfa, "12xa A"));
+  pattern_dfa_finalize(&dfa);
+}
+
+static void test_repetition_() {
+  PatternDfa dfa;
+  COMPILE_(&dfa, "a{2,3}b?");
+  CHECK_EQ_INT(0, match_len_(&dfa, "ab"));
+  CHECK_EQ_INT(3, match_len_(&dfa, "aab"));
+  CHECK_EQ_INT(3, match_len_(&dfa, "aaaab"));
+  CHECK_EQ_INT(4, match_len_(&dfa, "aaab"));
+  pattern_dfa_finalize(&dfa);
+
+  COMPILE_(&dfa, "x{2}y{1,}z*");
+  CHECK_EQ_INT(0, match_len_(&dfa, "xyz"));
+  CHECK_EQ_INT(6, match_len_(&dfa, "xxyyzz"));
+  pattern_dfa_finalize(&dfa);
+}
+
+static void test_groups_and_alternation_() {
+  PatternDfa dfa;
+  COMPILE_(&dfa, "(ab|cd)+e|f");
+  CHECK_EQ_INT(5, match_len_(&dfa, "abcde"));
+  CHECK_EQ_INT(1, match_len_(&dfa, "f"));
+  CHECK_EQ_INT(0, match_len_(&dfa, "abf"));
+  pattern_dfa_finalize(&dfa);
+}
+
+// The longest match wins, and of equal matches the first pattern listed.
+static void test_priority_() {
+  PatternDfa dfa;
+  COMPILE_(&dfa, "if", "[a-z]+", "[a-z]+\\d");
+  int pattern;
+  CHECK_EQ_INT(2, match_(&dfa, "if ", &pattern));
+  CHECK_EQ_INT(0, pattern);
+  CHECK_EQ_INT(3, match_(&dfa, "iff", &pattern));
+  CHECK_EQ_INT(1, pattern);
+  CHECK_EQ_INT(3, match_(&dfa, "if1", &pattern));
+  CHECK_EQ_INT(2, pattern);
+  pattern_dfa_finalize(&dfa);
+}
+
+static void test_never_matches_line_end_() {
+  PatternDfa dfa;
+  COMPILE_(&dfa, ".*", "[^a]+");
+  CHECK_EQ_INT(3, match_len_(&dfa, "abc\ndef"));
+  CHECK_EQ_INT(2, match_len_(&dfa, "bc\n"));
+  pattern_dfa_finalize(&dfa);
+}
+
+int main(int argc, const char *argv[]) {
+  test_literals_and_classes_();
+  test_escapes_();
+  test_repetition_();
+  test_groups_and_alternation_();
+  test_priority_();
+  test_never_matches_line_end_();
+  return 0;
+}
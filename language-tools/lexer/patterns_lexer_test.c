@@ -0,0 +1,39 @@
+#include <stddef.h>
+
+#include "language-tools/intern.h"
+#include "language-tools/lexer/patterns_lexer.h"
+#include "language-tools/testing/token_testing.h"
+
+static const char *type_name_(int token_type) {
+  return patterns_token_type_to_name(token_type);
+}
+
+// A word longer than any pattern match is not split by REP.
+static void test_longer_word_wins_() {
+  check_tokens(patterns_lexer_tokenize, type_name_, "aaaab", 1,
+               (int[]){TOKEN_WORD}, (const char *[]){"aaaab"}, NULL);
+  check_tokens(patterns_lexer_tokenize, type_name_, "aaab aab", 2,
+               (int[]){REP, REP}, (const char *[]){"aaab", "aab"}, NULL);
+}
+
+static void test_longer_number_or_pattern_wins_() {
+  check_tokens(patterns_lexer_tokenize, type_name_, "1.2.3 1.2", 2,
+               (int[]){VERSION, TOKEN_FLOATING},
+               (const char *[]){"1.2.3", "1.2"}, NULL);
+}
+
+// DASH and SYMBOL_MINUS match the same text, so the pattern wins, but not over
+// the longer SYMBOL_ARROW.
+static void test_patterns_win_ties_() {
+  check_tokens(patterns_lexer_tokenize, type_name_, "- ->", 2,
+               (int[]){DASH, SYMBOL_ARROW}, (const char *[]){"-", "->"}, NULL);
+}
+
+int main(int argc, const char *argv[]) {
+  global_string_intern_pool_init();
+  test_longer_word_wins_();
+  test_longer_number_or_pattern_wins_();
+  test_patterns_win_ties_();
+  global_string_intern_pool_finalize();
+  return 0;
+}
@@ -1,41 +1,237 @@
 #include "language-tools/lexer/token.h"
 
+#include <stdalign.h>
+#include <stdio.h>
 #include <string.h>
 
+#include "language-tools/allocator.h"
 #include "language-tools/intern.h"
-#include "rzalloc/rzalloc.h"
+#include "language-tools/memory_stats.h"
 
 IMPL_ARRAYLIKE(TokenArray, Token *);
 
-static RzallocArena token_arena_;
+#define TOKEN_ARENA_BLOCK_SIZE (64 * 1024)
 
-static bool inited = false;
+struct TokenArenaBlock_ {
+  TokenArenaBlock *next;
+  size_t size;
+  alignas(Token) char data[];
+};
+
+// Holds tokens from token_create(), whose text is interned rather than kept in
+// the arena. Zeroed, as by token_arena_init().
+static TokenArena global_arena_;
+
+// Tokens freed by token_delete(), each holding the next in its storage, to be
+// reused by token_create().
+static Token *free_tokens_ = NULL;
+
+#ifdef LANGUAGE_TOOLS_COMPACT_TOKENS
+static LineTable *lines_for_(const TokenArena *arena) {
+  return NULL == arena ? &global_arena_.lines : (LineTable *)&arena->lines;
+}
+#endif
+
+static void set_position_(const TokenArena *arena, Token *tok, int line,
+                          int col) {
+#ifdef LANGUAGE_TOOLS_COMPACT_TOKENS
+  LineTable *lines = lines_for_(arena);
+  tok->offset = (0 == lines->num_starts
+                     ? 0
+                     : lines->starts[lines->num_starts - 1].offset) +
+                col;
+  tok->starts_line = !lines->line_has_token;
+  lines->line_has_token = true;
+#else
+  tok->line = line;
+  tok->col = col;
+#endif
+}
 
 void token_fill(Token *tok, int type, int line, int col, const char text[],
                 int text_len) {
   tok->type = type;
-  tok->line = line;
-  tok->col = col;
+  set_position_(NULL, tok, line, col);
   tok->len = text_len;
   tok->text = global_intern_range(text, 0, text_len);
+  tok->value.integer = 0;
+}
+
+void token_array_reset(TokenArray *tokens) {
+  // Arraylikes cannot be emptied in place without popping each element.
+  TokenArray_finalize(tokens);
+  TokenArray_init(tokens);
+}
+
+void token_arena_init(TokenArena *arena) {
+  arena->blocks = NULL;
+  arena->block = NULL;
+  arena->block_used = 0;
+#ifdef LANGUAGE_TOOLS_COMPACT_TOKENS
+  arena->lines.starts = NULL;
+  arena->lines.num_starts = 0;
+  arena->lines.starts_capacity = 0;
+  arena->lines.next_offset = 0;
+  arena->lines.line_has_token = false;
+#endif
+}
+
+void token_arena_finalize(TokenArena *arena) {
+  TokenArenaBlock *block = arena->blocks;
+  while (NULL != block) {
+    TokenArenaBlock *next = block->next;
+    const size_t size = sizeof(TokenArenaBlock) + block->size;
+    lt_memory_stats_free(LT_MEMORY_TOKENS, size);
+    lt_free(block, size);
+    block = next;
+  }
+#ifdef LANGUAGE_TOOLS_COMPACT_TOKENS
+  const size_t lines_size = sizeof(LineStart) * arena->lines.starts_capacity;
+  lt_memory_stats_free(LT_MEMORY_TOKENS, lines_size);
+  lt_free(arena->lines.starts, lines_size);
+#endif
+  token_arena_init(arena);
+}
+
+void token_arena_reset(TokenArena *arena) {
+  arena->block = NULL;
+  arena->block_used = 0;
+#ifdef LANGUAGE_TOOLS_COMPACT_TOKENS
+  arena->lines.num_starts = 0;
+  arena->lines.next_offset = 0;
+  arena->lines.line_has_token = false;
+#endif
+}
+
+static void *token_arena_alloc_(TokenArena *arena, size_t size) {
+  size = (size + alignof(Token) - 1) & ~(alignof(Token) - 1);
+  if (NULL == arena->block || arena->block_used + size > arena->block->size) {
+    // Blocks kept by token_arena_reset() are used again before allocating
+    // more.
+    TokenArenaBlock *next =
+        NULL == arena->block ? arena->blocks : arena->block->next;
+    if (NULL == next || next->size < size) {
+      const size_t block_size =
+          size > TOKEN_ARENA_BLOCK_SIZE ? size : TOKEN_ARENA_BLOCK_SIZE;
+      TokenArenaBlock *block = lt_malloc(sizeof(TokenArenaBlock) + block_size);
+      lt_memory_stats_alloc(LT_MEMORY_TOKENS,
+                            sizeof(TokenArenaBlock) + block_size);
+      block->size = block_size;
+      block->next = next;
+      if (NULL == arena->block) {
+        arena->blocks = block;
+      } else {
+        arena->block->next = block;
+      }
+      next = block;
+    }
+    arena->block = next;
+    arena->block_used = 0;
+  }
+  void *ptr = arena->block->data + arena->block_used;
+  arena->block_used += size;
+  return ptr;
+}
+
+Token *token_arena_create(TokenArena *arena, int type, int line, int col,
+                          const char text[], int text_len) {
+  if (NULL == arena) {
+    return token_create(type, line, col, text, text_len);
+  }
+  Token *tok = (Token *)token_arena_alloc_(arena, sizeof(Token));
+  char *tok_text = (char *)token_arena_alloc_(arena, text_len + 1);
+  memcpy(tok_text, text, text_len);
+  tok_text[text_len] = '\0';
+  tok->type = type;
+  set_position_(arena, tok, line, col);
+  tok->len = text_len;
+  tok->text = tok_text;
+  tok->value.integer = 0;
+  return tok;
 }
 
 Token *token_create(int type, int line, int col, const char text[],
                     int text_len) {
-  if (!inited) {
-    arena_init(&token_arena_, sizeof(Token));
-    inited = true;
+  Token *tok;
+  if (NULL != free_tokens_) {
+    tok = free_tokens_;
+    free_tokens_ = *(Token **)tok;
+  } else {
+    tok = (Token *)token_arena_alloc_(&global_arena_, sizeof(Token));
   }
-  Token *tok = (Token *)arena_malloc(&token_arena_);
   token_fill(tok, type, line, col, text, text_len);
   return tok;
 }
 
-void token_delete(Token *token) { arena_free(&token_arena_, token); }
+void token_delete(Token *token) {
+  *(Token **)token = free_tokens_;
+  free_tokens_ = token;
+}
 
-void token_finalize_all() {
-  if (!inited) {
+void token_arena_start_line(TokenArena *arena, int line, int line_len) {
+#ifdef LANGUAGE_TOOLS_COMPACT_TOKENS
+  LineTable *lines = lines_for_(arena);
+  // Token offsets are 32 bits, so they must not wrap around within the line.
+  if ((uint32_t)line_len > UINT32_MAX - lines->next_offset) {
+    fprintf(stderr,
+            "Line %d is past the 4 GiB of input that compact tokens can "
+            "address.\n",
+            line);
+    exit(1);
+  }
+  if (lines->num_starts == lines->starts_capacity) {
+    const size_t old_capacity = lines->starts_capacity;
+    lines->starts_capacity = 0 == old_capacity ? 64 : 2 * old_capacity;
+    lt_memory_stats_resize(LT_MEMORY_TOKENS, sizeof(LineStart) * old_capacity,
+                           sizeof(LineStart) * lines->starts_capacity);
+    lines->starts =
+        lt_realloc(lines->starts, sizeof(LineStart) * old_capacity,
+                   sizeof(LineStart) * lines->starts_capacity);
+  }
+  LineStart *start = &lines->starts[lines->num_starts++];
+  start->offset = lines->next_offset;
+  start->line = line;
+  lines->next_offset += line_len;
+  lines->line_has_token = false;
+#endif
+}
+
+void token_line_col(const TokenArena *arena, const Token *token, int *line,
+                    int *col) {
+#ifdef LANGUAGE_TOOLS_COMPACT_TOKENS
+  const LineTable *lines = lines_for_(arena);
+  if (0 == lines->num_starts) {
+    *line = 0;
+    *col = token->offset;
     return;
   }
-  arena_clear(&token_arena_);
+  // Finds the last line starting at or before the token.
+  size_t low = 0, high = lines->num_starts;
+  while (high - low > 1) {
+    const size_t mid = low + (high - low) / 2;
+    if (lines->starts[mid].offset <= token->offset) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+  *line = lines->starts[low].line;
+  *col = token->offset - lines->starts[low].offset;
+#else
+  *line = token->line;
+  *col = token->col;
+#endif
+}
+
+bool token_on_later_line(const Token *token, const Token *next) {
+#ifdef LANGUAGE_TOOLS_COMPACT_TOKENS
+  return next->starts_line;
+#else
+  return next->line > token->line;
+#endif
+}
+
+void token_finalize_all() {
+  token_arena_finalize(&global_arena_);
+  free_tokens_ = NULL;
 }
\ No newline at end of file
@@ -5,24 +5,116 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "c-data-structures/arraylike.h"
 
+// Build with LANGUAGE_TOOLS_COMPACT_TOKENS defined (--define compact_tokens=true)
+// for tokens that store their offset in the input instead of their line and
+// column, which are found with token_line_col().
 typedef struct {
   int type;
+#ifdef LANGUAGE_TOOLS_COMPACT_TOKENS
+  // Offset from the start of the first line lexed into the token's arena.
+  uint32_t offset;
+  uint32_t len : 31;
+  // Whether the token is the first on its line.
+  uint32_t starts_line : 1;
+#else
   int col, line;
   size_t len;
+#endif
   const char *text;
+  // The decoded value of TOKEN_INTEGER and TOKEN_FLOATING tokens, filled in by
+  // generated lexers so that their text need not be parsed again.
+  union {
+    int64_t integer;
+    double floating;
+  } value;
 } Token;
 
 DEFINE_ARRAYLIKE(TokenArray, Token *);
 
+// How tokens of a type bound a grammar's top-level items, as given by a
+// generated lexer's <prefix>token_type_boundary().
+typedef enum {
+  TOKEN_BOUNDARY_NONE,
+  // Either half of one of the grammar's bracket pairs.
+  TOKEN_BOUNDARY_OPEN,
+  TOKEN_BOUNDARY_CLOSE,
+  // Ends an item when outside of brackets, like ';'.
+  TOKEN_BOUNDARY_END,
+} TokenBoundary;
+
+typedef TokenBoundary (*TokenBoundaryFn)(int token_type);
+
+typedef struct TokenArenaBlock_ TokenArenaBlock;
+
+#ifdef LANGUAGE_TOOLS_COMPACT_TOKENS
+typedef struct {
+  uint32_t offset;
+  int line;
+} LineStart;
+
+// Where each line lexed into an arena starts, in order of offset.
+typedef struct {
+  LineStart *starts;
+  size_t num_starts, starts_capacity;
+  uint32_t next_offset;
+  bool line_has_token;
+} LineTable;
+#endif
+
+// Owns the tokens of one or more documents, such as those lexed by
+// <lexer>_tokenize_in_arena(), so that they can be freed together without
+// affecting any other tokens. Text is copied into the arena rather than
+// interned, so arenas may be filled from different threads.
+typedef struct {
+  // Tokens and their text are taken from blocks, which are kept by
+  // token_arena_reset() until token_arena_finalize().
+  TokenArenaBlock *blocks, *block;
+  size_t block_used;
+#ifdef LANGUAGE_TOOLS_COMPACT_TOKENS
+  LineTable lines;
+#endif
+} TokenArena;
+
+// Creates a token with interned text in a global arena, where token_delete()
+// keeps it to be reused until token_finalize_all() frees them all.
 Token *token_create(int type, int line, int col, const char text[],
                     int text_len);
 void token_fill(Token *tok, int type, int line, int col, const char text[],
                 int text_len);
 void token_delete(Token *tok);
+// Removes every token from tokens in O(1) without deleting them. The array's
+// storage is freed, and grows again as it is filled.
+void token_array_reset(TokenArray *tokens);
+
+void token_arena_init(TokenArena *arena);
+// Frees every token created in arena.
+void token_arena_finalize(TokenArena *arena);
+// Drops every token created in arena in O(1), keeping its storage so that it
+// can be filled again without allocating.
+void token_arena_reset(TokenArena *arena);
+// Creates a token in arena, or with token_create() if arena is NULL.
+Token *token_arena_create(TokenArena *arena, int type, int line, int col,
+                          const char text[], int text_len);
+
+// Called by lexers before creating the tokens of each line of input, which is
+// line_len characters long. Tokens created in arena (or by token_create() if
+// arena is NULL) are on that line until the next call. With compact tokens,
+// exits with an error if the lines started in arena since it was last reset
+// add up to more than 4 GiB.
+void token_arena_start_line(TokenArena *arena, int line, int line_len);
+// Finds the line and column of token, which was created in arena (or by
+// token_create() if arena is NULL).
+void token_line_col(const TokenArena *arena, const Token *token, int *line,
+                    int *col);
+// Whether next, which follows token in the same input, is on a later line.
+bool token_on_later_line(const Token *token, const Token *next);
+// Frees every token from token_create().
 void token_finalize_all();
 
 #ifdef __cplusplus
@@ -0,0 +1,27 @@
+#ifndef COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_LEXER_UNICODE_H_
+#define COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_LEXER_UNICODE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Decodes the UTF-8 sequence at the start of text into *code_point. Returns
+// its length in bytes, or 0 if it is not valid UTF-8.
+int utf8_decode(const char text[], uint32_t *code_point);
+// Counts the code points in text[0, len), which must be valid UTF-8.
+int utf8_count_code_points(const char text[], int len);
+// Whether text[0, len) has only ASCII characters.
+bool is_ascii(const char text[], int len);
+
+// Unicode identifier properties of non-ASCII code points (Unicode 14.0).
+bool is_xid_start(uint32_t code_point);
+bool is_xid_continue(uint32_t code_point);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_LEXER_UNICODE_H_ */
\ No newline at end of file
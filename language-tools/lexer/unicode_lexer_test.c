@@ -0,0 +1,34 @@
+#include "language-tools/intern.h"
+#include "language-tools/lexer/unicode_lexer.h"
+#include "language-tools/testing/token_testing.h"
+
+static const char *type_name_(int token_type) {
+  return unicode_token_type_to_name(token_type);
+}
+
+// Columns count code points, so those after a multibyte character are not
+// offset by its extra bytes.
+static void test_words_and_columns_() {
+  check_tokens(unicode_lexer_tokenize, type_name_,
+               "na\xC3\xAFve -> \xE5\x8F\x98\xE9\x87\x8F(x)\n", 6,
+               (int[]){TOKEN_WORD, SYMBOL_ARROW, TOKEN_WORD, SYMBOL_LPAREN,
+                       TOKEN_WORD, SYMBOL_RPAREN},
+               (const char *[]){"na\xC3\xAFve", "->",
+                                "\xE5\x8F\x98\xE9\x87\x8F", "(", "x", ")"},
+               (int[]){0, 6, 9, 11, 12, 13});
+}
+
+// A keyword followed by an identifier character is part of a longer word.
+static void test_keyword_prefix_() {
+  check_tokens(unicode_lexer_tokenize, type_name_, "if if\xC3\xA9", 2,
+               (int[]){KEYWORD_IF, TOKEN_WORD},
+               (const char *[]){"if", "if\xC3\xA9"}, (int[]){0, 3});
+}
+
+int main(int argc, const char *argv[]) {
+  global_string_intern_pool_init();
+  test_words_and_columns_();
+  test_keyword_prefix_();
+  global_string_intern_pool_finalize();
+  return 0;
+}
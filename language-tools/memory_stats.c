@@ -0,0 +1,100 @@
+#include "language-tools/memory_stats.h"
+
+#include <stdbool.h>
+
+static LtMemoryCounters subsystems_[LT_MEMORY_NUM_SUBSYSTEMS];
+static LtMemoryCounters total_;
+
+static const char *SUBSYSTEM_NAMES_[] = {"tokens", "intern", "syntax_trees",
+                                         "children", "expressions"};
+
+#ifdef LANGUAGE_TOOLS_MEMORY_STATS
+static void raise_peak_(LtMemoryCounters *counters, int64_t live_bytes) {
+  int64_t peak = __atomic_load_n(&counters->peak_bytes, __ATOMIC_RELAXED);
+  while (live_bytes > peak &&
+         !__atomic_compare_exchange_n(&counters->peak_bytes, &peak, live_bytes,
+                                      /*weak=*/true, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+  }
+}
+
+static void add_(LtMemoryCounters *counters, int64_t bytes,
+                 int num_allocations) {
+  if (0 != num_allocations) {
+    __atomic_fetch_add(&counters->num_allocations, num_allocations,
+                       __ATOMIC_RELAXED);
+  }
+  const int64_t live_bytes =
+      __atomic_add_fetch(&counters->live_bytes, bytes, __ATOMIC_RELAXED);
+  if (bytes > 0) {
+    raise_peak_(counters, live_bytes);
+  }
+}
+
+static void record_(LtMemorySubsystem subsystem, int64_t bytes,
+                    int num_allocations) {
+  add_(&subsystems_[subsystem], bytes, num_allocations);
+  add_(&total_, bytes, num_allocations);
+}
+
+void lt_memory_stats_alloc(LtMemorySubsystem subsystem, size_t bytes) {
+  record_(subsystem, bytes, 1);
+}
+
+void lt_memory_stats_resize(LtMemorySubsystem subsystem, size_t old_bytes,
+                            size_t new_bytes) {
+  record_(subsystem, (int64_t)new_bytes - (int64_t)old_bytes,
+          0 == old_bytes ? 1 : 0);
+}
+
+void lt_memory_stats_free(LtMemorySubsystem subsystem, size_t bytes) {
+  record_(subsystem, -(int64_t)bytes, 0);
+}
+#endif
+
+static void load_(const LtMemoryCounters *counters, LtMemoryCounters *copy) {
+  copy->live_bytes = __atomic_load_n(&counters->live_bytes, __ATOMIC_RELAXED);
+  copy->peak_bytes = __atomic_load_n(&counters->peak_bytes, __ATOMIC_RELAXED);
+  copy->num_allocations =
+      __atomic_load_n(&counters->num_allocations, __ATOMIC_RELAXED);
+}
+
+void lt_memory_stats(LtMemoryStats *stats) {
+  for (int i = 0; i < LT_MEMORY_NUM_SUBSYSTEMS; ++i) {
+    load_(&subsystems_[i], &stats->subsystems[i]);
+  }
+  load_(&total_, &stats->total);
+}
+
+static void reset_peak_(LtMemoryCounters *counters) {
+  __atomic_store_n(&counters->peak_bytes,
+                   __atomic_load_n(&counters->live_bytes, __ATOMIC_RELAXED),
+                   __ATOMIC_RELAXED);
+}
+
+void lt_memory_stats_reset_peak() {
+  for (int i = 0; i < LT_MEMORY_NUM_SUBSYSTEMS; ++i) {
+    reset_peak_(&subsystems_[i]);
+  }
+  reset_peak_(&total_);
+}
+
+const char *lt_memory_subsystem_name(LtMemorySubsystem subsystem) {
+  return SUBSYSTEM_NAMES_[subsystem];
+}
+
+static void print_row_(const char name[], const LtMemoryCounters *counters,
+                       FILE *out) {
+  fprintf(out, "%-12s %14lld %14lld %12lld\n", name,
+          (long long)counters->live_bytes, (long long)counters->peak_bytes,
+          (long long)counters->num_allocations);
+}
+
+void lt_memory_stats_print(const LtMemoryStats *stats, FILE *out) {
+  fprintf(out, "%-12s %14s %14s %12s\n", "memory", "live_bytes", "peak_bytes",
+          "allocs");
+  for (int i = 0; i < LT_MEMORY_NUM_SUBSYSTEMS; ++i) {
+    print_row_(SUBSYSTEM_NAMES_[i], &stats->subsystems[i], out);
+  }
+  print_row_("total", &stats->total, out);
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_MEMORY_STATS_H_
+#define COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_MEMORY_STATS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Memory held by the lexer, parser and semantic analyzer, by the subsystem
+// that holds it. Counters are process-wide and may be read at any time; the
+// memory of one document is the difference between snapshots taken before and
+// after it, which only holds while no other document is processed
+// concurrently, including by the workers of parser_parse_parallel() and
+// semantic_analyzer_populate_parallel().
+//
+// Every token, tree and interned string updates shared atomic counters, so
+// they are only compiled in with LANGUAGE_TOOLS_MEMORY_STATS defined (bazel
+// build --define memory_stats=true). Otherwise recording compiles to nothing
+// and the counters stay 0.
+typedef enum {
+  // TokenArena blocks and line tables, and tokens from token_create().
+  LT_MEMORY_TOKENS,
+  // Strings held by the global intern pool.
+  LT_MEMORY_INTERN,
+  // Parser tree blocks, span tokens and parallel parse workers.
+  LT_MEMORY_SYNTAX_TREES,
+  // Children of syntax trees, counted at the most children each tree has
+  // held.
+  LT_MEMORY_SYNTAX_TREE_CHILDREN,
+  // ExpressionTrees and their expressions.
+  LT_MEMORY_EXPRESSION_TREES,
+  LT_MEMORY_NUM_SUBSYSTEMS,
+} LtMemorySubsystem;
+
+typedef struct {
+  int64_t live_bytes;
+  // Most live_bytes since the process started or lt_memory_stats_reset_peak().
+  int64_t peak_bytes;
+  // Buffers allocated, not counting those resized.
+  int64_t num_allocations;
+} LtMemoryCounters;
+
+typedef struct {
+  LtMemoryCounters subsystems[LT_MEMORY_NUM_SUBSYSTEMS];
+  // Over all subsystems. Its peak is of the sum, not the sum of peaks.
+  LtMemoryCounters total;
+} LtMemoryStats;
+
+// Copies the current counters into stats.
+void lt_memory_stats(LtMemoryStats *stats);
+// Lowers every peak to the bytes live now, so that the next snapshot reports
+// the peak since this call.
+void lt_memory_stats_reset_peak();
+const char *lt_memory_subsystem_name(LtMemorySubsystem subsystem);
+// Prints a row of counters per subsystem followed by their total.
+void lt_memory_stats_print(const LtMemoryStats *stats, FILE *out);
+
+#ifdef LANGUAGE_TOOLS_MEMORY_STATS
+// Records that subsystem allocated bytes. Safe to call from any thread.
+void lt_memory_stats_alloc(LtMemorySubsystem subsystem, size_t bytes);
+// Records that a buffer of subsystem was resized from old_bytes to
+// new_bytes. Resizing from 0 bytes counts as an allocation.
+void lt_memory_stats_resize(LtMemorySubsystem subsystem, size_t old_bytes,
+                            size_t new_bytes);
+// Records that subsystem freed bytes.
+void lt_memory_stats_free(LtMemorySubsystem subsystem, size_t bytes);
+#else
+static inline void lt_memory_stats_alloc(LtMemorySubsystem subsystem,
+                                         size_t bytes) {}
+static inline void lt_memory_stats_resize(LtMemorySubsystem subsystem,
+                                          size_t old_bytes, size_t new_bytes) {}
+static inline void lt_memory_stats_free(LtMemorySubsystem subsystem,
+                                        size_t bytes) {}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_MEMORY_STATS_H_ */
\ No newline at end of file
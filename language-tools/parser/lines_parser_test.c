@@ -0,0 +1,32 @@
+#include "language-tools/intern.h"
+#include "language-tools/lexer/token.h"
+#include "language-tools/parser/lines_lexer.h"
+#include "language-tools/parser/lines_parser.h"
+#include "language-tools/parser/parser.h"
+#include "language-tools/testing/check.h"
+#include "language-tools/testing/token_testing.h"
+
+// Blank lines at the start of the file are tokenized as a newline, which is
+// skipped rather than failing to match the first line.
+static void test_skips_leading_newlines_() {
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  tokenize_text(lines_lexer_tokenize, "\n\n+ +\n\n+\n", &tokens);
+  CHECK_EQ_INT(6, TokenArray_size(&tokens));
+
+  Parser parser;
+  parser_init(&parser, rule_line);
+  CHECK(parser_parse(&parser, &tokens)->matched);
+  CHECK_EQ_INT(2, TokenArray_size(&tokens));
+  CHECK(parser_parse(&parser, &tokens)->matched);
+  CHECK(TokenArray_is_empty(&tokens));
+  parser_finalize(&parser);
+  TokenArray_finalize(&tokens);
+}
+
+int main(int argc, const char *argv[]) {
+  global_string_intern_pool_init();
+  test_skips_leading_newlines_();
+  global_string_intern_pool_finalize();
+  return 0;
+}
@@ -1,48 +1,374 @@
 #include "language-tools/parser/parser.h"
 
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "language-tools/allocator.h"
+#include "language-tools/memory_stats.h"
 
 IMPL_ARRAYLIKE(SyntaxTreeArray, SyntaxTree *);
 
+#define SYNTAX_TREE_BLOCK_SIZE 256
+
+struct SyntaxTreeBlock_ {
+  SyntaxTreeBlock *next;
+  SyntaxTree trees[SYNTAX_TREE_BLOCK_SIZE];
+};
+
+struct ParserChunk_ {
+  Parser parser;
+  TokenArray tokens;
+  SyntaxTreeArray items;
+  pthread_t thread;
+  // Whether all of tokens was parsed as items.
+  bool parsed;
+};
+
 SyntaxTree NO_MATCH = {.matched = false, .has_children = false};
 SyntaxTree MATCH_EPSILON = {
     .matched = true, .token = NULL, .has_children = false};
 
-void parser_init(Parser *parser, RuleFn root, bool ignore_newline) {
+static SyntaxTree *match_span_rule_(Parser *parser) { return &NO_MATCH; }
+
+// Returned by rules that matched within a span. Its rule_fn is set so that
+// generated rules never name it.
+static SyntaxTree MATCH_SPAN_ = {
+    .rule_fn = match_span_rule_, .matched = true, .has_children = false};
+
+void parser_init(Parser *parser, RuleFn root) {
   parser->root = root;
-  parser->ignore_newline = ignore_newline;
-  arena_init(&parser->st_arena, sizeof(SyntaxTree));
+  parser->profile = NULL;
+  parser->chunks = NULL;
+  parser->num_chunks = 0;
+  parser->st_blocks = NULL;
+  parser->st_block = NULL;
+  parser->st_block_used = 0;
+  parser->free_trees = NULL;
+  parser->mode = PARSER_MODE_TREE;
+  parser->building = true;
+  parser->span_tokens = NULL;
+  parser->num_span_tokens = 0;
+  parser->span_tokens_capacity = 0;
+  parser->token_boundary = NULL;
+}
+
+void parser_set_token_boundary(Parser *parser, TokenBoundaryFn token_boundary) {
+  parser->token_boundary = token_boundary;
+}
+
+void parser_set_mode(Parser *parser, ParserMode mode) {
+  parser->mode = mode;
+  parser->building = PARSER_MODE_RECOGNIZE != mode;
+}
+
+static SyntaxTree *create_span_(Parser *parser, RuleFn rule_fn,
+                                const char production_name[], int start) {
+  SyntaxTree *st = parser_create_st(parser, rule_fn, production_name);
+  st->matched = true;
+  st->is_span = true;
+  st->span_start = start;
+  st->span_length = parser->num_span_tokens - start;
+  return st;
 }
 
 SyntaxTree *parser_parse(Parser *parser, TokenArray *tokens) {
-  // Remove preceeding newlines.
+  // Remove preceding newlines, which lexers only keep for grammars that match
+  // them.
   while (TokenArray_size(tokens) > 0 &&
          0 == strcmp("\n", TokenArray_get_unchecked(tokens, 0)->text)) {
     TokenArray_pop_front_unchecked(tokens);
   }
   parser->tokens = tokens;
-  return parser->root(parser);
+  const int span_start = parser->num_span_tokens;
+  SyntaxTree *st = parser->root(parser);
+  if (&MATCH_SPAN_ == st) {
+    st = create_span_(parser, parser->root, NULL, span_start);
+  }
+  return st;
 }
 
-void parser_finalize(Parser *parser) { arena_clear(&parser->st_arena); }
+static void free_chunks_(Parser *parser) {
+  for (int i = 0; i < parser->num_chunks; ++i) {
+    ParserChunk *chunk = &parser->chunks[i];
+    parser_finalize(&chunk->parser);
+    TokenArray_finalize(&chunk->tokens);
+    SyntaxTreeArray_finalize(&chunk->items);
+  }
+  const size_t chunks_size = sizeof(ParserChunk) * parser->num_chunks;
+  lt_memory_stats_free(LT_MEMORY_SYNTAX_TREES, chunks_size);
+  lt_free(parser->chunks, chunks_size);
+  parser->chunks = NULL;
+  parser->num_chunks = 0;
+}
 
-Token *parser_next(Parser *parser) {
-  if (TokenArray_is_empty(parser->tokens)) {
-    return NULL;
+void parser_reset(Parser *parser) {
+  free_chunks_(parser);
+  parser->st_block = NULL;
+  parser->st_block_used = 0;
+  parser->free_trees = NULL;
+  parser->num_span_tokens = 0;
+}
+
+void parser_finalize(Parser *parser) {
+  parser_profile_disable(parser);
+  free_chunks_(parser);
+  SyntaxTreeBlock *block = parser->st_blocks;
+  while (NULL != block) {
+    for (int i = 0; i < SYNTAX_TREE_BLOCK_SIZE; ++i) {
+      SyntaxTree *st = &block->trees[i];
+      if (st->children_allocated) {
+        lt_memory_stats_free(LT_MEMORY_SYNTAX_TREE_CHILDREN,
+                             sizeof(SyntaxTree *) * st->num_children_counted);
+        SyntaxTreeArray_finalize(&st->children);
+      }
+    }
+    SyntaxTreeBlock *next = block->next;
+    lt_memory_stats_free(LT_MEMORY_SYNTAX_TREES, sizeof(SyntaxTreeBlock));
+    lt_free(block, sizeof(SyntaxTreeBlock));
+    block = next;
   }
-  if (parser->ignore_newline) {
-    while (true) {
-      if (TokenArray_is_empty(parser->tokens)) {
-        return NULL;
+  parser->st_blocks = NULL;
+  const size_t span_tokens_size =
+      sizeof(Token *) * parser->span_tokens_capacity;
+  lt_memory_stats_free(LT_MEMORY_SYNTAX_TREES, span_tokens_size);
+  lt_free(parser->span_tokens, span_tokens_size);
+  parser->span_tokens = NULL;
+  parser->span_tokens_capacity = 0;
+  parser_reset(parser);
+}
+
+// Parses items until tokens runs out or an item fails to match. An item that
+// matches without consuming any tokens would match forever, so it also stops.
+static bool parse_items_(Parser *parser, TokenArray *tokens,
+                         SyntaxTreeArray *items) {
+  while (!TokenArray_is_empty(tokens)) {
+    const int num_tokens = TokenArray_size(tokens);
+    SyntaxTree *st = parser_parse(parser, tokens);
+    if (!st->matched) {
+      return TokenArray_is_empty(tokens);
+    }
+    if (num_tokens == TokenArray_size(tokens)) {
+      if (&MATCH_EPSILON != st) {
+        parser_delete_st(parser, st);
       }
-      Token *tok = TokenArray_get_unchecked(parser->tokens, 0);
-      if (tok->type == 1 /* TOKEN_NEWLINE */) {
-        TokenArray_pop_front_unchecked(parser->tokens);
-      } else {
+      return false;
+    }
+    SyntaxTreeArray_push_back(items, st);
+  }
+  return true;
+}
+
+static void *parse_chunk_(void *arg) {
+  ParserChunk *chunk = (ParserChunk *)arg;
+  chunk->parsed = parse_items_(&chunk->parser, &chunk->tokens, &chunk->items);
+  return NULL;
+}
+
+// Whether token index is the last on its line, whether or not newlines were
+// kept by the lexer.
+static bool ends_line_(const TokenArray *tokens, int index) {
+  const Token *token = TokenArray_get_unchecked(tokens, index);
+  const Token *next = TokenArray_get_unchecked(tokens, index + 1);
+  return 0 == strcmp("\n", next->text) || token_on_later_line(token, next);
+}
+
+// Chooses where each chunk of tokens ends so that chunks are about the same
+// size and each ends where a top-level item likely does: at a closing bracket
+// or item end at bracket depth 0 that ends its line. Returns the number of
+// chunks.
+static int split_chunks_(const TokenArray *tokens, TokenBoundaryFn boundary,
+                         int max_chunks, int chunk_ends[]) {
+  const int num_tokens = TokenArray_size(tokens);
+  int num_chunks = 0, depth = 0;
+  // Without boundaries, only the last token is known to end an item.
+  if (NULL == boundary) {
+    max_chunks = 1;
+  }
+  for (int i = 0; i < num_tokens - 1 && num_chunks < max_chunks - 1; ++i) {
+    switch (boundary(TokenArray_get_unchecked(tokens, i)->type)) {
+      case TOKEN_BOUNDARY_OPEN:
+        ++depth;
+        continue;
+      case TOKEN_BOUNDARY_CLOSE:
+        --depth;
+        break;
+      case TOKEN_BOUNDARY_END:
         break;
+      default:
+        continue;
+    }
+    if (0 == depth && ends_line_(tokens, i) &&
+        (int64_t)(i + 1) * max_chunks >=
+            (int64_t)(num_chunks + 1) * num_tokens) {
+      chunk_ends[num_chunks++] = i + 1;
+    }
+  }
+  chunk_ends[num_chunks++] = num_tokens;
+  return num_chunks;
+}
+
+// Grows span_tokens to hold num_tokens more.
+static void reserve_span_tokens_(Parser *parser, int num_tokens) {
+  if (parser->num_span_tokens + num_tokens <= parser->span_tokens_capacity) {
+    return;
+  }
+  const int old_capacity = parser->span_tokens_capacity;
+  int capacity = old_capacity > 0 ? 2 * old_capacity : 256;
+  while (capacity < parser->num_span_tokens + num_tokens) {
+    capacity *= 2;
+  }
+  parser->span_tokens_capacity = capacity;
+  lt_memory_stats_resize(LT_MEMORY_SYNTAX_TREES, sizeof(Token *) * old_capacity,
+                         sizeof(Token *) * capacity);
+  parser->span_tokens =
+      lt_realloc(parser->span_tokens, sizeof(Token *) * old_capacity,
+                 sizeof(Token *) * capacity);
+}
+
+// Chunk parsers parse like parser, and profile into their own statistics until
+// parser_parse_parallel() merges them into parser's.
+static void init_chunk_(Parser *parser, ParserChunk *chunk) {
+  parser_init(&chunk->parser, parser->root);
+  parser_set_mode(&chunk->parser, parser->mode);
+  if (NULL != parser->profile) {
+    parser_profile_enable(&chunk->parser, parser->profile->trace);
+  }
+  TokenArray_init(&chunk->tokens);
+  SyntaxTreeArray_init(&chunk->items);
+}
+
+static void shift_spans_(SyntaxTree *st, int offset) {
+  if (st->is_span) {
+    st->span_start += offset;
+    return;
+  }
+  if (!st->has_children) {
+    return;
+  }
+  for (int i = 0; i < SyntaxTreeArray_size(&st->children); ++i) {
+    shift_spans_(SyntaxTreeArray_get_unchecked(&st->children, i), offset);
+  }
+}
+
+// Moves the tokens of spans in the items of chunk to parser, so that they are
+// read with parser_span_token() on parser.
+static void adopt_span_tokens_(Parser *parser, ParserChunk *chunk) {
+  const int num_tokens = chunk->parser.num_span_tokens;
+  if (0 == num_tokens) {
+    return;
+  }
+  reserve_span_tokens_(parser, num_tokens);
+  memcpy(parser->span_tokens + parser->num_span_tokens,
+         chunk->parser.span_tokens, sizeof(Token *) * num_tokens);
+  for (int i = 0; i < SyntaxTreeArray_size(&chunk->items); ++i) {
+    shift_spans_(SyntaxTreeArray_get_unchecked(&chunk->items, i),
+                 parser->num_span_tokens);
+  }
+  parser->num_span_tokens += num_tokens;
+  chunk->parser.num_span_tokens = 0;
+}
+
+// Returns every token held by the chunks, and every token matched in their
+// items, to the end of tokens in order.
+static void unparse_chunks_(Parser *parser, TokenArray *tokens) {
+  for (int i = 0; i < parser->num_chunks; ++i) {
+    ParserChunk *chunk = &parser->chunks[i];
+    for (int j = SyntaxTreeArray_size(&chunk->items) - 1; j >= 0; --j) {
+      parser_delete_st(&chunk->parser,
+                       SyntaxTreeArray_get_unchecked(&chunk->items, j));
+    }
+    while (!TokenArray_is_empty(&chunk->tokens)) {
+      TokenArray_push_back(tokens,
+                           TokenArray_pop_front_unchecked(&chunk->tokens));
+    }
+  }
+  free_chunks_(parser);
+}
+
+SyntaxTree *parser_parse_parallel(Parser *parser, TokenArray *tokens,
+                                  int num_threads) {
+  free_chunks_(parser);
+  const size_t chunk_ends_size =
+      sizeof(int) * (num_threads > 1 ? num_threads : 1);
+  int *chunk_ends = lt_malloc(chunk_ends_size);
+  parser->num_chunks = split_chunks_(tokens, parser->token_boundary,
+                                     num_threads, chunk_ends);
+  parser->chunks = lt_calloc(parser->num_chunks, sizeof(ParserChunk));
+  lt_memory_stats_alloc(LT_MEMORY_SYNTAX_TREES,
+                        sizeof(ParserChunk) * parser->num_chunks);
+  int start = 0;
+  for (int i = 0; i < parser->num_chunks; ++i) {
+    ParserChunk *chunk = &parser->chunks[i];
+    init_chunk_(parser, chunk);
+    for (; start < chunk_ends[i]; ++start) {
+      TokenArray_push_back(&chunk->tokens,
+                           TokenArray_pop_front_unchecked(tokens));
+    }
+  }
+  lt_free(chunk_ends, chunk_ends_size);
+
+  // The calling thread parses the first chunk itself.
+  for (int i = 1; i < parser->num_chunks; ++i) {
+    if (0 != pthread_create(&parser->chunks[i].thread, NULL, parse_chunk_,
+                            &parser->chunks[i])) {
+      fprintf(stderr, "Failed to start parser thread.\n");
+      exit(1);
+    }
+  }
+  parse_chunk_(&parser->chunks[0]);
+  bool parsed = parser->chunks[0].parsed;
+  for (int i = 1; i < parser->num_chunks; ++i) {
+    pthread_join(parser->chunks[i].thread, NULL);
+    parsed = parsed && parser->chunks[i].parsed;
+  }
+  for (int i = 0; NULL != parser->profile && i < parser->num_chunks; ++i) {
+    parser_profile_merge(parser->profile, parser->chunks[i].parser.profile);
+  }
+
+  if (!parsed) {
+    // A chunk was not split between items, so fall back to one worker.
+    unparse_chunks_(parser, tokens);
+    parser->num_chunks = 1;
+    parser->chunks = lt_calloc(1, sizeof(ParserChunk));
+    lt_memory_stats_alloc(LT_MEMORY_SYNTAX_TREES, sizeof(ParserChunk));
+    ParserChunk *chunk = &parser->chunks[0];
+    init_chunk_(parser, chunk);
+    const bool parsed_items =
+        parse_items_(&chunk->parser, tokens, &chunk->items);
+    if (NULL != parser->profile) {
+      parser_profile_merge(parser->profile, chunk->parser.profile);
+    }
+    if (!parsed_items) {
+      for (int j = SyntaxTreeArray_size(&chunk->items) - 1; j >= 0; --j) {
+        parser_delete_st(&chunk->parser,
+                         SyntaxTreeArray_get_unchecked(&chunk->items, j));
       }
+      free_chunks_(parser);
+      return &NO_MATCH;
     }
   }
+
+  SyntaxTree *root = parser_create_st(parser, NULL, "");
+  root->matched = true;
+  // The root holds the items even when parser only recognizes.
+  root->is_span = false;
+  for (int i = 0; i < parser->num_chunks; ++i) {
+    ParserChunk *chunk = &parser->chunks[i];
+    adopt_span_tokens_(parser, chunk);
+    for (int j = 0; j < SyntaxTreeArray_size(&chunk->items); ++j) {
+      syntax_tree_add_child(root,
+                            SyntaxTreeArray_get_unchecked(&chunk->items, j));
+    }
+  }
+  return root;
+}
+
+Token *parser_next(Parser *parser) {
+  if (TokenArray_is_empty(parser->tokens)) {
+    return NULL;
+  }
   return TokenArray_get_unchecked(parser->tokens, 0);
 }
 
@@ -54,56 +380,189 @@ Token *parser_remove(Parser *parser) {
   return token;
 }
 
+static SyntaxTree *alloc_st_(Parser *parser) {
+  SyntaxTree *st = parser->free_trees;
+  if (NULL != st) {
+    parser->free_trees = st->next_free;
+    return st;
+  }
+  if (NULL == parser->st_block ||
+      SYNTAX_TREE_BLOCK_SIZE == parser->st_block_used) {
+    // Blocks kept by parser_reset() are used again before allocating more.
+    SyntaxTreeBlock *next = NULL == parser->st_block ? parser->st_blocks
+                                                     : parser->st_block->next;
+    if (NULL == next) {
+      next = lt_calloc(1, sizeof(SyntaxTreeBlock));
+      lt_memory_stats_alloc(LT_MEMORY_SYNTAX_TREES, sizeof(SyntaxTreeBlock));
+      if (NULL == parser->st_block) {
+        parser->st_blocks = next;
+      } else {
+        parser->st_block->next = next;
+      }
+    }
+    parser->st_block = next;
+    parser->st_block_used = 0;
+  }
+  return &parser->st_block->trees[parser->st_block_used++];
+}
+
+// Frees st, whose children must have been removed.
+static void free_st_(Parser *parser, SyntaxTree *st) {
+  st->next_free = parser->free_trees;
+  parser->free_trees = st;
+}
+
 SyntaxTree *parser_create_st(Parser *parser, RuleFn rule_fn,
                              const char *production_name) {
-  SyntaxTree *st = (SyntaxTree *)arena_malloc(&parser->st_arena);
+  SyntaxTree *st = alloc_st_(parser);
   st->rule_fn = rule_fn;
   st->production_name = production_name;
   st->has_children = false;
   st->token = NULL;
+  // Within a span, the tree only remembers where it started so that its
+  // tokens can be returned if it fails to match.
+  st->is_span = !parser->building;
+  st->span_start = parser->num_span_tokens;
+  st->span_length = 0;
   return st;
 }
 
+// Returns tokens matched within spans after mark to the front of the parser's
+// tokens.
+static void rewind_span_tokens_(Parser *parser, int mark) {
+  while (parser->num_span_tokens > mark) {
+    TokenArray_push_front(parser->tokens,
+                          parser->span_tokens[--parser->num_span_tokens]);
+  }
+}
+
 void parser_delete_st(Parser *parser, SyntaxTree *st) {
+  if (st->is_span) {
+    rewind_span_tokens_(parser, st->span_start);
+    PARSER_PROFILE_NODE_FREED(parser);
+    free_st_(parser, st);
+    return;
+  }
   if (st->has_children) {
-    for (int i = SyntaxTreeArray_size(&st->children) - 1; i >= 0; --i) {
-      SyntaxTree *child = SyntaxTreeArray_get_unchecked(&st->children, i);
+    while (!SyntaxTreeArray_is_empty(&st->children)) {
+      SyntaxTree *child = SyntaxTreeArray_pop_back_unchecked(&st->children);
       if (&MATCH_EPSILON == child) {
         continue;
       }
       parser_delete_st(parser, child);
     }
-    SyntaxTreeArray_finalize(&st->children);
   }
   if (NULL != st->token) {
     TokenArray_push_front(parser->tokens, st->token);
   }
-  arena_free(&parser->st_arena, st);
+  PARSER_PROFILE_NODE_FREED(parser);
+  free_st_(parser, st);
+}
+
+void parser_truncate_st(Parser *parser, SyntaxTree *st, int num_children) {
+  if (!st->has_children) {
+    return;
+  }
+  for (int i = SyntaxTreeArray_size(&st->children) - 1; i >= num_children;
+       --i) {
+    parser_delete_st(parser, SyntaxTreeArray_pop_back_unchecked(&st->children));
+  }
+  if (0 == num_children) {
+    st->has_children = false;
+  }
 }
 
 void syntax_tree_add_child(SyntaxTree *st, SyntaxTree *child) {
   if (&MATCH_EPSILON == child) {
     return;
   }
+  // A match within a span consumed at least one token, which is all the span
+  // needs to know.
+  if (&MATCH_SPAN_ == child) {
+    st->has_children = true;
+    return;
+  }
   if (!st->has_children) {
-    SyntaxTreeArray_init(&st->children);
+    if (!st->children_allocated) {
+      SyntaxTreeArray_init(&st->children);
+      st->children_allocated = true;
+    }
+    // Trees dropped by parser_reset() still hold their old children.
+    while (!SyntaxTreeArray_is_empty(&st->children)) {
+      SyntaxTreeArray_pop_back_unchecked(&st->children);
+    }
     st->has_children = true;
   }
   SyntaxTreeArray_push_back(&st->children, child);
+  const int num_children = SyntaxTreeArray_size(&st->children);
+  if (num_children > st->num_children_counted) {
+    lt_memory_stats_resize(LT_MEMORY_SYNTAX_TREE_CHILDREN,
+                           sizeof(SyntaxTree *) * st->num_children_counted,
+                           sizeof(SyntaxTree *) * num_children);
+    st->num_children_counted = num_children;
+  }
+}
+
+int parser_mark_st(Parser *parser, const SyntaxTree *st) {
+  if (st->is_span) {
+    return parser->num_span_tokens;
+  }
+  return st->has_children ? SyntaxTreeArray_size(&st->children) : 0;
+}
+
+void parser_rewind_st(Parser *parser, SyntaxTree *st, int mark) {
+  if (!st->is_span) {
+    parser_truncate_st(parser, st, mark);
+    return;
+  }
+  rewind_span_tokens_(parser, mark);
+  st->has_children = mark > st->span_start;
+}
+
+SyntaxTree *parser_span_rule(Parser *parser, RuleFn rule_fn,
+                             const char production_name[], RuleFn body) {
+  if (PARSER_MODE_HYBRID != parser->mode || !parser->building) {
+    return body(parser);
+  }
+  const int span_start = parser->num_span_tokens;
+  parser->building = false;
+  SyntaxTree *st = body(parser);
+  parser->building = true;
+  if (&MATCH_SPAN_ != st) {
+    return st;
+  }
+  return create_span_(parser, rule_fn, production_name, span_start);
+}
+
+Token *parser_span_token(const Parser *parser, const SyntaxTree *span,
+                         int index) {
+  return parser->span_tokens[span->span_start + index];
 }
 
 SyntaxTree *parser_prune_st(Parser *p, SyntaxTree *st) {
+  if (st->is_span) {
+    free_st_(p, st);
+    return &MATCH_SPAN_;
+  }
   if (!st->has_children || SyntaxTreeArray_size(&st->children) > 1) {
     return st;
   }
   SyntaxTree *child = SyntaxTreeArray_get_unchecked(&st->children, 0);
   SyntaxTreeArray_pop_back_unchecked(&st->children);
-  parser_delete_st(p, st);
+  // The emptied wrapper is freed directly so that pruning is not counted as
+  // backtracking by the profiler.
+  free_st_(p, st);
   return child;
 }
 
 SyntaxTree *match(Parser *parser, RuleFn rule_fn,
                   const char production_name[]) {
+  if (!parser->building) {
+    reserve_span_tokens_(parser, 1);
+    parser->span_tokens[parser->num_span_tokens++] =
+        TokenArray_pop_front_unchecked(parser->tokens);
+    return &MATCH_SPAN_;
+  }
   SyntaxTree *st = parser_create_st(parser, rule_fn, production_name);
   st->matched = true;
   st->token = TokenArray_pop_front_unchecked(parser->tokens);
@@ -127,6 +586,10 @@ void syntax_tree_print(const SyntaxTree *st, int level, FILE *out) {
   if (NULL != st->production_name) {
     fprintf(out, "[%s] ", st->production_name);
   }
+  if (st->is_span) {
+    fprintf(out, "<%d tokens>", st->span_length);
+    return;
+  }
   if (!st->has_children) {
     if (&MATCH_EPSILON == st) {
       fprintf(out, "E");
@@ -150,28 +613,4 @@ void syntax_tree_print(const SyntaxTree *st, int level, FILE *out) {
   }
   print_tabs_(out, level);
   fprintf(out, "}");
-}
-
-SyntaxTree *parser_prune_newlines(Parser *p, SyntaxTree *st) {
-  if (&NO_MATCH == st || !st->has_children) {
-    return st;
-  }
-  int i;
-  for (i = SyntaxTreeArray_size(&st->children) - 1; i >= 0; --i) {
-    SyntaxTree *st_child = SyntaxTreeArray_get_unchecked(&st->children, i);
-    if (st_child->has_children) {
-      *SyntaxTreeArray_mutable_ref_unchecked(&st->children, i) =
-          parser_prune_newlines(p, st_child);
-    } else if (1 /*TOKEN_NEWLINE*/ == st_child->token->type) {
-      arena_free(&p->st_arena, st_child);
-      SyntaxTreeArray_remove_unchecked(&st->children, i);
-    }
-  }
-  if (1 == SyntaxTreeArray_size(&st->children)) {
-    SyntaxTree *child = SyntaxTreeArray_get_unchecked(&st->children, 0);
-    SyntaxTreeArray_finalize(&st->children);
-    arena_free(&p->st_arena, st);
-    return child;
-  }
-  return st;
 }
\ No newline at end of file
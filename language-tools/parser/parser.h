@@ -9,47 +9,141 @@ extern "C" {
 
 #include "c-data-structures/arraylike.h"
 #include "language-tools/lexer/token.h"
-#include "rzalloc/rzalloc.h"
+#include "language-tools/parser/parser_profile.h"
 
 typedef struct SyntaxTree_ SyntaxTree;
 typedef struct Parser_ Parser;
+typedef struct ParserChunk_ ParserChunk;
+typedef struct SyntaxTreeBlock_ SyntaxTreeBlock;
 
 typedef SyntaxTree *(*RuleFn)(Parser *parser);
 
 DEFINE_ARRAYLIKE(SyntaxTreeArray, SyntaxTree *);
 
+typedef enum {
+  // Builds a node for every rule and token matched.
+  PARSER_MODE_TREE,
+  // Only checks that the input matches. parser_parse() returns a single span
+  // node covering the tokens matched by the root.
+  PARSER_MODE_RECOGNIZE,
+  // Builds nodes for rules generated as materialized. Any other rule matched
+  // outside of a span becomes a span node, and nothing is built within it.
+  PARSER_MODE_HYBRID,
+} ParserMode;
+
 struct SyntaxTree_ {
   RuleFn rule_fn;
   const char *production_name;
   bool matched, has_children;
-  Token *token;
+  // Whether children has been initialized. Its storage is kept while the
+  // tree is freed so that it can be reused.
+  bool children_allocated;
+  // The most children this tree has held, as counted toward
+  // LT_MEMORY_SYNTAX_TREE_CHILDREN.
+  int num_children_counted;
+  union {
+    Token *token;
+    // Next in the parser's list of freed trees.
+    SyntaxTree *next_free;
+  };
   SyntaxTreeArray children;
+  // A span has no children or token; its span_length tokens are read with
+  // parser_span_token().
+  bool is_span;
+  int span_start, span_length;
 };
 
 struct Parser_ {
-  RzallocArena st_arena;
+  // Trees are taken from st_blocks, which are kept until parser_finalize(),
+  // or reused from free_trees.
+  SyntaxTreeBlock *st_blocks, *st_block;
+  int st_block_used;
+  SyntaxTree *free_trees;
   RuleFn root;
   TokenArray *tokens;
-  bool ignore_newline;
+  ParserMode mode;
+  // Whether rules currently build nodes rather than extend a span.
+  bool building;
+  // Tokens matched within spans, in order.
+  Token **span_tokens;
+  int num_span_tokens, span_tokens_capacity;
+  ParserProfile *profile;
+  // Workers of parser_parse_parallel(), which own the trees it returns.
+  ParserChunk *chunks;
+  int num_chunks;
+  // Where parser_parse_parallel() may split tokens, or NULL for nowhere.
+  TokenBoundaryFn token_boundary;
 };
 
 extern SyntaxTree NO_MATCH;
 extern SyntaxTree MATCH_EPSILON;
 
-void parser_init(Parser *parser, RuleFn root, bool ignore_newline);
+// Newlines are matched like any other token. Generated lexers only emit them
+// for grammars that match them, and parser_parse() skips those before an item.
+void parser_init(Parser *parser, RuleFn root);
+// Defaults to PARSER_MODE_TREE. Must not be called while parser holds trees.
+void parser_set_mode(Parser *parser, ParserMode mode);
 SyntaxTree *parser_parse(Parser *parser, TokenArray *tokens);
+// Sets how parser_parse_parallel() finds the grammar's brackets and item ends,
+// usually to the generated lexer's <prefix>token_type_boundary().
+void parser_set_token_boundary(Parser *parser, TokenBoundaryFn token_boundary);
+// Parses tokens as a sequence of top-level items, each matched by the root
+// rule, on up to num_threads threads. tokens is split where a closing bracket
+// or item end returns to bracket depth 0, as told by the parser's token
+// boundary, and each chunk is parsed by its own worker parser. Without a token
+// boundary, tokens are parsed as one chunk. If any chunk does not parse as
+// whole items, everything is parsed again sequentially. Returns a tree whose
+// children are the items in order, or NO_MATCH with tokens left in place if
+// tokens are not all items. The result is freed by parser_finalize() and must
+// not be passed to parser_delete_st(). Worker parsers use parser's mode, and
+// their span tokens are read with parser_span_token() on parser. If parser is
+// profiled, so are the workers, and their statistics are added to parser's
+// profile.
+SyntaxTree *parser_parse_parallel(Parser *parser, TokenArray *tokens,
+                                  int num_threads);
+// Frees every tree created by parser in O(1), including any returned by
+// parser_parse_parallel(), while keeping their storage for later parses. Unlike
+// parser_delete_st(), tokens held by the trees are not returned to the token
+// array and remain owned by the caller.
+void parser_reset(Parser *parser);
 void parser_finalize(Parser *parser);
 Token *parser_next(Parser *parser);
 SyntaxTree *parser_create_st(Parser *parser, RuleFn rule_fn,
                              const char production_name[]);
 void parser_delete_st(Parser *parser, SyntaxTree *st);
 SyntaxTree *parser_prune_st(Parser *p, SyntaxTree *st);
+// Deletes children of st beyond the first num_children, returning their
+// tokens to the parser.
+void parser_truncate_st(Parser *parser, SyntaxTree *st, int num_children);
 void syntax_tree_add_child(SyntaxTree *st, SyntaxTree *child);
+// Returns a position in st that parser_rewind_st() can later return to,
+// deleting what was added since. Used by generated rules to backtrack.
+int parser_mark_st(Parser *parser, const SyntaxTree *st);
+void parser_rewind_st(Parser *parser, SyntaxTree *st, int mark);
+// Invokes body, the body of rule_fn, which is not materialized. In
+// PARSER_MODE_HYBRID, if no span is being built, a match is returned as a span
+// node. Called by generated rules.
+SyntaxTree *parser_span_rule(Parser *parser, RuleFn rule_fn,
+                             const char production_name[], RuleFn body);
+// Returns token index of span, which must have been parsed by parser.
+Token *parser_span_token(const Parser *parser, const SyntaxTree *span,
+                         int index);
 SyntaxTree *match(Parser *parser, RuleFn rule_fn, const char production_name[]);
 
 void syntax_tree_print(const SyntaxTree *st, int level, FILE *out);
 
-SyntaxTree *parser_prune_newlines(Parser *p, SyntaxTree *st);
+// Starts collecting per-rule statistics on the parser. When trace is true,
+// every rule invocation is also recorded for parser_profile_dump_trace().
+void parser_profile_enable(Parser *parser, bool trace);
+void parser_profile_disable(Parser *parser);
+// Invokes rule_fn while recording its statistics under rule_index. Called by
+// generated rules when LANGUAGE_TOOLS_PARSER_PROFILE is defined.
+SyntaxTree *parser_profile_rule(Parser *parser, int rule_index,
+                                const char rule_name[], RuleFn rule_fn);
+// Prints a table of rule statistics, sorted by inclusive time.
+void parser_profile_dump(Parser *parser, FILE *out);
+// Writes recorded rule invocations in Chrome trace-event JSON format.
+void parser_profile_dump_trace(Parser *parser, FILE *out);
 
 #ifdef __cplusplus
 }
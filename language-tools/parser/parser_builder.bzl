@@ -12,6 +12,12 @@ def _parser_builder_impl(ctx):
         h_file = out_file_name.replace(".c", ".h")
         lexer_h_file = "%s/%s.h" % (ctx.attr.lexer.label.package, ctx.attr.lexer.label.name)
         args.add_all([h_file, lexer_h_file])
+    if ctx.attr.root:
+        args.add("--root=%s" % ctx.attr.root)
+    if ctx.attr.materialized:
+        args.add("--materialized=%s" % ",".join(ctx.attr.materialized))
+    if ctx.attr.grammar_errors:
+        args.add("--grammar_errors")
     ctx.actions.run(
         mnemonic = "ParserBuilder",
         executable = ctx.executable.parser_builder_main,
@@ -37,6 +43,18 @@ _parser_builder = rule(
             doc = "rules txt file.",
         ),
         "lexer": attr.label(),
+        "root": attr.string(
+            default = "",
+            doc = "root rule used to find unreachable rules during grammar analysis.",
+        ),
+        "materialized": attr.string_list(
+            default = [],
+            doc = "rules that build syntax tree nodes in PARSER_MODE_HYBRID. If empty, all rules do.",
+        ),
+        "grammar_errors": attr.bool(
+            default = False,
+            doc = "should grammar analysis findings fail the build.",
+        ),
         "parser_builder_main": attr.label(
             default = Label("//language-tools/parser/production_parser:production_parser_main"),
             executable = True,
@@ -46,17 +64,23 @@ _parser_builder = rule(
     },
 )
 
-def parser_builder(name, rules, lexer):
+def parser_builder(name, rules, lexer, root = None, materialized = [], grammar_errors = False):
     _parser_builder(
         name = "%s_h" % name,
         header = True,
         rules = rules,
         lexer = lexer,
+        root = root,
+        materialized = materialized,
+        grammar_errors = grammar_errors,
     )
     _parser_builder(
         name = "%s_c" % name,
         rules = rules,
         lexer = lexer,
+        root = root,
+        materialized = materialized,
+        grammar_errors = grammar_errors,
     )
     return cc_library(
         name = name,
@@ -13,6 +13,9 @@ IMPL_ARRAYLIKE(ProductionArray, Production *);
 DEFINE_MAPLIKE(ProductionMap, char *, Production *);
 IMPL_MAPLIKE(ProductionMap, char *, Production *);
 
+DEFINE_MAPLIKE(RuleNameSet, char *, bool);
+IMPL_MAPLIKE(RuleNameSet, char *, bool);
+
 uint32_t string_ptr_hasher_(const char *ptr, uint32_t size) {
   return (uint32_t)(intptr_t)ptr;
 }
@@ -37,6 +40,9 @@ typedef enum {
 typedef struct Production_ {
   bool exclude_from_header;
   ProductionType type;
+  // Name of the helper function generated for this production, which may be
+  // shared with structurally identical productions elsewhere in the grammar.
+  const char *helper_name;
   union {
     ProductionArray children;
     const char *token;
@@ -46,12 +52,16 @@ typedef struct Production_ {
 
 typedef struct ParserBuilder_ {
   ProductionMap rules;
+  // Rules that build nodes in PARSER_MODE_HYBRID. If empty, all rules do.
+  RuleNameSet materialized;
+  int num_materialized;
 } ParserBuilder;
 
 Production *production_create_(ProductionType type) {
   Production *p = malloc(sizeof(Production));
   p->type = type;
   p->exclude_from_header = false;
+  p->helper_name = NULL;
   return p;
 }
 
@@ -113,7 +123,7 @@ Production *and__(int arg_count, ...) {
 
 Production *token(const char token[]) {
   Production *p = production_create_(PRODUCTION_TOKEN);
-  p->token = token;
+  p->token = global_intern(token);
   return p;
 }
 
@@ -172,9 +182,50 @@ void production_print_(const Production *p, FILE *out) {
   fprintf(out, ")");
 }
 
+bool production_equals_(const Production *p1, const Production *p2) {
+  if (p1->type != p2->type) {
+    return false;
+  }
+  switch (p1->type) {
+    case PRODUCTION_EPSILON:
+      return true;
+    case PRODUCTION_TOKEN:
+      return p1->token == p2->token;
+    case PRODUCTION_RULE:
+      return p1->rule_name == p2->rule_name;
+    default:
+      break;
+  }
+  if (ProductionArray_size(&p1->children) !=
+      ProductionArray_size(&p2->children)) {
+    return false;
+  }
+  for (int i = 0; i < ProductionArray_size(&p1->children); ++i) {
+    if (!production_equals_(ProductionArray_get_unchecked(&p1->children, i),
+                            ProductionArray_get_unchecked(&p2->children, i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Number of elements an alternative of an OR is parsed as.
+int alternative_length_(const Production *p) {
+  return PRODUCTION_AND == p->type ? ProductionArray_size(&p->children) : 1;
+}
+
+const Production *alternative_element_(const Production *p, int index) {
+  return PRODUCTION_AND == p->type
+             ? ProductionArray_get_unchecked(&p->children, index)
+             : p;
+}
+
 ParserBuilder *parser_builder_create() {
   ParserBuilder *pb = malloc(sizeof(ParserBuilder));
   ProductionMap_init(&pb->rules, string_ptr_hasher_, string_ptr_comparator_);
+  RuleNameSet_init(&pb->materialized, string_ptr_hasher_,
+                   string_ptr_comparator_);
+  pb->num_materialized = 0;
   return pb;
 }
 
@@ -189,6 +240,32 @@ void parser_builder_rule(ParserBuilder *pb, const char rule_name[],
   ProductionMap_insert(&pb->rules, interned_rule_name, sizeof(char *), p);
 }
 
+void parser_builder_materialize(ParserBuilder *pb, const char rule_name[]) {
+  const char *interned_rule_name = global_intern(rule_name);
+  if (NULL == ProductionMap_find(&pb->rules, interned_rule_name, sizeof(char *),
+                                 NULL)) {
+    fprintf(stderr, "Cannot materialize unknown rule '%s'.\n", rule_name);
+    exit(1);
+  }
+  bool found = false;
+  RuleNameSet_find(&pb->materialized, interned_rule_name, sizeof(char *),
+                   &found);
+  if (!found) {
+    RuleNameSet_insert(&pb->materialized, interned_rule_name, sizeof(char *),
+                       true);
+    ++pb->num_materialized;
+  }
+}
+
+bool is_spanned_rule_(ParserBuilder *pb, const char rule_name[]) {
+  if (0 == pb->num_materialized) {
+    return false;
+  }
+  bool found = false;
+  RuleNameSet_find(&pb->materialized, rule_name, sizeof(char *), &found);
+  return !found;
+}
+
 void parser_builder_delete(ParserBuilder *pb) {
   ProductionMapIterator iter;
   ProductionMap_iterator(&iter, &pb->rules);
@@ -196,6 +273,7 @@ void parser_builder_delete(ParserBuilder *pb) {
     production_delete_(*ProductionMap_mutable_value(&iter));
   }
   ProductionMap_finalize(&pb->rules);
+  RuleNameSet_finalize(&pb->materialized);
   free(pb);
 }
 
@@ -207,14 +285,60 @@ const char *create_rule_function_name_(const char *production_name) {
 
 void write_rule_signature_(const char *production_name, const Production *p,
                            bool is_named_rule, FILE *file) {
-  // if (!is_named_rule) {
-  //   fprintf(file, "inline ");
-  // }
   fprintf(file, "SyntaxTree *");
   fprintf(file, "%s", create_rule_function_name_(production_name));
   fprintf(file, "(Parser *parser)");
 }
 
+// When the generated parser is compiled with LANGUAGE_TOOLS_PARSER_PROFILE,
+// each named rule becomes a thin wrapper that records statistics around the
+// rule body. Otherwise the body is emitted under the rule's own name.
+void write_profiled_rule_signature_(const char *production_name,
+                                    const Production *p, int rule_index,
+                                    FILE *file) {
+  const char *rule_fn_name = create_rule_function_name_(production_name);
+  fprintf(file,
+          "#ifdef LANGUAGE_TOOLS_PARSER_PROFILE\n"
+          "static SyntaxTree *%s__body(Parser *parser);\n",
+          rule_fn_name);
+  write_rule_signature_(production_name, p, true, file);
+  fprintf(file,
+          " {\n"
+          "  return parser_profile_rule(parser, %d, \"%s\", %s__body);\n"
+          "}\n"
+          "static SyntaxTree *%s__body(Parser *parser)\n"
+          "#else\n",
+          rule_index, production_name, rule_fn_name, rule_fn_name);
+  write_rule_signature_(production_name, p, true, file);
+  fprintf(file, "\n#endif\n");
+}
+
+// A rule that is not materialized is wrapped by parser_span_rule(), which turns
+// it into a span in PARSER_MODE_HYBRID.
+void write_spanned_rule_signature_(const char *production_name, int rule_index,
+                                   FILE *file) {
+  const char *rule_fn_name = create_rule_function_name_(production_name);
+  fprintf(file,
+          "static SyntaxTree *%s__body(Parser *parser);\n"
+          "#ifdef LANGUAGE_TOOLS_PARSER_PROFILE\n"
+          "static SyntaxTree *%s__profiled(Parser *parser) {\n"
+          "  return parser_profile_rule(parser, %d, \"%s\", %s__body);\n"
+          "}\n"
+          "SyntaxTree *%s(Parser *parser) {\n"
+          "  return parser_span_rule(parser, %s, \"%s\", %s__profiled);\n"
+          "}\n"
+          "#else\n"
+          "SyntaxTree *%s(Parser *parser) {\n"
+          "  return parser_span_rule(parser, %s, \"%s\", %s__body);\n"
+          "}\n"
+          "#endif\n"
+          "static SyntaxTree *%s__body(Parser *parser)\n",
+          rule_fn_name, rule_fn_name, rule_index, production_name,
+          rule_fn_name, rule_fn_name, rule_fn_name, production_name,
+          rule_fn_name, rule_fn_name, rule_fn_name, production_name,
+          rule_fn_name, rule_fn_name);
+}
+
 const char *suffix_for_(const Production *p) {
   return PRODUCTION_TOKEN == p->type      ? "token"
          : PRODUCTION_AND == p->type      ? "and"
@@ -253,6 +377,133 @@ bool is_helper_rule_(const char production_name[]) {
          find_str((char *)production_name, strlen(production_name), "__", 2);
 }
 
+// Whether production_name is a token helper whose match is left unnamed, so
+// that the enclosing rule names it.
+bool is_unnamed_token_helper_(const char production_name[]) {
+  const size_t len = strlen(production_name);
+  return len > strlen("__token") &&
+         0 == strncmp("__token", production_name + len - strlen("__token") - 1,
+                      strlen("__token"));
+}
+
+// Unnamed token leaves are matched inline in their parent's body rather than
+// through a helper function of their own.
+bool is_inlined_token_(const char production_name[], const Production *p) {
+  return PRODUCTION_TOKEN == p->type &&
+         is_unnamed_token_helper_(production_name);
+}
+
+// Helper sharing.
+//
+// Helpers for structurally identical productions are generated once. Every
+// helper keeps a function under its own name, which calls the shared body.
+// Shared bodies therefore never name the SyntaxTree they return; where a
+// helper's name belongs in the tree (ORs and optional tokens), its own function
+// applies it instead, so that the tree names the same function it was matched
+// by.
+
+DEFINE_MAPLIKE(HelperNameMap, char *, char *);
+IMPL_MAPLIKE(HelperNameMap, char *, char *);
+
+const Production *production_strip_optional_(const Production *p) {
+  while (PRODUCTION_OPTIONAL == p->type) {
+    p = ProductionArray_get_unchecked(&p->children, 0);
+  }
+  return p;
+}
+
+// Interned string uniquely describing the code generated for p as a helper.
+const char *helper_key_(const Production *p) {
+  char *buffer;
+  size_t len;
+  FILE *key = open_memstream(&buffer, &len);
+  production_print_(production_strip_optional_(p), key);
+  fclose(key);
+  const char *interned = global_intern_range(buffer, 0, len);
+  free(buffer);
+  return interned;
+}
+
+// Assigns the helper for p. Returns false if an identical helper has already
+// been generated, in which case p reuses it.
+bool share_helper_(HelperNameMap *helpers, const char *production_name,
+                   const Production *p) {
+  const char *key = helper_key_(p);
+  const char *helper_name =
+      HelperNameMap_find(helpers, key, sizeof(char *), NULL);
+  const bool is_new = NULL == helper_name;
+  if (is_new) {
+    helper_name = production_name;
+    HelperNameMap_insert(helpers, key, sizeof(char *), (char *)helper_name);
+  }
+  // Productions are only annotated here, while code is generated.
+  ((Production *)p)->helper_name = helper_name;
+  return is_new;
+}
+
+// Whether the helper named production_name for p names the SyntaxTree it
+// returns.
+bool helper_names_result_(const char *production_name, const Production *p) {
+  const Production *generated = production_strip_optional_(p);
+  return PRODUCTION_OR == generated->type ||
+         (PRODUCTION_TOKEN == generated->type &&
+          !is_unnamed_token_helper_(production_name));
+}
+
+// Name of the function holding the body of the helper for p.
+const char *helper_body_name_(const Production *p) {
+  const char *helper_fn_name = create_rule_function_name_(p->helper_name);
+  if (!helper_names_result_(p->helper_name, p)) {
+    return helper_fn_name;
+  }
+  char buffer[128];
+  const int len =
+      snprintf(buffer, sizeof(buffer), "%s__shared", helper_fn_name);
+  return global_intern_range(buffer, 0, len);
+}
+
+// Writes the function of the helper named production_name, which calls the
+// shared body of the helper for p.
+void write_helper_entry_(const char *production_name, const Production *p,
+                         FILE *file) {
+  const char *rule_fn_name = create_rule_function_name_(production_name);
+  if (!helper_names_result_(production_name, p)) {
+    fprintf(file,
+            "SyntaxTree *%s(Parser *parser) {\n"
+            "  return %s(parser);\n"
+            "}\n\n",
+            rule_fn_name, helper_body_name_(p));
+    return;
+  }
+  // MATCH_EPSILON is shared, so it is never named.
+  fprintf(file,
+          "SyntaxTree *%s(Parser *parser) {\n"
+          "  SyntaxTree *st = %s(parser);\n"
+          "  if (st->matched && &MATCH_EPSILON != st &&\n"
+          "      NULL == st->rule_fn) {\n"
+          "    st->rule_fn = %s;\n"
+          "    st->production_name = \"%s\";\n"
+          "  }\n"
+          "  return st;\n"
+          "}\n\n",
+          rule_fn_name, helper_body_name_(p), rule_fn_name, production_name);
+}
+
+// Like print_child_function_call_(), but inlines token leaves. The caller must
+// have declared `Token *token` when is_inlined_token_() holds.
+static void print_child_match_(const char *production_name,
+                               const Production *p, FILE *file) {
+  if (!is_inlined_token_(production_name, p)) {
+    print_child_function_call_(production_name, p, file);
+    return;
+  }
+  fprintf(file,
+          "(NULL != (token = parser_next(parser)) && %s == token->type)\n"
+          "        ? match(parser, NULL, NULL)\n"
+          "        : &NO_MATCH;\n",
+          p->token);
+}
+
 void write_and_body_(const char *production_name, const Production *p,
                      FILE *file) {
   if (is_helper_rule_(production_name)) {
@@ -268,20 +519,22 @@ void write_and_body_(const char *production_name, const Production *p,
   for (; ProductionArray_has_next(&children); ProductionArray_next(&children)) {
     ++child_index;
     const Production *p_child = *ProductionArray_value(&children);
-    fprintf(file, "  {\n    SyntaxTree *st_child = ");
+    const char *child_name = production_name_with_child_suffix_(
+        production_name, p_child, child_index);
+    fprintf(file, "  {\n");
+    if (is_inlined_token_(child_name, p_child)) {
+      fprintf(file, "    Token *token;\n");
+    }
+    fprintf(file, "    SyntaxTree *st_child = ");
 
     if (PRODUCTION_OPTIONAL == p_child->type) {
-      print_child_function_call_(production_name_with_child_suffix_(
-                                     production_name, p_child, child_index),
-                                 p_child, file);
+      print_child_match_(child_name, p_child, file);
       fprintf(file,
               "    if (st_child->matched) {\n"
               "       syntax_tree_add_child(st, st_child);"
               "    }\n  }\n");
     } else {
-      print_child_function_call_(production_name_with_child_suffix_(
-                                     production_name, p_child, child_index),
-                                 p_child, file);
+      print_child_match_(child_name, p_child, file);
       fprintf(file,
               "    if (!st_child->matched) {\n"
               "      parser_delete_st(parser, st);\n"
@@ -297,56 +550,313 @@ void write_and_body_(const char *production_name, const Production *p,
           "  st->matched = true;\n  return parser_prune_st(parser, st);\n");
 }
 
+void write_rule_and_subrules_(const char *production_name, const Production *p,
+                              bool is_named_rule, int rule_index, bool spanned,
+                              HelperNameMap *helpers, FILE *file);
+
+// Left-factoring.
+//
+// Consecutive OR alternatives that begin with the same tokens and rules are
+// generated so that the shared prefix is matched once, after which each
+// alternative's remaining elements are tried in order. The resulting
+// SyntaxTree is identical to parsing each alternative on its own.
+
+bool is_factorable_element_(const Production *p) {
+  return PRODUCTION_TOKEN == p->type || PRODUCTION_RULE == p->type ||
+         PRODUCTION_EPSILON == p->type;
+}
+
+bool is_factorable_alternative_(const Production *p) {
+  return PRODUCTION_AND == p->type || PRODUCTION_TOKEN == p->type ||
+         PRODUCTION_RULE == p->type;
+}
+
+// Name of the helper for element index of the alternative named alt_name.
+const char *alternative_element_name_(const char *alt_name,
+                                      const Production *alt, int index) {
+  return PRODUCTION_AND == alt->type
+             ? production_name_with_child_suffix_(
+                   alt_name, alternative_element_(alt, index), index)
+             : alt_name;
+}
+
+// Returns the end (exclusive) of the run of alternatives of p beginning at
+// start that share a prefix, and sets *prefix_len to the prefix length. A run
+// of a single alternative is not factored.
+//
+// Returns 0 if the alternative at start should be called as a function
+// instead. An unfactored sequence is returned as a run of one with no prefix,
+// which inlines it into the OR in place of its __and helper.
+int factored_group_end_(const Production *p, int start, int *prefix_len) {
+  const int num_alternatives = ProductionArray_size(&p->children);
+  const Production *first = ProductionArray_get_unchecked(&p->children, start);
+  *prefix_len = 0;
+  if (!is_factorable_alternative_(first)) {
+    return PRODUCTION_AND == first->type ? start + 1 : 0;
+  }
+  int prefix = 0;
+  while (prefix < alternative_length_(first) &&
+         is_factorable_element_(alternative_element_(first, prefix))) {
+    ++prefix;
+  }
+  int end = start + 1;
+  for (; end < num_alternatives; ++end) {
+    const Production *alt = ProductionArray_get_unchecked(&p->children, end);
+    if (!is_factorable_alternative_(alt)) {
+      break;
+    }
+    int common = 0, weight = 0;
+    while (common < prefix && common < alternative_length_(alt) &&
+           production_equals_(alternative_element_(first, common),
+                              alternative_element_(alt, common))) {
+      if (PRODUCTION_EPSILON != alternative_element_(alt, common)->type) {
+        ++weight;
+      }
+      ++common;
+    }
+    if (0 == weight) {
+      break;
+    }
+    prefix = common;
+  }
+  if (end - start < 2) {
+    return PRODUCTION_AND == first->type ? start + 1 : 0;
+  }
+  *prefix_len = prefix;
+  return end;
+}
+
+// Whether any element matched by write_factored_alternatives_() is an inlined
+// token.
+bool factored_alternatives_inline_tokens_(const char *production_name,
+                                          const Production *p, int start,
+                                          int end) {
+  for (int alt_index = start; alt_index < end; ++alt_index) {
+    const Production *alt =
+        ProductionArray_get_unchecked(&p->children, alt_index);
+    const char *alt_name =
+        production_name_with_child_suffix_(production_name, alt, alt_index);
+    for (int i = 0; i < alternative_length_(alt); ++i) {
+      if (is_inlined_token_(alternative_element_name_(alt_name, alt, i),
+                            alternative_element_(alt, i))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Writes code that matches element index of alt into st, indented by indent.
+// On failure jumps to fail_label and returns true, so the caller knows the
+// label is used.
+bool write_factored_element_(const char *alt_name, const Production *alt,
+                             int index, const char indent[],
+                             const char fail_label[], int label_id,
+                             FILE *file) {
+  const Production *element = alternative_element_(alt, index);
+  if (PRODUCTION_EPSILON == element->type) {
+    return false;
+  }
+  fprintf(file, "%sst_child = ", indent);
+  print_child_match_(alternative_element_name_(alt_name, alt, index), element,
+                     file);
+  if (PRODUCTION_OPTIONAL == element->type) {
+    fprintf(file,
+            "%sif (st_child->matched) {\n"
+            "%s  syntax_tree_add_child(st, st_child);\n"
+            "%s}\n",
+            indent, indent, indent);
+    return false;
+  }
+  fprintf(file,
+          "%sif (!st_child->matched) {\n"
+          "%s  goto %s%d;\n"
+          "%s}\n"
+          "%ssyntax_tree_add_child(st, st_child);\n",
+          indent, indent, fail_label, label_id, indent, indent);
+  return true;
+}
+
+void write_factored_alternatives_(const char *production_name,
+                                  const Production *p, int start, int end,
+                                  int prefix_len, FILE *file) {
+  const Production *first = ProductionArray_get_unchecked(&p->children, start);
+  const char *first_name =
+      production_name_with_child_suffix_(production_name, first, start);
+  fprintf(file, "  {\n");
+  if (prefix_len > 0) {
+    fprintf(file, "    // Alternatives %d-%d share a %d-element prefix.\n",
+            start, end - 1, prefix_len);
+  }
+  fprintf(file,
+          "    SyntaxTree *st = parser_create_st(parser, NULL, \"\");\n"
+          "    SyntaxTree *st_child;\n");
+  if (factored_alternatives_inline_tokens_(production_name, p, start, end)) {
+    fprintf(file, "    Token *token;\n");
+  }
+  bool prefix_label_used = false;
+  for (int i = 0; i < prefix_len; ++i) {
+    prefix_label_used |= write_factored_element_(
+        first_name, first, i, "    ", "prefix_failed", start, file);
+  }
+  for (int alt_index = start; alt_index < end; ++alt_index) {
+    const Production *alt =
+        ProductionArray_get_unchecked(&p->children, alt_index);
+    const char *alt_name =
+        production_name_with_child_suffix_(production_name, alt, alt_index);
+    fprintf(file,
+            "    {\n"
+            "      const int prefix_mark = parser_mark_st(parser, st);\n");
+    bool alt_label_used = false;
+    for (int i = prefix_len; i < alternative_length_(alt); ++i) {
+      alt_label_used |=
+          write_factored_element_(alt_name, alt, i, "      ",
+                                  "alternative_failed", alt_index, file);
+    }
+    fprintf(file,
+            "      if (st->has_children) {\n"
+            "        st->matched = true;\n"
+            "        st_child = parser_prune_st(parser, st);\n");
+    if (!is_helper_rule_(production_name)) {
+      fprintf(file,
+              "        if (NULL == st_child->rule_fn) {\n"
+              "          st_child->rule_fn = rule_%s;\n"
+              "          st_child->production_name = \"%s\";\n"
+              "        }\n",
+              production_name, production_name);
+    }
+    fprintf(file,
+            "        return st_child;\n"
+            "      }\n");
+    if (alt_label_used) {
+      fprintf(file, "    alternative_failed%d:\n", alt_index);
+    }
+    fprintf(file,
+            "      parser_rewind_st(parser, st, prefix_mark);\n"
+            "    }\n");
+  }
+  if (prefix_label_used) {
+    fprintf(file, "  prefix_failed%d:\n", start);
+  }
+  fprintf(file, "    parser_delete_st(parser, st);\n  }\n");
+}
+
+// Writes the helpers called by factored alternatives [start, end) of p. Prefix
+// elements are only called through the first alternative.
+void write_factored_subrules_(const char *production_name, const Production *p,
+                              int start, int end, int prefix_len,
+                              HelperNameMap *helpers, FILE *file) {
+  for (int alt_index = start; alt_index < end; ++alt_index) {
+    const Production *alt =
+        ProductionArray_get_unchecked(&p->children, alt_index);
+    const char *alt_name =
+        production_name_with_child_suffix_(production_name, alt, alt_index);
+    const int first_element = alt_index == start ? 0 : prefix_len;
+    for (int i = first_element; i < alternative_length_(alt); ++i) {
+      const Production *element = alternative_element_(alt, i);
+      if (PRODUCTION_EPSILON == element->type ||
+          PRODUCTION_RULE == element->type) {
+        continue;
+      }
+      write_rule_and_subrules_(alternative_element_name_(alt_name, alt, i),
+                               element, false, -1, false, helpers, file);
+    }
+  }
+}
+
 void write_or_body_(const char *production_name, const Production *p,
                     FILE *file) {
-  int child_index = -1;
-  ProductionArrayIterator children;
-  ProductionArray_iterator(&children, &p->children);
-  for (; ProductionArray_has_next(&children); ProductionArray_next(&children)) {
+  const int num_alternatives = ProductionArray_size(&p->children);
+  int child_index = 0;
+  while (child_index < num_alternatives) {
+    int prefix_len;
+    const int group_end = factored_group_end_(p, child_index, &prefix_len);
+    if (group_end > 0) {
+      write_factored_alternatives_(production_name, p, child_index, group_end,
+                                   prefix_len, file);
+      child_index = group_end;
+      continue;
+    }
+    const Production *p_child =
+        ProductionArray_get_unchecked(&p->children, child_index);
+    const char *child_name = production_name_with_child_suffix_(
+        production_name, p_child, child_index);
+    fprintf(file, "  {\n");
+    if (is_inlined_token_(child_name, p_child)) {
+      fprintf(file, "    Token *token;\n");
+    }
+    fprintf(file, "    SyntaxTree *st_child = ");
+    print_child_match_(child_name, p_child, file);
+    fprintf(file, "    if (st_child->matched) {\n");
+    if (!is_helper_rule_(production_name)) {
+      // MATCH_EPSILON is shared, so it is never named.
+      fprintf(file,
+              "      if (&MATCH_EPSILON != st_child && "
+              "NULL == st_child->rule_fn) {\n");
+      fprintf(file, "        st_child->rule_fn = rule_%s;\n", production_name);
+      fprintf(file, "        st_child->production_name = \"%s\";\n",
+              production_name);
+      fprintf(file, "      }\n");
+    }
+    fprintf(file, "      return st_child;\n    }\n  }\n");
     ++child_index;
-    const Production *p_child = *ProductionArray_value(&children);
-    fprintf(file, "  {\n    SyntaxTree *st_child = ");
-    print_child_function_call_(production_name_with_child_suffix_(
-                                   production_name, p_child, child_index),
-                               p_child, file);
-    fprintf(file,
-            "    if (st_child->matched) {\n"
-            "      if (NULL == st_child->rule_fn) {\n");
-    fprintf(file, "        st_child->rule_fn = rule_%s;\n", production_name);
-    fprintf(file, "        st_child->production_name = \"%s\";\n",
-            production_name);
-    fprintf(file,
-            "      }\n"
-            "      return st_child;\n    }\n  }\n");
   }
   fprintf(file, "  return &NO_MATCH;\n");
 }
 
 void write_rule_and_subrules_(const char *production_name, const Production *p,
-                              bool is_named_rule, FILE *file) {
+                              bool is_named_rule, int rule_index, bool spanned,
+                              HelperNameMap *helpers, FILE *file) {
+  if (!is_named_rule) {
+    if (is_inlined_token_(production_name, p)) {
+      return;
+    }
+    if (!share_helper_(helpers, production_name, p)) {
+      write_helper_entry_(production_name, p, file);
+      return;
+    }
+  }
+  const bool has_entry =
+      !is_named_rule && helper_names_result_(production_name, p);
+  const Production *helper = p;
+  // An optional is generated as its child; the caller tolerates no match.
+  p = production_strip_optional_(p);
   if (PRODUCTION_AND == p->type || PRODUCTION_OR == p->type) {
-    int child_index = -1;
-    ProductionArrayIterator children;
-    ProductionArray_iterator(&children, &p->children);
-    for (; ProductionArray_has_next(&children);
-         ProductionArray_next(&children)) {
-      ++child_index;
-      const Production *p_child = *ProductionArray_value(&children);
-      if (PRODUCTION_EPSILON == p_child->type ||
-          PRODUCTION_RULE == p_child->type) {
+    const int num_children = ProductionArray_size(&p->children);
+    int child_index = 0;
+    while (child_index < num_children) {
+      int prefix_len = 0;
+      const int group_end =
+          PRODUCTION_OR == p->type
+              ? factored_group_end_(p, child_index, &prefix_len)
+              : 0;
+      if (group_end > 0) {
+        write_factored_subrules_(production_name, p, child_index, group_end,
+                                 prefix_len, helpers, file);
+        child_index = group_end;
         continue;
       }
-      write_rule_and_subrules_(production_name_with_child_suffix_(
-                                   production_name, p_child, child_index),
-                               p_child, false, file);
+      const Production *p_child =
+          ProductionArray_get_unchecked(&p->children, child_index);
+      if (PRODUCTION_EPSILON != p_child->type &&
+          PRODUCTION_RULE != p_child->type) {
+        write_rule_and_subrules_(production_name_with_child_suffix_(
+                                     production_name, p_child, child_index),
+                                 p_child, false, -1, false, helpers, file);
+      }
+      ++child_index;
     }
   }
-  if (PRODUCTION_OPTIONAL == p->type) {
-    p = ProductionArray_get_unchecked(&p->children, 0);
-    write_rule_and_subrules_(production_name, p, is_named_rule, file);
-    return;
+  if (spanned) {
+    write_spanned_rule_signature_(production_name, rule_index, file);
+  } else if (is_named_rule) {
+    write_profiled_rule_signature_(production_name, p, rule_index, file);
+  } else if (has_entry) {
+    fprintf(file, "static SyntaxTree *%s(Parser *parser)",
+            helper_body_name_(helper));
+  } else {
+    write_rule_signature_(production_name, p, is_named_rule, file);
   }
-  write_rule_signature_(production_name, p, is_named_rule, file);
 
   fprintf(file, " {\n");
   if (PRODUCTION_AND == p->type) {
@@ -359,10 +869,7 @@ void write_rule_and_subrules_(const char *production_name, const Production *p,
             "  if (NULL == token || %s != token->type) {\n"
             "    return &NO_MATCH;\n  }\n",
             p->token);
-    if (0 == strncmp("__token",
-                     production_name + strlen(production_name) -
-                         strlen("__token") - 1,
-                     strlen("__token"))) {
+    if (!is_named_rule) {
       fprintf(file, "  return match(parser, NULL, NULL);\n");
     } else {
       fprintf(file, "  return match(parser, rule_%s, \"%s\");\n",
@@ -377,6 +884,9 @@ void write_rule_and_subrules_(const char *production_name, const Production *p,
     exit(1);
   }
   fprintf(file, "}\n\n");
+  if (has_entry) {
+    write_helper_entry_(production_name, helper, file);
+  }
 }
 
 void write_includes_(ParserBuilder *pb, FILE *file, const char h_file_path[],
@@ -411,13 +921,19 @@ void parser_builder_write_c_file(ParserBuilder *pb, const char h_file_path[],
                                  const char lexer_h_file_path[], FILE *file) {
   write_includes_(pb, file, h_file_path, lexer_h_file_path);
 
+  HelperNameMap helpers;
+  HelperNameMap_init(&helpers, string_ptr_hasher_, string_ptr_comparator_);
+  int rule_index = 0;
   ProductionMapIterator rules;
   ProductionMap_iterator(&rules, &pb->rules);
   for (; ProductionMap_has_entry(&rules); ProductionMap_next_entry(&rules)) {
     const char *production_name = ProductionMap_key(&rules);
     const Production *p = *ProductionMap_value(&rules);
-    write_rule_and_subrules_(production_name, p, true, file);
+    write_rule_and_subrules_(production_name, p, true, rule_index++,
+                             is_spanned_rule_(pb, production_name), &helpers,
+                             file);
   }
+  HelperNameMap_finalize(&helpers);
 }
 
 void parser_builder_write_h_file(ParserBuilder *pb, FILE *file) {
@@ -444,3 +960,586 @@ void parser_builder_print(ParserBuilder *pb, FILE *out) {
     fprintf(out, ";\n");
   }
 }
+
+// Grammar analysis.
+//
+// Computes nullable/FIRST/FOLLOW sets over the rules and reports constructs
+// that make the generated recursive-descent parser backtrack or loop.
+
+DEFINE_ARRAYLIKE(TokenNameArray, const char *);
+IMPL_ARRAYLIKE(TokenNameArray, const char *);
+
+typedef struct {
+  const char *rule_name;
+  const Production *p;
+  bool nullable, productive, reachable, referenced;
+  TokenNameArray first;
+  TokenNameArray follow;
+} RuleInfo_;
+
+DEFINE_MAPLIKE(RuleInfoMap, char *, RuleInfo_ *);
+IMPL_MAPLIKE(RuleInfoMap, char *, RuleInfo_ *);
+
+typedef struct {
+  RuleInfoMap rules;
+  FILE *out;
+  int num_findings;
+} GrammarAnalysis_;
+
+// Marker for end of input in FOLLOW sets.
+#define END_OF_INPUT_ "$"
+
+bool token_set_contains_(TokenNameArray *set, const char *token_name) {
+  TokenNameArrayIterator iter;
+  TokenNameArray_iterator(&iter, set);
+  for (; TokenNameArray_has_next(&iter); TokenNameArray_next(&iter)) {
+    if (*TokenNameArray_value(&iter) == token_name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool token_set_add_(TokenNameArray *set, const char *token_name) {
+  if (token_set_contains_(set, token_name)) {
+    return false;
+  }
+  TokenNameArray_push_back(set, token_name);
+  return true;
+}
+
+bool token_set_add_all_(TokenNameArray *set, TokenNameArray *other) {
+  bool changed = false;
+  TokenNameArrayIterator iter;
+  TokenNameArray_iterator(&iter, other);
+  for (; TokenNameArray_has_next(&iter); TokenNameArray_next(&iter)) {
+    changed |= token_set_add_(set, *TokenNameArray_value(&iter));
+  }
+  return changed;
+}
+
+void token_set_print_(TokenNameArray *set, FILE *out) {
+  fprintf(out, "{");
+  bool first = true;
+  TokenNameArrayIterator iter;
+  TokenNameArray_iterator(&iter, set);
+  for (; TokenNameArray_has_next(&iter); TokenNameArray_next(&iter)) {
+    fprintf(out, "%s%s", first ? "" : ", ", *TokenNameArray_value(&iter));
+    first = false;
+  }
+  fprintf(out, "}");
+}
+
+RuleInfo_ *rule_info_(GrammarAnalysis_ *ga, const char rule_name[]) {
+  return RuleInfoMap_find(&ga->rules, rule_name, sizeof(char *), NULL);
+}
+
+void grammar_finding_(GrammarAnalysis_ *ga, const char rule_name[],
+                      const char format[], ...) {
+  va_list args;
+  va_start(args, format);
+  fprintf(ga->out, "  %s: ", rule_name);
+  vfprintf(ga->out, format, args);
+  fprintf(ga->out, "\n");
+  va_end(args);
+  ++ga->num_findings;
+}
+
+bool production_nullable_(GrammarAnalysis_ *ga, const Production *p) {
+  switch (p->type) {
+    case PRODUCTION_EPSILON:
+    case PRODUCTION_OPTIONAL:
+      return true;
+    case PRODUCTION_TOKEN:
+      return false;
+    case PRODUCTION_RULE: {
+      RuleInfo_ *info = rule_info_(ga, p->rule_name);
+      return NULL != info && info->nullable;
+    }
+    default:
+      break;
+  }
+  const bool is_and = PRODUCTION_AND == p->type;
+  ProductionArrayIterator children;
+  ProductionArray_iterator(&children, (ProductionArray *)&p->children);
+  for (; ProductionArray_has_next(&children); ProductionArray_next(&children)) {
+    const bool child_nullable =
+        production_nullable_(ga, *ProductionArray_value(&children));
+    if (is_and && !child_nullable) {
+      return false;
+    }
+    if (!is_and && child_nullable) {
+      return true;
+    }
+  }
+  return is_and;
+}
+
+bool production_productive_(GrammarAnalysis_ *ga, const Production *p) {
+  switch (p->type) {
+    case PRODUCTION_EPSILON:
+    case PRODUCTION_OPTIONAL:
+    case PRODUCTION_TOKEN:
+      return true;
+    case PRODUCTION_RULE: {
+      RuleInfo_ *info = rule_info_(ga, p->rule_name);
+      return NULL != info && info->productive;
+    }
+    default:
+      break;
+  }
+  const bool is_and = PRODUCTION_AND == p->type;
+  ProductionArrayIterator children;
+  ProductionArray_iterator(&children, (ProductionArray *)&p->children);
+  for (; ProductionArray_has_next(&children); ProductionArray_next(&children)) {
+    const bool child_productive =
+        production_productive_(ga, *ProductionArray_value(&children));
+    if (is_and && !child_productive) {
+      return false;
+    }
+    if (!is_and && child_productive) {
+      return true;
+    }
+  }
+  return is_and;
+}
+
+// Adds FIRST(p) to first. Returns whether first changed.
+bool production_first_(GrammarAnalysis_ *ga, const Production *p,
+                       TokenNameArray *first) {
+  switch (p->type) {
+    case PRODUCTION_EPSILON:
+      return false;
+    case PRODUCTION_TOKEN:
+      return token_set_add_(first, p->token);
+    case PRODUCTION_RULE: {
+      RuleInfo_ *info = rule_info_(ga, p->rule_name);
+      return NULL != info && token_set_add_all_(first, &info->first);
+    }
+    default:
+      break;
+  }
+  bool changed = false;
+  ProductionArrayIterator children;
+  ProductionArray_iterator(&children, (ProductionArray *)&p->children);
+  for (; ProductionArray_has_next(&children); ProductionArray_next(&children)) {
+    const Production *p_child = *ProductionArray_value(&children);
+    changed |= production_first_(ga, p_child, first);
+    if (PRODUCTION_AND == p->type && !production_nullable_(ga, p_child)) {
+      break;
+    }
+  }
+  return changed;
+}
+
+// Propagates follow, the set of tokens that can follow p, into the FOLLOW sets
+// of rules referenced by p. Returns whether any FOLLOW set changed.
+bool production_follow_(GrammarAnalysis_ *ga, const Production *p,
+                        TokenNameArray *follow) {
+  switch (p->type) {
+    case PRODUCTION_EPSILON:
+    case PRODUCTION_TOKEN:
+      return false;
+    case PRODUCTION_RULE: {
+      RuleInfo_ *info = rule_info_(ga, p->rule_name);
+      return NULL != info && token_set_add_all_(&info->follow, follow);
+    }
+    case PRODUCTION_OR:
+    case PRODUCTION_OPTIONAL: {
+      bool changed = false;
+      ProductionArrayIterator children;
+      ProductionArray_iterator(&children, (ProductionArray *)&p->children);
+      for (; ProductionArray_has_next(&children);
+           ProductionArray_next(&children)) {
+        changed |=
+            production_follow_(ga, *ProductionArray_value(&children), follow);
+      }
+      return changed;
+    }
+    default:
+      break;
+  }
+  // AND: walk right to left, tracking what can follow each child.
+  bool changed = false;
+  TokenNameArray trailing;
+  TokenNameArray_init(&trailing);
+  token_set_add_all_(&trailing, follow);
+  for (int i = ProductionArray_size(&p->children) - 1; i >= 0; --i) {
+    const Production *p_child = ProductionArray_get_unchecked(&p->children, i);
+    changed |= production_follow_(ga, p_child, &trailing);
+    if (!production_nullable_(ga, p_child)) {
+      TokenNameArray_finalize(&trailing);
+      TokenNameArray_init(&trailing);
+    }
+    production_first_(ga, p_child, &trailing);
+  }
+  TokenNameArray_finalize(&trailing);
+  return changed;
+}
+
+void production_mark_referenced_(GrammarAnalysis_ *ga, const char rule_name[],
+                                 const Production *p, bool reachable) {
+  if (PRODUCTION_RULE == p->type) {
+    RuleInfo_ *info = rule_info_(ga, p->rule_name);
+    if (NULL == info) {
+      grammar_finding_(ga, rule_name, "references undefined rule '%s'.",
+                       p->rule_name);
+      return;
+    }
+    if (info->rule_name != rule_name) {
+      info->referenced = true;
+    }
+    if (reachable && !info->reachable) {
+      info->reachable = true;
+      production_mark_referenced_(ga, info->rule_name, info->p, true);
+    }
+    return;
+  }
+  if (PRODUCTION_OR == p->type || PRODUCTION_AND == p->type ||
+      PRODUCTION_OPTIONAL == p->type) {
+    ProductionArrayIterator children;
+    ProductionArray_iterator(&children, (ProductionArray *)&p->children);
+    for (; ProductionArray_has_next(&children);
+         ProductionArray_next(&children)) {
+      production_mark_referenced_(ga, rule_name,
+                                  *ProductionArray_value(&children), reachable);
+    }
+  }
+}
+
+// Collects into left_rules the names of rules that p can invoke before
+// consuming any token.
+void production_left_rules_(GrammarAnalysis_ *ga, const Production *p,
+                            TokenNameArray *left_rules) {
+  switch (p->type) {
+    case PRODUCTION_EPSILON:
+    case PRODUCTION_TOKEN:
+      return;
+    case PRODUCTION_RULE:
+      token_set_add_(left_rules, p->rule_name);
+      return;
+    default:
+      break;
+  }
+  ProductionArrayIterator children;
+  ProductionArray_iterator(&children, (ProductionArray *)&p->children);
+  for (; ProductionArray_has_next(&children); ProductionArray_next(&children)) {
+    const Production *p_child = *ProductionArray_value(&children);
+    production_left_rules_(ga, p_child, left_rules);
+    if (PRODUCTION_AND == p->type && !production_nullable_(ga, p_child)) {
+      break;
+    }
+  }
+}
+
+// Returns the rule through which info's rule can invoke itself without
+// consuming a token, or NULL if it is not left-recursive.
+const char *rule_left_recursion_(GrammarAnalysis_ *ga, RuleInfo_ *info) {
+  TokenNameArray direct;
+  TokenNameArray_init(&direct);
+  production_left_rules_(ga, info->p, &direct);
+  const char *via = NULL;
+  TokenNameArrayIterator callees;
+  TokenNameArray_iterator(&callees, &direct);
+  for (; TokenNameArray_has_next(&callees) && NULL == via;
+       TokenNameArray_next(&callees)) {
+    const char *callee = *TokenNameArray_value(&callees);
+    TokenNameArray closure;
+    TokenNameArray_init(&closure);
+    token_set_add_(&closure, callee);
+    // closure grows while it is walked, so index rather than iterate.
+    for (int i = 0; i < TokenNameArray_size(&closure); ++i) {
+      const char *rule_name = TokenNameArray_get_unchecked(&closure, i);
+      if (rule_name == info->rule_name) {
+        via = callee;
+        break;
+      }
+      RuleInfo_ *rule_info = rule_info_(ga, rule_name);
+      if (NULL != rule_info) {
+        production_left_rules_(ga, rule_info->p, &closure);
+      }
+    }
+    TokenNameArray_finalize(&closure);
+  }
+  TokenNameArray_finalize(&direct);
+  return via;
+}
+
+// Returns whether p matches on every input without consuming tokens, which
+// shadows every later alternative of an ordered OR.
+bool production_always_matches_(GrammarAnalysis_ *ga, const Production *p,
+                                int depth) {
+  if (depth > 64) {
+    return false;
+  }
+  switch (p->type) {
+    case PRODUCTION_EPSILON:
+      return true;
+    case PRODUCTION_RULE: {
+      RuleInfo_ *info = rule_info_(ga, p->rule_name);
+      return NULL != info && production_always_matches_(ga, info->p, depth + 1);
+    }
+    case PRODUCTION_OR: {
+      ProductionArrayIterator children;
+      ProductionArray_iterator(&children, (ProductionArray *)&p->children);
+      for (; ProductionArray_has_next(&children);
+           ProductionArray_next(&children)) {
+        if (production_always_matches_(ga, *ProductionArray_value(&children),
+                                       depth + 1)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    default:
+      return false;
+  }
+}
+
+// Returns the number of leading elements p1 and p2 have in common. Epsilon
+// elements parse nothing, so they are not counted in *weight.
+int alternatives_common_prefix_(const Production *p1, const Production *p2,
+                                int *weight) {
+  const int len1 = alternative_length_(p1);
+  const int len2 = alternative_length_(p2);
+  int prefix = 0;
+  *weight = 0;
+  while (prefix < len1 && prefix < len2 &&
+         production_equals_(alternative_element_(p1, prefix),
+                            alternative_element_(p2, prefix))) {
+    if (PRODUCTION_EPSILON != alternative_element_(p1, prefix)->type) {
+      ++*weight;
+    }
+    ++prefix;
+  }
+  return prefix;
+}
+
+void analyze_or_(GrammarAnalysis_ *ga, const char rule_name[],
+                 const Production *p) {
+  const int num_alternatives = ProductionArray_size(&p->children);
+  for (int i = 0; i < num_alternatives; ++i) {
+    const Production *p_i = ProductionArray_get_unchecked(&p->children, i);
+    if (production_always_matches_(ga, p_i, 0) && i < num_alternatives - 1) {
+      grammar_finding_(ga, rule_name,
+                       "OR alternative %d always matches, so the %d "
+                       "alternative(s) after it are unreachable.",
+                       i + 1, num_alternatives - i - 1);
+      break;
+    }
+    TokenNameArray first_i;
+    TokenNameArray_init(&first_i);
+    production_first_(ga, p_i, &first_i);
+    for (int j = i + 1; j < num_alternatives; ++j) {
+      const Production *p_j = ProductionArray_get_unchecked(&p->children, j);
+      int weight;
+      const int prefix = alternatives_common_prefix_(p_i, p_j, &weight);
+      if (weight > 0 && prefix == alternative_length_(p_i)) {
+        grammar_finding_(ga, rule_name,
+                         "OR alternative %d is unreachable; alternative %d is "
+                         "a prefix of it and matches first.",
+                         j + 1, i + 1);
+        continue;
+      }
+      if (weight > 0) {
+        grammar_finding_(ga, rule_name,
+                         "OR alternatives %d and %d share a %d-element prefix "
+                         "that is re-parsed whenever alternative %d fails "
+                         "(needs LL(%d)); consider left-factoring.",
+                         i + 1, j + 1, weight, i + 1, weight + 1);
+        continue;
+      }
+      TokenNameArray first_j;
+      TokenNameArray_init(&first_j);
+      production_first_(ga, p_j, &first_j);
+      TokenNameArray shared;
+      TokenNameArray_init(&shared);
+      TokenNameArrayIterator iter;
+      TokenNameArray_iterator(&iter, &first_j);
+      for (; TokenNameArray_has_next(&iter); TokenNameArray_next(&iter)) {
+        if (token_set_contains_(&first_i, *TokenNameArray_value(&iter))) {
+          token_set_add_(&shared, *TokenNameArray_value(&iter));
+        }
+      }
+      if (!TokenNameArray_is_empty(&shared)) {
+        fprintf(ga->out,
+                "  %s: LL(1) conflict between OR alternatives %d and %d on ",
+                rule_name, i + 1, j + 1);
+        token_set_print_(&shared, ga->out);
+        fprintf(ga->out,
+                "; alternative %d is tried only after %d backtracks.\n", j + 1,
+                i + 1);
+        ++ga->num_findings;
+      }
+      TokenNameArray_finalize(&shared);
+      TokenNameArray_finalize(&first_j);
+    }
+    TokenNameArray_finalize(&first_i);
+  }
+}
+
+void analyze_production_(GrammarAnalysis_ *ga, const char rule_name[],
+                         const Production *p) {
+  if (PRODUCTION_OR == p->type) {
+    analyze_or_(ga, rule_name, p);
+  }
+  if (PRODUCTION_OR == p->type || PRODUCTION_AND == p->type ||
+      PRODUCTION_OPTIONAL == p->type) {
+    ProductionArrayIterator children;
+    ProductionArray_iterator(&children, (ProductionArray *)&p->children);
+    for (; ProductionArray_has_next(&children);
+         ProductionArray_next(&children)) {
+      analyze_production_(ga, rule_name, *ProductionArray_value(&children));
+    }
+  }
+}
+
+int parser_builder_analyze(ParserBuilder *pb, const char root[], bool verbose,
+                           FILE *out) {
+  GrammarAnalysis_ ga;
+  RuleInfoMap_init(&ga.rules, string_ptr_hasher_, string_ptr_comparator_);
+  ga.out = out;
+  ga.num_findings = 0;
+
+  ProductionMapIterator rules;
+  ProductionMap_iterator(&rules, &pb->rules);
+  for (; ProductionMap_has_entry(&rules); ProductionMap_next_entry(&rules)) {
+    RuleInfo_ *info = calloc(1, sizeof(RuleInfo_));
+    info->rule_name = ProductionMap_key(&rules);
+    info->p = *ProductionMap_value(&rules);
+    TokenNameArray_init(&info->first);
+    TokenNameArray_init(&info->follow);
+    RuleInfoMap_insert(&ga.rules, info->rule_name, sizeof(char *), info);
+  }
+  const char *interned_root = NULL == root ? NULL : global_intern(root);
+  RuleInfo_ *root_info =
+      NULL == interned_root ? NULL : rule_info_(&ga, interned_root);
+
+  fprintf(out, "Grammar analysis (%ld rules):\n",
+          (long)ProductionMap_size(&pb->rules));
+  if (NULL != root && NULL == root_info) {
+    grammar_finding_(&ga, root, "root rule is not defined.");
+  }
+
+  // Fixed points for nullable, productive, FIRST and FOLLOW.
+  RuleInfoMapIterator iter;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    RuleInfoMap_iterator(&iter, &ga.rules);
+    for (; RuleInfoMap_has_entry(&iter); RuleInfoMap_next_entry(&iter)) {
+      RuleInfo_ *info = *RuleInfoMap_mutable_value(&iter);
+      if (!info->nullable && production_nullable_(&ga, info->p)) {
+        info->nullable = changed = true;
+      }
+      if (!info->productive && production_productive_(&ga, info->p)) {
+        info->productive = changed = true;
+      }
+      changed |= production_first_(&ga, info->p, &info->first);
+    }
+  }
+
+  // Reachability. Without a root, every rule no other rule refers to is
+  // treated as an entry point, and if there are none then every rule is.
+  bool has_unreferenced = false;
+  RuleInfoMap_iterator(&iter, &ga.rules);
+  for (; RuleInfoMap_has_entry(&iter); RuleInfoMap_next_entry(&iter)) {
+    RuleInfo_ *info = *RuleInfoMap_mutable_value(&iter);
+    production_mark_referenced_(&ga, info->rule_name, info->p, false);
+  }
+  RuleInfoMap_iterator(&iter, &ga.rules);
+  for (; RuleInfoMap_has_entry(&iter); RuleInfoMap_next_entry(&iter)) {
+    has_unreferenced |= !(*RuleInfoMap_value(&iter))->referenced;
+  }
+  RuleInfoMap_iterator(&iter, &ga.rules);
+  for (; RuleInfoMap_has_entry(&iter); RuleInfoMap_next_entry(&iter)) {
+    RuleInfo_ *info = *RuleInfoMap_mutable_value(&iter);
+    const bool is_entry = NULL != root_info    ? info == root_info
+                          : has_unreferenced ? !info->referenced
+                                             : true;
+    if (is_entry && !info->reachable) {
+      info->reachable = true;
+      token_set_add_(&info->follow, END_OF_INPUT_);
+      production_mark_referenced_(&ga, info->rule_name, info->p, true);
+    }
+  }
+
+  changed = true;
+  while (changed) {
+    changed = false;
+    RuleInfoMap_iterator(&iter, &ga.rules);
+    for (; RuleInfoMap_has_entry(&iter); RuleInfoMap_next_entry(&iter)) {
+      RuleInfo_ *info = *RuleInfoMap_mutable_value(&iter);
+      changed |= production_follow_(&ga, info->p, &info->follow);
+    }
+  }
+
+  RuleInfoMap_iterator(&iter, &ga.rules);
+  for (; RuleInfoMap_has_entry(&iter); RuleInfoMap_next_entry(&iter)) {
+    RuleInfo_ *info = *RuleInfoMap_mutable_value(&iter);
+    if (!info->reachable) {
+      grammar_finding_(&ga, info->rule_name, "is unreachable from '%s'.",
+                       NULL == root ? "any entry rule" : root);
+    }
+    if (!info->productive) {
+      grammar_finding_(&ga, info->rule_name,
+                       "is dead; it can never match any input.");
+    }
+    const char *via = rule_left_recursion_(&ga, info);
+    if (NULL != via) {
+      if (info->p->exclude_from_header) {
+        grammar_finding_(&ga, info->rule_name,
+                         "LIST item and delimiter are nullable; the "
+                         "repetition can loop without consuming a token.");
+      } else if (via == info->rule_name) {
+        grammar_finding_(&ga, info->rule_name,
+                         "is directly left-recursive and will recurse "
+                         "without consuming a token.");
+      } else {
+        grammar_finding_(&ga, info->rule_name,
+                         "is left-recursive via '%s' and will recurse "
+                         "without consuming a token.",
+                         via);
+      }
+    }
+    if (info->nullable && !production_always_matches_(&ga, info->p, 0)) {
+      TokenNameArrayIterator follow;
+      TokenNameArray_iterator(&follow, &info->follow);
+      for (; TokenNameArray_has_next(&follow); TokenNameArray_next(&follow)) {
+        if (token_set_contains_(&info->first, *TokenNameArray_value(&follow))) {
+          grammar_finding_(&ga, info->rule_name,
+                           "LL(1) FIRST/FOLLOW conflict on %s; the rule is "
+                           "nullable and may consume a token its caller "
+                           "expects.",
+                           *TokenNameArray_value(&follow));
+          break;
+        }
+      }
+    }
+    analyze_production_(&ga, info->rule_name, info->p);
+  }
+
+  if (verbose) {
+    RuleInfoMap_iterator(&iter, &ga.rules);
+    for (; RuleInfoMap_has_entry(&iter); RuleInfoMap_next_entry(&iter)) {
+      RuleInfo_ *info = *RuleInfoMap_mutable_value(&iter);
+      fprintf(out, "  %s%s\n    FIRST  = ", info->rule_name,
+              info->nullable ? " (nullable)" : "");
+      token_set_print_(&info->first, out);
+      fprintf(out, "\n    FOLLOW = ");
+      token_set_print_(&info->follow, out);
+      fprintf(out, "\n");
+    }
+  }
+  fprintf(out, "%d finding(s).\n", ga.num_findings);
+
+  RuleInfoMap_iterator(&iter, &ga.rules);
+  for (; RuleInfoMap_has_entry(&iter); RuleInfoMap_next_entry(&iter)) {
+    RuleInfo_ *info = *RuleInfoMap_mutable_value(&iter);
+    TokenNameArray_finalize(&info->first);
+    TokenNameArray_finalize(&info->follow);
+    free(info);
+  }
+  RuleInfoMap_finalize(&ga.rules);
+  return ga.num_findings;
+}
@@ -5,6 +5,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stdio.h>
 
 typedef struct ParserBuilder_ ParserBuilder;
@@ -20,6 +21,10 @@ void parser_builder_write_h_file(ParserBuilder *pb, FILE *file);
 void parser_builder_set_root(ParserBuilder *pb, Production *p);
 void parser_builder_rule(ParserBuilder *pb, const char rule_name[],
                          Production *p);
+// Marks rule_name as materialized. Once any rule is, the others are generated
+// to only record token spans when parsed in PARSER_MODE_HYBRID. rule_name must
+// already be a rule; otherwise this exits with an error.
+void parser_builder_materialize(ParserBuilder *pb, const char rule_name[]);
 
 // clang-format off
 #define GET_FUNC(_1, _2, _3, _4, _5, _6, _7, _8, _9, NAME, ...) NAME
@@ -67,6 +72,15 @@ void production_exclude_from_header(Production *p);
 
 void parser_builder_print(ParserBuilder *pb, FILE *out);
 
+// Reports grammar constructs that cause backtracking or non-termination in the
+// generated parser: shared OR prefixes, LL(1) conflicts, unreachable OR
+// alternatives, left recursion, nullable LIST loops, and unreachable or dead
+// rules. If root is NULL, rules not referenced by other rules are treated as
+// entry points. When verbose, nullable/FIRST/FOLLOW sets are also printed.
+// Returns the number of findings.
+int parser_builder_analyze(ParserBuilder *pb, const char root[], bool verbose,
+                           FILE *out);
+
 #ifdef __cplusplus
 }
 #endif
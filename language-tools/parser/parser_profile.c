@@ -0,0 +1,196 @@
+#include "language-tools/parser/parser_profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "language-tools/allocator.h"
+#include "language-tools/parser/parser.h"
+
+IMPL_ARRAYLIKE(ParserRuleProfileArray, ParserRuleProfile);
+IMPL_ARRAYLIKE(ParserTraceEventArray, ParserTraceEvent);
+
+static int64_t now_ns_() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((int64_t)ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void parser_profile_enable(Parser *parser, bool trace) {
+  if (NULL != parser->profile) {
+    return;
+  }
+  ParserProfile *profile = lt_calloc(1, sizeof(ParserProfile));
+  ParserRuleProfileArray_init(&profile->rules);
+  ParserTraceEventArray_init(&profile->events);
+  profile->current = NULL;
+  profile->trace = trace;
+  profile->origin_ns = now_ns_();
+  parser->profile = profile;
+}
+
+void parser_profile_disable(Parser *parser) {
+  if (NULL == parser->profile) {
+    return;
+  }
+  ParserRuleProfileArray_finalize(&parser->profile->rules);
+  ParserTraceEventArray_finalize(&parser->profile->events);
+  lt_free(parser->profile, sizeof(ParserProfile));
+  parser->profile = NULL;
+}
+
+static ParserRuleProfile *rule_profile_(ParserProfile *profile, int rule_index,
+                                        const char rule_name[]) {
+  while (ParserRuleProfileArray_size(&profile->rules) <= rule_index) {
+    ParserRuleProfile *stats =
+        ParserRuleProfileArray_push_back_ref(&profile->rules);
+    memset(stats, 0, sizeof(ParserRuleProfile));
+  }
+  ParserRuleProfile *stats =
+      ParserRuleProfileArray_mutable_ref_unchecked(&profile->rules, rule_index);
+  stats->rule_name = rule_name;
+  return stats;
+}
+
+void parser_profile_node_freed(ParserProfile *profile) {
+  if (NULL == profile->current) {
+    return;
+  }
+  ParserRuleProfileArray_mutable_ref_unchecked(&profile->rules,
+                                               profile->current->rule_index)
+      ->nodes_freed++;
+}
+
+void parser_profile_merge(ParserProfile *profile, const ParserProfile *from) {
+  for (int i = 0; i < ParserRuleProfileArray_size(&from->rules); ++i) {
+    const ParserRuleProfile from_stats =
+        ParserRuleProfileArray_get_unchecked(&from->rules, i);
+    if (0 == from_stats.calls) {
+      continue;
+    }
+    ParserRuleProfile *stats = rule_profile_(profile, i, from_stats.rule_name);
+    stats->calls += from_stats.calls;
+    stats->matches += from_stats.matches;
+    stats->fails += from_stats.fails;
+    stats->tokens_consumed += from_stats.tokens_consumed;
+    stats->nodes_freed += from_stats.nodes_freed;
+    stats->inclusive_ns += from_stats.inclusive_ns;
+    stats->exclusive_ns += from_stats.exclusive_ns;
+  }
+  for (int i = 0; i < ParserTraceEventArray_size(&from->events); ++i) {
+    ParserTraceEvent *event =
+        ParserTraceEventArray_push_back_ref(&profile->events);
+    *event = ParserTraceEventArray_get_unchecked(&from->events, i);
+    // Events are timed from the origin of the profile they were recorded in.
+    event->start_ns += from->origin_ns - profile->origin_ns;
+  }
+}
+
+SyntaxTree *parser_profile_rule(Parser *parser, int rule_index,
+                                const char rule_name[], RuleFn rule_fn) {
+  ParserProfile *profile = parser->profile;
+  if (NULL == profile) {
+    return rule_fn(parser);
+  }
+  // Ensure the entry exists before any nested rule frees nodes into it.
+  rule_profile_(profile, rule_index, rule_name);
+
+  ParserProfileFrame frame = {
+      .parent = profile->current, .rule_index = rule_index, .child_ns = 0};
+  const size_t tokens_before = TokenArray_size(parser->tokens);
+  profile->current = &frame;
+
+  const int64_t start_ns = now_ns_();
+  SyntaxTree *st = rule_fn(parser);
+  const int64_t duration_ns = now_ns_() - start_ns;
+
+  profile->current = frame.parent;
+  if (NULL != frame.parent) {
+    frame.parent->child_ns += duration_ns;
+  }
+
+  // Nested rules may have grown the array, so the entry is looked up again.
+  ParserRuleProfile *stats = rule_profile_(profile, rule_index, rule_name);
+  stats->calls++;
+  if (st->matched) {
+    stats->matches++;
+    stats->tokens_consumed += tokens_before - TokenArray_size(parser->tokens);
+  } else {
+    stats->fails++;
+  }
+  stats->inclusive_ns += duration_ns;
+  stats->exclusive_ns += duration_ns - frame.child_ns;
+
+  if (profile->trace) {
+    ParserTraceEvent *event =
+        ParserTraceEventArray_push_back_ref(&profile->events);
+    event->rule_index = rule_index;
+    event->start_ns = start_ns - profile->origin_ns;
+    event->duration_ns = duration_ns;
+  }
+  return st;
+}
+
+static int compare_inclusive_desc_(const void *lhs, const void *rhs) {
+  const ParserRuleProfile *l = (const ParserRuleProfile *)lhs;
+  const ParserRuleProfile *r = (const ParserRuleProfile *)rhs;
+  return (l->inclusive_ns < r->inclusive_ns)   ? 1
+         : (l->inclusive_ns > r->inclusive_ns) ? -1
+                                               : 0;
+}
+
+void parser_profile_dump(Parser *parser, FILE *out) {
+  if (NULL == parser->profile) {
+    fprintf(out, "Parser profiling is not enabled.\n");
+    return;
+  }
+  ParserRuleProfileArray *rules = &parser->profile->rules;
+  const size_t num_rules = ParserRuleProfileArray_size(rules);
+  ParserRuleProfile *sorted = lt_malloc(sizeof(ParserRuleProfile) * num_rules);
+  size_t num_called = 0;
+  for (size_t i = 0; i < num_rules; ++i) {
+    const ParserRuleProfile *stats =
+        ParserRuleProfileArray_mutable_ref_unchecked(rules, i);
+    if (stats->calls > 0) {
+      sorted[num_called++] = *stats;
+    }
+  }
+  qsort(sorted, num_called, sizeof(ParserRuleProfile),
+        compare_inclusive_desc_);
+
+  fprintf(out, "%-32s %10s %10s %10s %10s %10s %12s %12s\n", "rule", "calls",
+          "matches", "fails", "tokens", "freed", "incl_us", "excl_us");
+  for (size_t i = 0; i < num_called; ++i) {
+    const ParserRuleProfile *stats = sorted + i;
+    fprintf(out, "%-32s %10lu %10lu %10lu %10lu %10lu %12.1f %12.1f\n",
+            stats->rule_name, (unsigned long)stats->calls,
+            (unsigned long)stats->matches, (unsigned long)stats->fails,
+            (unsigned long)stats->tokens_consumed,
+            (unsigned long)stats->nodes_freed, stats->inclusive_ns / 1000.0,
+            stats->exclusive_ns / 1000.0);
+  }
+  lt_free(sorted, sizeof(ParserRuleProfile) * num_rules);
+}
+
+void parser_profile_dump_trace(Parser *parser, FILE *out) {
+  fprintf(out, "{\"traceEvents\":[");
+  if (NULL != parser->profile) {
+    ParserTraceEventArrayIterator events;
+    ParserTraceEventArray_iterator(&events, &parser->profile->events);
+    bool first = true;
+    for (; ParserTraceEventArray_has_next(&events);
+         ParserTraceEventArray_next(&events)) {
+      const ParserTraceEvent *event = ParserTraceEventArray_value(&events);
+      const ParserRuleProfile *stats =
+          ParserRuleProfileArray_mutable_ref_unchecked(&parser->profile->rules,
+                                                       event->rule_index);
+      fprintf(out,
+              "%s\n{\"name\":\"%s\",\"cat\":\"rule\",\"ph\":\"X\","
+              "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+              first ? "" : ",", stats->rule_name, event->start_ns / 1000.0,
+              event->duration_ns / 1000.0);
+      first = false;
+    }
+  }
+  fprintf(out, "\n],\"displayTimeUnit\":\"ns\"}\n");
+}
@@ -0,0 +1,74 @@
+#ifndef COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_PARSER_PARSER_PROFILE_H_
+#define COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_PARSER_PARSER_PROFILE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "c-data-structures/arraylike.h"
+
+typedef struct ParserProfile_ ParserProfile;
+typedef struct ParserProfileFrame_ ParserProfileFrame;
+
+// Statistics collected for a single named rule. Times are in nanoseconds.
+typedef struct {
+  const char *rule_name;
+  uint64_t calls;
+  uint64_t matches;
+  uint64_t fails;
+  uint64_t tokens_consumed;
+  // Syntax tree nodes freed by parser_delete_st() while backtracking.
+  uint64_t nodes_freed;
+  uint64_t inclusive_ns;
+  uint64_t exclusive_ns;
+} ParserRuleProfile;
+
+typedef struct {
+  int rule_index;
+  int64_t start_ns;
+  int64_t duration_ns;
+} ParserTraceEvent;
+
+DEFINE_ARRAYLIKE(ParserRuleProfileArray, ParserRuleProfile);
+DEFINE_ARRAYLIKE(ParserTraceEventArray, ParserTraceEvent);
+
+struct ParserProfileFrame_ {
+  ParserProfileFrame *parent;
+  int rule_index;
+  int64_t child_ns;
+};
+
+struct ParserProfile_ {
+  ParserRuleProfileArray rules;
+  ParserProfileFrame *current;
+  bool trace;
+  int64_t origin_ns;
+  ParserTraceEventArray events;
+};
+
+void parser_profile_node_freed(ParserProfile *profile);
+// Adds the statistics and trace events of from, e.g. those of a parser that
+// parsed a chunk for parser_parse_parallel(), to profile.
+void parser_profile_merge(ParserProfile *profile, const ParserProfile *from);
+
+// Generated parsers only call into the profiler when built with
+// LANGUAGE_TOOLS_PARSER_PROFILE defined (bazel build --define
+// parser_profile=true). Otherwise the hooks below compile to nothing.
+#ifdef LANGUAGE_TOOLS_PARSER_PROFILE
+#define PARSER_PROFILE_NODE_FREED(parser)         \
+  if (NULL != (parser)->profile) {                \
+    parser_profile_node_freed((parser)->profile); \
+  }
+#else
+#define PARSER_PROFILE_NODE_FREED(parser)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_PARSER_PARSER_PROFILE_H_ */
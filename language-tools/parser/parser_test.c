@@ -0,0 +1,231 @@
+#include "language-tools/parser/parser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "file-utils/file_info.h"
+#include "language-tools/intern.h"
+#include "language-tools/lexer/token.h"
+#include "language-tools/memory_stats.h"
+#include "language-tools/parser/items_parser.h"
+#include "language-tools/parser/test_lexer.h"
+#include "language-tools/testing/check.h"
+#include "language-tools/testing/token_testing.h"
+
+#define NUM_ITEMS_ 64
+
+// Writes a list of width elements, nesting lists depth levels deep.
+static void write_item_(FILE *out, int depth, int width) {
+  fprintf(out, "(");
+  for (int i = 0; i < width; ++i) {
+    if (depth > 0 && 1 == i % 2) {
+      write_item_(out, depth - 1, width);
+    } else {
+      fprintf(out, "+");
+    }
+  }
+  fprintf(out, ")");
+}
+
+// Returns NUM_ITEMS_ items of different sizes, one per line.
+static char *write_items_() {
+  char *text;
+  size_t size;
+  FILE *out = open_memstream(&text, &size);
+  for (int i = 0; i < NUM_ITEMS_; ++i) {
+    write_item_(out, i % 4, i % 3 + 1);
+    fprintf(out, "\n");
+  }
+  fclose(out);
+  return text;
+}
+
+// Writes the text of every token st matched, including those within spans.
+static void write_tokens_(const Parser *parser, const SyntaxTree *st,
+                          FILE *out) {
+  if (st->is_span) {
+    for (int i = 0; i < st->span_length; ++i) {
+      fprintf(out, "%s", parser_span_token(parser, st, i)->text);
+    }
+    return;
+  }
+  if (!st->has_children) {
+    fprintf(out, "%s", st->token->text);
+    return;
+  }
+  for (int i = 0; i < SyntaxTreeArray_size(&st->children); ++i) {
+    write_tokens_(parser, SyntaxTreeArray_get_unchecked(&st->children, i),
+                  out);
+  }
+}
+
+// Checks that item is the line of text it was parsed from.
+static void check_item_(const Parser *parser, const SyntaxTree *item,
+                        const char line[]) {
+  char *expected = strndup(line, strchr(line, '\n') - line);
+  char *actual;
+  size_t size;
+  FILE *out = open_memstream(&actual, &size);
+  write_tokens_(parser, item, out);
+  fclose(out);
+  CHECK_EQ_STR(expected, actual);
+  free(actual);
+  free(expected);
+}
+
+// Checks that each item parsed by parser is the line of text it came from.
+static void check_items_(const Parser *parser, const SyntaxTree *root,
+                         const char text[]) {
+  CHECK(root->matched);
+  CHECK(!root->is_span);
+  CHECK_EQ_INT(NUM_ITEMS_, SyntaxTreeArray_size(&root->children));
+  const char *line = text;
+  for (int i = 0; i < NUM_ITEMS_; ++i) {
+    check_item_(parser, SyntaxTreeArray_get_unchecked(&root->children, i),
+                line);
+    line = strchr(line, '\n') + 1;
+  }
+}
+
+// Items parsed by chunk parsers are built in the parser's mode and read back
+// through it.
+static void test_parse_parallel_in_each_mode_() {
+  static const ParserMode MODES[] = {PARSER_MODE_TREE, PARSER_MODE_RECOGNIZE,
+                                     PARSER_MODE_HYBRID};
+  char *text = write_items_();
+  for (int m = 0; m < 3; ++m) {
+    for (int num_threads = 1; num_threads <= 4; ++num_threads) {
+      TokenArray tokens;
+      TokenArray_init(&tokens);
+      tokenize_text(test_lexer_tokenize, text, &tokens);
+      Parser parser;
+      parser_init(&parser, rule_item);
+      parser_set_token_boundary(&parser, test_token_type_boundary);
+      parser_set_mode(&parser, MODES[m]);
+      const SyntaxTree *root =
+          parser_parse_parallel(&parser, &tokens, num_threads);
+      CHECK_EQ_INT(num_threads, parser.num_chunks);
+      CHECK(TokenArray_is_empty(&tokens));
+      check_items_(&parser, root, text);
+      // Only materialized items are built in PARSER_MODE_HYBRID.
+      const SyntaxTree *item =
+          SyntaxTreeArray_get_unchecked(&root->children, 1);
+      CHECK(PARSER_MODE_RECOGNIZE == MODES[m] ? item->is_span
+                                              : rule_item == item->rule_fn);
+      parser_finalize(&parser);
+      TokenArray_finalize(&tokens);
+    }
+  }
+  free(text);
+}
+
+// Without a token boundary, nowhere is known to end an item but the end.
+static void test_parse_parallel_without_boundary_() {
+  char *text = write_items_();
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  tokenize_text(test_lexer_tokenize, text, &tokens);
+  Parser parser;
+  parser_init(&parser, rule_item);
+  const SyntaxTree *root = parser_parse_parallel(&parser, &tokens, 4);
+  CHECK_EQ_INT(1, parser.num_chunks);
+  check_items_(&parser, root, text);
+  parser_finalize(&parser);
+  TokenArray_finalize(&tokens);
+  free(text);
+}
+
+static SyntaxTree *rule_nothing_(Parser *parser) { return &MATCH_EPSILON; }
+
+// A root rule that matches without consuming tokens fails rather than
+// matching forever, and no tokens at all are zero items.
+static void test_parse_parallel_empty_items_() {
+  char *text = write_items_();
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  tokenize_text(test_lexer_tokenize, text, &tokens);
+  const int num_tokens = TokenArray_size(&tokens);
+  Parser parser;
+  parser_init(&parser, rule_nothing_);
+  parser_set_token_boundary(&parser, test_token_type_boundary);
+  CHECK(&NO_MATCH == parser_parse_parallel(&parser, &tokens, 2));
+  CHECK_EQ_INT(num_tokens, TokenArray_size(&tokens));
+  parser_finalize(&parser);
+  TokenArray_finalize(&tokens);
+  free(text);
+
+  TokenArray_init(&tokens);
+  parser_init(&parser, rule_item);
+  parser_set_token_boundary(&parser, test_token_type_boundary);
+  const SyntaxTree *root = parser_parse_parallel(&parser, &tokens, 2);
+  CHECK(root->matched);
+  CHECK_EQ_INT(0, SyntaxTreeArray_size(&root->children));
+  parser_finalize(&parser);
+  TokenArray_finalize(&tokens);
+}
+
+// After parser_reset(), the next parse builds its trees in the storage of the
+// last without allocating, and the tokens stay with their arena.
+static void test_reset_reuses_trees_() {
+  char *text = write_items_();
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  TokenArena arena;
+  token_arena_init(&arena);
+  Parser parser;
+  parser_init(&parser, rule_item);
+  const SyntaxTree *first_items[NUM_ITEMS_];
+  LtMemoryStats first_stats;
+  for (int round = 0; round < 3; ++round) {
+    FileInfo *file = file_info_file(fmemopen(text, strlen(text), "r"));
+    test_lexer_tokenize_in_arena(file, &tokens, &arena);
+    file_info_delete(file);
+    const char *line = text;
+    for (int i = 0; i < NUM_ITEMS_; ++i) {
+      const SyntaxTree *item = parser_parse(&parser, &tokens);
+      CHECK(item->matched);
+      check_item_(&parser, item, line);
+      line = strchr(line, '\n') + 1;
+      // Each round builds its trees in the same storage.
+      if (0 == round) {
+        first_items[i] = item;
+      } else {
+        CHECK(first_items[i] == item);
+      }
+    }
+    CHECK(TokenArray_is_empty(&tokens));
+    parser_reset(&parser);
+    CHECK(TokenArray_is_empty(&tokens));
+    token_arena_reset(&arena);
+
+    // Only counted with LANGUAGE_TOOLS_MEMORY_STATS defined.
+    LtMemoryStats stats;
+    lt_memory_stats(&stats);
+    if (0 == round) {
+      first_stats = stats;
+      continue;
+    }
+    for (LtMemorySubsystem subsystem = LT_MEMORY_SYNTAX_TREES;
+         subsystem <= LT_MEMORY_SYNTAX_TREE_CHILDREN; ++subsystem) {
+      CHECK_EQ_INT(first_stats.subsystems[subsystem].num_allocations,
+                   stats.subsystems[subsystem].num_allocations);
+      CHECK_EQ_INT(first_stats.subsystems[subsystem].live_bytes,
+                   stats.subsystems[subsystem].live_bytes);
+    }
+  }
+  parser_finalize(&parser);
+  token_arena_finalize(&arena);
+  TokenArray_finalize(&tokens);
+  free(text);
+}
+
+int main(int argc, const char *argv[]) {
+  global_string_intern_pool_init();
+  test_parse_parallel_in_each_mode_();
+  test_parse_parallel_without_boundary_();
+  test_parse_parallel_empty_items_();
+  test_reset_reuses_trees_();
+  global_string_intern_pool_finalize();
+  return 0;
+}
@@ -99,20 +99,44 @@ void produce_parser_builder_(ParserBuilder *pb, const ExpressionTree *etree) {
   }
 }
 
+#define MAX_POSITIONAL_ARGS_ 8
+
 int main(int argc, const char *argv[]) {
   global_string_intern_pool_init();
 
+  // Flags may appear anywhere; everything else is positional.
+  const char *args[MAX_POSITIONAL_ARGS_] = {NULL};
+  int num_args = 0;
+  const char *root = NULL;
+  const char *materialized = NULL;
+  bool grammar_errors = false;
+  bool grammar_verbose = false;
+  for (int i = 0; i < argc; ++i) {
+    if (0 == strncmp("--root=", argv[i], strlen("--root="))) {
+      root = argv[i] + strlen("--root=");
+    } else if (0 == strncmp("--materialized=", argv[i],
+                            strlen("--materialized="))) {
+      materialized = argv[i] + strlen("--materialized=");
+    } else if (0 == strcmp("--grammar_errors", argv[i])) {
+      grammar_errors = true;
+    } else if (0 == strcmp("--grammar_verbose", argv[i])) {
+      grammar_verbose = true;
+    } else if (num_args < MAX_POSITIONAL_ARGS_) {
+      args[num_args++] = argv[i];
+    }
+  }
+
   TokenArray tokens;
   TokenArray_init(&tokens);
 
-  FileInfo *fi = file_info(argv[1]);
-  const bool header = 0 == strcmp("header", argv[2]);
-  FILE *out_file = fopen(argv[3], "w");
+  FileInfo *fi = file_info(args[1]);
+  const bool header = 0 == strcmp("header", args[2]);
+  FILE *out_file = fopen(args[3], "w");
 
   lexer_tokenize(fi, &tokens);
 
   Parser parser;
-  parser_init(&parser, rule_production_rule_set, /*ignore_newline=*/true);
+  parser_init(&parser, rule_production_rule_set);
 
   SyntaxTree *productions = parser_parse(&parser, &tokens);
 
@@ -137,11 +161,31 @@ int main(int argc, const char *argv[]) {
 
   produce_parser_builder_(pb, etree);
 
+  // A comma-separated list of rules.
+  while (NULL != materialized && '\0' != *materialized) {
+    const char *end = strchr(materialized, ',');
+    const int len = NULL == end ? strlen(materialized) : end - materialized;
+    if (len > 0) {
+      parser_builder_materialize(pb,
+                                 global_intern_range(materialized, 0, len));
+    }
+    materialized += NULL == end ? len : len + 1;
+  }
+
+  // The report is only emitted once, alongside the source.
+  if (!header &&
+      parser_builder_analyze(pb, root, grammar_verbose, stderr) > 0 &&
+      grammar_errors) {
+    fprintf(stderr, "Grammar analysis findings are errors.\n");
+    fclose(out_file);
+    exit(1);
+  }
+
   if (header) {
     parser_builder_write_h_file(pb, out_file);
   } else {
-    const char *h_file = global_intern(argv[4]);
-    const char *lexer_h_file = global_intern(argv[5]);
+    const char *h_file = global_intern(args[4]);
+    const char *lexer_h_file = global_intern(args[5]);
     parser_builder_write_c_file(pb, h_file, lexer_h_file, out_file);
   }
 
@@ -30,8 +30,7 @@ void populate_list1_(SemanticAnalyzer *analyzer, const SyntaxTree *list1,
                      ExpressionTreeArray *expressions) {
   EXPECT_TYPE(list1, rule_list1);
   const SyntaxTree *first = CHILD_SYNTAX_AT(list1, 1);
-  ExpressionTree *first_rule = semantic_analyzer_populate(analyzer, first);
-  ExpressionTreeArray_push_back(expressions, first_rule);
+  APPEND_TREE(analyzer, expressions, first);
 
   const SyntaxTree *tail = CHILD_SYNTAX_AT(list1, 2);
   if (NULL != tail) {
@@ -45,8 +44,7 @@ void populate_list_(SemanticAnalyzer *analyzer, const SyntaxTree *child_list,
   ExpressionTreeArray_init(expressions);
 
   const SyntaxTree *first = CHILD_SYNTAX_AT(child_list, 0);
-  ExpressionTree *first_rule = semantic_analyzer_populate(analyzer, first);
-  ExpressionTreeArray_push_back(expressions, first_rule);
+  APPEND_TREE(analyzer, expressions, first);
 
   const SyntaxTree *tail = CHILD_SYNTAX_AT(child_list, 1);
   populate_list1_(analyzer, tail, expressions);
@@ -155,8 +153,7 @@ void populate_production_rule_set1_(SemanticAnalyzer *analyzer,
   for (; SyntaxTreeArray_has_next(&children); SyntaxTreeArray_next(&children)) {
     const SyntaxTree *st_child = *SyntaxTreeArray_value(&children);
     if (IS_SYNTAX(st_child, rule_production_rule)) {
-      ExpressionTree *exp = semantic_analyzer_populate(analyzer, st_child);
-      ExpressionTreeArray_push_back(rules, exp);
+      APPEND_TREE(analyzer, rules, st_child);
     } else if (IS_SYNTAX(st_child, rule_production_rule_set1)) {
       populate_production_rule_set1_(analyzer, st_child, rules);
     }
@@ -167,8 +164,7 @@ POPULATE_IMPL(production_rule_set, const SyntaxTree *stree,
               SemanticAnalyzer *analyzer) {
   ExpressionTreeArray_init(&production_rule_set->rules);
   const SyntaxTree *first = CHILD_SYNTAX_AT(stree, 0);
-  ExpressionTree *first_rule = semantic_analyzer_populate(analyzer, first);
-  ExpressionTreeArray_push_back(&production_rule_set->rules, first_rule);
+  APPEND_TREE(analyzer, &production_rule_set->rules, first);
   if (SyntaxTreeArray_size(&stree->children) > 1) {
     populate_production_rule_set1_(analyzer, CHILD_SYNTAX_AT(stree, 1),
                                    &production_rule_set->rules);
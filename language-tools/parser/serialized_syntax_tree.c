@@ -0,0 +1,384 @@
+#include "language-tools/parser/serialized_syntax_tree.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "c-data-structures/arraylike.h"
+#include "c-data-structures/maplike.h"
+
+DEFINE_ARRAYLIKE(SerializedNodeArray, SerializedNode);
+IMPL_ARRAYLIKE(SerializedNodeArray, SerializedNode);
+DEFINE_ARRAYLIKE(SerializedTokenArray, SerializedToken);
+IMPL_ARRAYLIKE(SerializedTokenArray, SerializedToken);
+
+// Strings are deduplicated by content, since the text of tokens lexed into a
+// TokenArena is copied rather than interned.
+DEFINE_MAPLIKE(StringOffsetMap, char *, int32_t);
+IMPL_MAPLIKE(StringOffsetMap, char *, int32_t);
+
+// FNV-1a.
+static uint32_t string_hasher_(const char *str, uint32_t len) {
+  uint32_t hash = 2166136261u;
+  for (uint32_t i = 0; i < len; ++i) {
+    hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static int32_t string_comparator_(const char *str1, uint32_t str1_len,
+                                  const char *str2, uint32_t str2_len) {
+  if (str1_len != str2_len) {
+    return (str1_len > str2_len) - (str1_len < str2_len);
+  }
+  return memcmp(str1, str2, str1_len);
+}
+
+// Indices into the rule table, keyed by RuleFn.
+DEFINE_MAPLIKE(RuleIndexMap, void *, int32_t);
+IMPL_MAPLIKE(RuleIndexMap, void *, int32_t);
+
+static uint32_t rule_ptr_hasher_(const void *ptr, uint32_t size) {
+  return (uint32_t)(intptr_t)ptr;
+}
+
+static int32_t rule_ptr_comparator_(const void *ptr1, uint32_t ptr1_len,
+                                    const void *ptr2, uint32_t ptr2_len) {
+  return (ptr1 > ptr2) - (ptr1 < ptr2);
+}
+
+typedef struct {
+  RuleIndexMap rule_indices;
+  // Set when a tree has a rule that is not in the rule table.
+  bool unknown_rule;
+  // Trees in the same order as nodes.
+  SyntaxTreeArray pending;
+  SerializedNodeArray nodes;
+  SerializedTokenArray tokens;
+  StringOffsetMap string_offsets;
+  FILE *strings;
+  char *strings_buffer;
+  size_t strings_size;
+} SyntaxTreeWriter_;
+
+static int32_t write_string_(SyntaxTreeWriter_ *writer, const char str[]) {
+  if (NULL == str) {
+    return SERIALIZED_NONE;
+  }
+  const uint32_t len = strlen(str);
+  bool found;
+  int32_t offset =
+      StringOffsetMap_find(&writer->string_offsets, (char *)str, len, &found);
+  if (found) {
+    return offset;
+  }
+  offset = (int32_t)ftell(writer->strings);
+  fwrite(str, sizeof(char), len + 1, writer->strings);
+  StringOffsetMap_insert(&writer->string_offsets, (char *)str, len, offset);
+  return offset;
+}
+
+static int32_t rule_index_(SyntaxTreeWriter_ *writer, RuleFn rule_fn) {
+  if (NULL == rule_fn) {
+    return SERIALIZED_NONE;
+  }
+  bool found;
+  const int32_t index = RuleIndexMap_find(&writer->rule_indices,
+                                          (void *)rule_fn, sizeof(RuleFn),
+                                          &found);
+  if (!found) {
+    writer->unknown_rule = true;
+    return SERIALIZED_NONE;
+  }
+  return index;
+}
+
+static int32_t write_token_(SyntaxTreeWriter_ *writer, const Token *token) {
+  if (NULL == token) {
+    return SERIALIZED_NONE;
+  }
+  SerializedToken *stoken = SerializedTokenArray_push_back_ref(&writer->tokens);
+  stoken->type = token->type;
+#ifdef LANGUAGE_TOOLS_COMPACT_TOKENS
+  stoken->line = SERIALIZED_NONE;
+  stoken->col = token->offset;
+#else
+  stoken->line = token->line;
+  stoken->col = token->col;
+#endif
+  stoken->len = (uint32_t)token->len;
+  stoken->text = (uint32_t)write_string_(writer, token->text);
+  return (int32_t)SerializedTokenArray_size(&writer->tokens) - 1;
+}
+
+// Appends st as a node whose children are filled in by write_children_().
+static void add_node_(SyntaxTreeWriter_ *writer, const SyntaxTree *st) {
+  SyntaxTreeArray_push_back(&writer->pending, (SyntaxTree *)st);
+  SerializedNode *node = SerializedNodeArray_push_back_ref(&writer->nodes);
+  node->rule = rule_index_(writer, st->rule_fn);
+  node->production_name = write_string_(writer, st->production_name);
+  node->first_child = 0;
+  node->num_children = 0;
+  node->token = write_token_(writer, st->token);
+  node->flags = (st->matched ? SERIALIZED_NODE_MATCHED : 0) |
+                (&MATCH_EPSILON == st ? SERIALIZED_NODE_EPSILON : 0);
+}
+
+static void write_children_(SyntaxTreeWriter_ *writer, int index) {
+  const SyntaxTree *st = SyntaxTreeArray_get_unchecked(&writer->pending, index);
+  if (!st->has_children) {
+    return;
+  }
+  const uint32_t first_child = SerializedNodeArray_size(&writer->nodes);
+  SyntaxTreeArrayIterator children;
+  SyntaxTreeArray_iterator(&children, (SyntaxTreeArray *)&st->children);
+  for (; SyntaxTreeArray_has_next(&children);
+       SyntaxTreeArray_next(&children)) {
+    add_node_(writer, *SyntaxTreeArray_value(&children));
+  }
+  SerializedNode *node =
+      SerializedNodeArray_mutable_ref_unchecked(&writer->nodes, index);
+  node->first_child = first_child;
+  node->num_children = SerializedNodeArray_size(&writer->nodes) - first_child;
+  node->flags |= SERIALIZED_NODE_HAS_CHILDREN;
+}
+
+static bool write_(const void *data, size_t size, FILE *out) {
+  return 0 == size || 1 == fwrite(data, size, 1, out);
+}
+
+static void writer_finalize_(SyntaxTreeWriter_ *writer) {
+  free(writer->strings_buffer);
+  StringOffsetMap_finalize(&writer->string_offsets);
+  SerializedTokenArray_finalize(&writer->tokens);
+  SerializedNodeArray_finalize(&writer->nodes);
+  SyntaxTreeArray_finalize(&writer->pending);
+  RuleIndexMap_finalize(&writer->rule_indices);
+}
+
+bool syntax_tree_serialize(const SyntaxTree *const trees[], int num_trees,
+                           const RuleFn rules[], int num_rules, FILE *out) {
+  SyntaxTreeWriter_ writer = {.unknown_rule = false};
+  RuleIndexMap_init(&writer.rule_indices, rule_ptr_hasher_,
+                    rule_ptr_comparator_);
+  for (int i = 0; i < num_rules; ++i) {
+    bool found;
+    RuleIndexMap_find(&writer.rule_indices, (void *)rules[i], sizeof(RuleFn),
+                      &found);
+    // Keeps the first index of a rule listed twice.
+    if (!found) {
+      RuleIndexMap_insert(&writer.rule_indices, (void *)rules[i],
+                          sizeof(RuleFn), i);
+    }
+  }
+  SyntaxTreeArray_init(&writer.pending);
+  SerializedNodeArray_init(&writer.nodes);
+  SerializedTokenArray_init(&writer.tokens);
+  StringOffsetMap_init(&writer.string_offsets, string_hasher_,
+                       string_comparator_);
+  writer.strings = open_memstream(&writer.strings_buffer, &writer.strings_size);
+
+  for (int i = 0; i < num_trees; ++i) {
+    add_node_(&writer, trees[i]);
+  }
+  // Breadth-first, so that siblings are adjacent.
+  for (int i = 0; i < SyntaxTreeArray_size(&writer.pending); ++i) {
+    write_children_(&writer, i);
+  }
+  // Pads the string table so that a following file section stays aligned.
+  while (0 != ftell(writer.strings) % sizeof(uint32_t)) {
+    fputc('\0', writer.strings);
+  }
+  fclose(writer.strings);
+  if (writer.unknown_rule) {
+    fprintf(stderr, "Rule not in rule table for syntax tree serialization.\n");
+    writer_finalize_(&writer);
+    return false;
+  }
+
+  const SerializedSyntaxTreeHeader header = {
+      .magic = SERIALIZED_SYNTAX_TREE_MAGIC,
+      .version = SERIALIZED_SYNTAX_TREE_VERSION,
+      .num_rules = num_rules,
+      .num_roots = num_trees,
+      .num_nodes = SerializedNodeArray_size(&writer.nodes),
+      .num_tokens = SerializedTokenArray_size(&writer.tokens),
+      .strings_size = writer.strings_size,
+      .reserved = 0};
+  bool written = write_(&header, sizeof(header), out);
+  for (int i = 0; written && i < header.num_nodes; ++i) {
+    written =
+        write_(SerializedNodeArray_mutable_ref_unchecked(&writer.nodes, i),
+               sizeof(SerializedNode), out);
+  }
+  for (int i = 0; written && i < header.num_tokens; ++i) {
+    written =
+        write_(SerializedTokenArray_mutable_ref_unchecked(&writer.tokens, i),
+               sizeof(SerializedToken), out);
+  }
+  written = written && write_(writer.strings_buffer, writer.strings_size, out);
+  if (!written) {
+    fprintf(stderr, "Failed to write serialized syntax tree.\n");
+  }
+  writer_finalize_(&writer);
+  return written;
+}
+
+static bool invalid_(const char reason[]) {
+  fprintf(stderr, "Invalid serialized syntax tree: %s.\n", reason);
+  return false;
+}
+
+// Checks every index in the file so that walking it cannot read out of
+// bounds.
+static bool validate_(const SerializedSyntaxTree *sst) {
+  const SerializedSyntaxTreeHeader *header = sst->header;
+  if (header->num_roots > header->num_nodes) {
+    return invalid_("more roots than nodes");
+  }
+  if (header->strings_size > 0 &&
+      '\0' != sst->strings[header->strings_size - 1]) {
+    return invalid_("unterminated string table");
+  }
+  for (uint32_t i = 0; i < header->num_nodes; ++i) {
+    const SerializedNode *node = &sst->nodes[i];
+    if (SERIALIZED_NONE != node->rule &&
+        (node->rule < 0 || node->rule >= header->num_rules)) {
+      return invalid_("rule out of range");
+    }
+    if (SERIALIZED_NONE != node->production_name &&
+        (node->production_name < 0 ||
+         node->production_name >= header->strings_size)) {
+      return invalid_("production name out of range");
+    }
+    if (SERIALIZED_NONE != node->token &&
+        (node->token < 0 || node->token >= header->num_tokens)) {
+      return invalid_("token out of range");
+    }
+    if (node->num_children > 0 &&
+        (node->first_child <= i || node->first_child > header->num_nodes ||
+         node->num_children > header->num_nodes - node->first_child)) {
+      return invalid_("children out of range");
+    }
+  }
+  for (uint32_t i = 0; i < header->num_tokens; ++i) {
+    if (sst->tokens[i].text >= header->strings_size) {
+      return invalid_("token text out of range");
+    }
+  }
+  return true;
+}
+
+bool serialized_syntax_tree_init(SerializedSyntaxTree *sst, const void *data,
+                                 size_t size, const RuleFn rules[],
+                                 int num_rules) {
+  memset(sst, 0, sizeof(SerializedSyntaxTree));
+  if (size < sizeof(SerializedSyntaxTreeHeader)) {
+    return invalid_("truncated header");
+  }
+  const SerializedSyntaxTreeHeader *header = data;
+  if (SERIALIZED_SYNTAX_TREE_MAGIC != header->magic) {
+    return invalid_("bad magic number or byte order");
+  }
+  if (SERIALIZED_SYNTAX_TREE_VERSION != header->version) {
+    return invalid_("unsupported version");
+  }
+  if (header->num_rules != (uint32_t)num_rules) {
+    return invalid_("written with a different rule table");
+  }
+  const size_t expected_size =
+      sizeof(SerializedSyntaxTreeHeader) +
+      (size_t)header->num_nodes * sizeof(SerializedNode) +
+      (size_t)header->num_tokens * sizeof(SerializedToken) +
+      header->strings_size;
+  if (size < expected_size) {
+    return invalid_("truncated");
+  }
+  sst->header = header;
+  sst->nodes = (const SerializedNode *)(header + 1);
+  sst->tokens = (const SerializedToken *)(sst->nodes + header->num_nodes);
+  sst->strings = (const char *)(sst->tokens + header->num_tokens);
+  sst->rules = rules;
+  return validate_(sst);
+}
+
+bool serialized_syntax_tree_map(SerializedSyntaxTree *sst, const char path[],
+                                const RuleFn rules[], int num_rules) {
+  memset(sst, 0, sizeof(SerializedSyntaxTree));
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Could not open '%s'.\n", path);
+    return false;
+  }
+  struct stat st;
+  if (0 != fstat(fd, &st) || 0 == st.st_size) {
+    fprintf(stderr, "Could not read '%s'.\n", path);
+    close(fd);
+    return false;
+  }
+  void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (MAP_FAILED == mapping) {
+    fprintf(stderr, "Could not map '%s'.\n", path);
+    return false;
+  }
+  if (!serialized_syntax_tree_init(sst, mapping, st.st_size, rules,
+                                   num_rules)) {
+    munmap(mapping, st.st_size);
+    return false;
+  }
+  sst->mapping = mapping;
+  sst->mapping_size = st.st_size;
+  return true;
+}
+
+void serialized_syntax_tree_finalize(SerializedSyntaxTree *sst) {
+  if (NULL != sst->mapping) {
+    munmap(sst->mapping, sst->mapping_size);
+  }
+  memset(sst, 0, sizeof(SerializedSyntaxTree));
+}
+
+static void print_tabs_(FILE *file, int num_tabs) {
+  for (int i = 0; i < num_tabs; i++) {
+    fprintf(file, "  ");
+  }
+}
+
+void serialized_syntax_tree_print(const SerializedSyntaxTree *sst,
+                                  const SerializedNode *node, int level,
+                                  FILE *out) {
+  if (!(node->flags & SERIALIZED_NODE_MATCHED)) {
+    fprintf(out, "NO_MATCH");
+    return;
+  }
+  print_tabs_(out, level);
+  const char *production_name = SERIALIZED_STRING(sst, node->production_name);
+  if (NULL != production_name) {
+    fprintf(out, "[%s] ", production_name);
+  }
+  if (!(node->flags & SERIALIZED_NODE_HAS_CHILDREN)) {
+    if (node->flags & SERIALIZED_NODE_EPSILON) {
+      fprintf(out, "E");
+    } else {
+      const char *text = SERIALIZED_TOKEN_TEXT_FOR(sst, node);
+      if ('\n' == text[0]) {
+        fprintf(out, "\\n");
+      } else {
+        fprintf(out, "\"%s\"", text);
+      }
+    }
+    return;
+  }
+  fprintf(out, "{\n");
+  for (int i = 0; i < SERIALIZED_CHILD_COUNT(node); ++i) {
+    serialized_syntax_tree_print(sst, SERIALIZED_CHILD_AT(sst, node, i),
+                                 level + 1, out);
+    fprintf(out, "\n");
+  }
+  print_tabs_(out, level);
+  fprintf(out, "}");
+}
@@ -0,0 +1,146 @@
+#ifndef COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_PARSER_SERIALIZED_SYNTAX_TREE_H_
+#define COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_PARSER_SERIALIZED_SYNTAX_TREE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "language-tools/parser/parser.h"
+
+// Binary format for syntax trees and their tokens, laid out so that a file can
+// be mapped into memory and walked in place.
+//
+// A file is a SerializedSyntaxTreeHeader followed by the nodes, the tokens and
+// a string table of NUL-terminated strings. Nodes are in breadth-first order,
+// so the children of a node are the num_children nodes starting at
+// first_child, and the first num_roots nodes are the roots. Rules are stored as
+// indices into a table of RuleFns, which must be the same when writing and
+// reading. Integers are in the byte order of the machine that wrote the file.
+
+#define SERIALIZED_SYNTAX_TREE_MAGIC 0x5453544c  // "LTST"
+#define SERIALIZED_SYNTAX_TREE_VERSION 1
+
+// For nodes without a rule, token or production name.
+#define SERIALIZED_NONE (-1)
+
+typedef enum {
+  SERIALIZED_NODE_MATCHED = 1 << 0,
+  SERIALIZED_NODE_HAS_CHILDREN = 1 << 1,
+  // The node is MATCH_EPSILON.
+  SERIALIZED_NODE_EPSILON = 1 << 2,
+} SerializedNodeFlag;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_rules;
+  uint32_t num_roots;
+  uint32_t num_nodes;
+  uint32_t num_tokens;
+  uint32_t strings_size;
+  uint32_t reserved;
+} SerializedSyntaxTreeHeader;
+
+typedef struct {
+  int32_t rule;
+  // Offset into the string table.
+  int32_t production_name;
+  uint32_t first_child;
+  uint32_t num_children;
+  int32_t token;
+  uint32_t flags;
+} SerializedNode;
+
+typedef struct {
+  int32_t type;
+  // With compact tokens, line is SERIALIZED_NONE and col is the token's offset.
+  int32_t line, col;
+  uint32_t len;
+  // Offset into the string table.
+  uint32_t text;
+} SerializedToken;
+
+// A read-only view of a serialized file. Nothing is allocated to walk it.
+typedef struct {
+  const SerializedSyntaxTreeHeader *header;
+  const SerializedNode *nodes;
+  const SerializedToken *tokens;
+  const char *strings;
+  const RuleFn *rules;
+  // Set when the view owns a mapping of the file.
+  void *mapping;
+  size_t mapping_size;
+} SerializedSyntaxTree;
+
+// Writes trees, which must have been parsed with a parser whose rules are all
+// in rules, to out. Returns false if a tree has a rule that is not in rules, in
+// which case nothing is written, or if out could not be written.
+bool syntax_tree_serialize(const SyntaxTree *const trees[], int num_trees,
+                           const RuleFn rules[], int num_rules, FILE *out);
+
+// Views size bytes of serialized trees at data, which must be 4-byte aligned
+// and outlive sst. Returns false if the data is not a valid serialization for
+// rules.
+bool serialized_syntax_tree_init(SerializedSyntaxTree *sst, const void *data,
+                                 size_t size, const RuleFn rules[],
+                                 int num_rules);
+// Maps the file at path read-only and views it. Returns false if it could not
+// be mapped or is invalid.
+bool serialized_syntax_tree_map(SerializedSyntaxTree *sst, const char path[],
+                                const RuleFn rules[], int num_rules);
+void serialized_syntax_tree_finalize(SerializedSyntaxTree *sst);
+
+// Prints node in the same format as syntax_tree_print().
+void serialized_syntax_tree_print(const SerializedSyntaxTree *sst,
+                                  const SerializedNode *node, int level,
+                                  FILE *out);
+
+#define SERIALIZED_NUM_ROOTS(sst) ((int)(sst)->header->num_roots)
+
+#define SERIALIZED_ROOT_AT(sst, index) (&(sst)->nodes[(index)])
+
+#define SERIALIZED_STRING(sst, offset) \
+  (SERIALIZED_NONE == (offset) ? NULL : (sst)->strings + (offset))
+
+#define SERIALIZED_CHILD_COUNT(node) ((int)(node)->num_children)
+
+#define SERIALIZED_CHILD_AT(sst, node, index)               \
+  ((uint32_t)(index) < (node)->num_children                 \
+       ? &(sst)->nodes[(node)->first_child + (index)]       \
+       : NULL)
+
+#define SERIALIZED_IS_SYNTAX(sst, node, type)                    \
+  ((NULL != (node)) && SERIALIZED_NONE != (node)->rule &&        \
+   (sst)->rules[(node)->rule] == (type))
+
+#define SERIALIZED_HAS_TOKEN(node) \
+  ((NULL != (node)) && SERIALIZED_NONE != (node)->token)
+
+#define SERIALIZED_TOKEN(sst, node) \
+  (SERIALIZED_HAS_TOKEN(node) ? &(sst)->tokens[(node)->token] : NULL)
+
+#define SERIALIZED_IS_TOKEN(sst, node, token_type) \
+  (SERIALIZED_HAS_TOKEN(node) &&                   \
+   (sst)->tokens[(node)->token].type == (token_type))
+
+#define SERIALIZED_TOKEN_TEXT_FOR(sst, node)                                \
+  (SERIALIZED_HAS_TOKEN(node)                                               \
+       ? (sst)->strings + (sst)->tokens[(node)->token].text                 \
+       : NULL)
+
+#define SERIALIZED_CHILD_IS_SYNTAX(sst, node, index, type) \
+  SERIALIZED_IS_SYNTAX(sst, SERIALIZED_CHILD_AT(sst, node, index), type)
+
+#define SERIALIZED_CHILD_IS_TOKEN(sst, node, index, token_type) \
+  SERIALIZED_IS_TOKEN(sst, SERIALIZED_CHILD_AT(sst, node, index), token_type)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_PARSER_SERIALIZED_SYNTAX_TREE_H_ */
@@ -0,0 +1,223 @@
+#include "language-tools/parser/serialized_syntax_tree.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "file-utils/file_info.h"
+#include "language-tools/intern.h"
+#include "language-tools/lexer/token.h"
+#include "language-tools/parser/parser.h"
+#include "language-tools/parser/shared_helpers_parser.h"
+#include "language-tools/parser/test_lexer.h"
+#include "language-tools/testing/check.h"
+#include "language-tools/testing/token_testing.h"
+
+// Entry points of the helpers of b and c, which share their bodies. They are
+// not declared in the generated header.
+SyntaxTree *rule_b__or0(Parser *parser);
+SyntaxTree *rule_b__opt1(Parser *parser);
+SyntaxTree *rule_c__or0(Parser *parser);
+SyntaxTree *rule_c__opt1(Parser *parser);
+
+static const RuleFn RULES_[] = {rule_a,      rule_b,       rule_c,
+                                rule_b__or0, rule_b__opt1, rule_c__or0,
+                                rule_c__opt1};
+static const char *RULE_NAMES_[] = {"a",      "b",       "c",     "b__or0",
+                                    "b__opt1", "c__or0", "c__opt1"};
+#define NUM_RULES_ ((int)(sizeof(RULES_) / sizeof(RULES_[0])))
+
+// Every node built for a rule must name that rule, so that IS_SYNTAX() and
+// the rule table agree with its production name.
+static void check_rule_names_(const SyntaxTree *st) {
+  if (NULL != st->rule_fn) {
+    int i = 0;
+    for (; i < NUM_RULES_ && RULES_[i] != st->rule_fn; ++i) {
+    }
+    CHECK(i < NUM_RULES_);
+    CHECK_EQ_STR(RULE_NAMES_[i], st->production_name);
+  }
+  if (!st->has_children) {
+    return;
+  }
+  for (int i = 0; i < SyntaxTreeArray_size(&st->children); ++i) {
+    check_rule_names_(SyntaxTreeArray_get_unchecked(&st->children, i));
+  }
+}
+
+static char *print_tree_(const SyntaxTree *st) {
+  char *buffer;
+  size_t size;
+  FILE *out = open_memstream(&buffer, &size);
+  syntax_tree_print(st, 0, out);
+  fclose(out);
+  return buffer;
+}
+
+static char *print_serialized_(const SerializedSyntaxTree *sst, int root) {
+  char *buffer;
+  size_t size;
+  FILE *out = open_memstream(&buffer, &size);
+  serialized_syntax_tree_print(sst, SERIALIZED_ROOT_AT(sst, root), 0, out);
+  fclose(out);
+  return buffer;
+}
+
+static void test_serializes_shared_helpers_() {
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  tokenize_text(test_lexer_tokenize, "+ * *", &tokens);
+  Parser parser;
+  parser_init(&parser, rule_a);
+  const SyntaxTree *st = parser_parse(&parser, &tokens);
+  CHECK(st->matched);
+  check_rule_names_(st);
+
+  // b and c collapse to their OR helpers, which share a body but are named
+  // for the rule they were reached from.
+  CHECK(rule_b__or0 ==
+        SyntaxTreeArray_get_unchecked(&st->children, 1)->rule_fn);
+  CHECK(rule_c__or0 ==
+        SyntaxTreeArray_get_unchecked(&st->children, 2)->rule_fn);
+
+  char *data;
+  size_t size;
+  FILE *out = open_memstream(&data, &size);
+  CHECK(syntax_tree_serialize(&st, 1, RULES_, NUM_RULES_, out));
+  fclose(out);
+
+  SerializedSyntaxTree sst;
+  CHECK(serialized_syntax_tree_init(&sst, data, size, RULES_, NUM_RULES_));
+  const SerializedNode *root = SERIALIZED_ROOT_AT(&sst, 0);
+  CHECK(SERIALIZED_CHILD_IS_SYNTAX(&sst, root, 1, rule_b__or0));
+  CHECK(SERIALIZED_CHILD_IS_SYNTAX(&sst, root, 2, rule_c__or0));
+
+  char *expected = print_tree_(st);
+  char *actual = print_serialized_(&sst, 0);
+  CHECK_EQ_STR(expected, actual);
+
+  free(actual);
+  free(expected);
+  serialized_syntax_tree_finalize(&sst);
+  free(data);
+  parser_finalize(&parser);
+  TokenArray_finalize(&tokens);
+}
+
+// Writes several trees to a file and maps them back.
+static void test_round_trip_() {
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  tokenize_text(test_lexer_tokenize, "+ * * + - / * /", &tokens);
+  Parser parser;
+  parser_init(&parser, rule_a);
+  const SyntaxTree *trees[2];
+  for (int i = 0; i < 2; ++i) {
+    trees[i] = parser_parse(&parser, &tokens);
+    CHECK(trees[i]->matched);
+  }
+  CHECK(TokenArray_is_empty(&tokens));
+
+  char path[] = "/tmp/serialized_syntax_tree_test_XXXXXX";
+  const int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  FILE *out = fdopen(fd, "wb");
+  CHECK(syntax_tree_serialize(trees, 2, RULES_, NUM_RULES_, out));
+  fclose(out);
+
+  SerializedSyntaxTree sst;
+  CHECK(serialized_syntax_tree_map(&sst, path, RULES_, NUM_RULES_));
+  CHECK_EQ_INT(2, SERIALIZED_NUM_ROOTS(&sst));
+  for (int i = 0; i < 2; ++i) {
+    char *expected = print_tree_(trees[i]);
+    char *actual = print_serialized_(&sst, i);
+    CHECK_EQ_STR(expected, actual);
+    free(actual);
+    free(expected);
+  }
+  const SerializedNode *root = SERIALIZED_ROOT_AT(&sst, 1);
+  CHECK(SERIALIZED_IS_SYNTAX(&sst, root, rule_a));
+  CHECK(SERIALIZED_CHILD_IS_SYNTAX(&sst, root, 1, rule_b));
+  CHECK(SERIALIZED_CHILD_IS_SYNTAX(&sst, root, 2, rule_c));
+  const SerializedNode *c = SERIALIZED_CHILD_AT(&sst, root, 2);
+  const SerializedNode *slash = SERIALIZED_CHILD_AT(&sst, c, 1);
+  CHECK_EQ_STR("/", SERIALIZED_TOKEN_TEXT_FOR(&sst, slash));
+  // A different rule table is rejected.
+  serialized_syntax_tree_finalize(&sst);
+  CHECK(!serialized_syntax_tree_map(&sst, path, RULES_, NUM_RULES_ - 1));
+
+  unlink(path);
+  parser_finalize(&parser);
+  TokenArray_finalize(&tokens);
+}
+
+static void test_unknown_rule_() {
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  tokenize_text(test_lexer_tokenize, "+ * *", &tokens);
+  Parser parser;
+  parser_init(&parser, rule_a);
+  const SyntaxTree *st = parser_parse(&parser, &tokens);
+  CHECK(st->matched);
+
+  // rule_c__or0 is missing.
+  const RuleFn rules[] = {rule_a, rule_b, rule_c, rule_b__or0};
+  char *data;
+  size_t size;
+  FILE *out = open_memstream(&data, &size);
+  CHECK(!syntax_tree_serialize(&st, 1, rules, 4, out));
+  fclose(out);
+  CHECK_EQ_INT(0, size);
+
+  free(data);
+  parser_finalize(&parser);
+  TokenArray_finalize(&tokens);
+}
+
+// Text copied into an arena is written once per distinct string.
+static void test_dedups_arena_text_() {
+  const char text[] = "+ * *";
+  FileInfo *file = file_info_file(fmemopen((void *)text, strlen(text), "r"));
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  TokenArena arena;
+  token_arena_init(&arena);
+  test_lexer_tokenize_in_arena(file, &tokens, &arena);
+  file_info_delete(file);
+  Parser parser;
+  parser_init(&parser, rule_a);
+  const SyntaxTree *st = parser_parse(&parser, &tokens);
+  CHECK(st->matched);
+
+  char *data;
+  size_t size;
+  FILE *out = open_memstream(&data, &size);
+  CHECK(syntax_tree_serialize(&st, 1, RULES_, NUM_RULES_, out));
+  fclose(out);
+
+  SerializedSyntaxTree sst;
+  CHECK(serialized_syntax_tree_init(&sst, data, size, RULES_, NUM_RULES_));
+  const SerializedNode *root = SERIALIZED_ROOT_AT(&sst, 0);
+  const SerializedNode *star1 = SERIALIZED_CHILD_AT(&sst, root, 1);
+  const SerializedNode *star2 = SERIALIZED_CHILD_AT(&sst, root, 2);
+  CHECK_EQ_STR("*", SERIALIZED_TOKEN_TEXT_FOR(&sst, star1));
+  CHECK(SERIALIZED_TOKEN_TEXT_FOR(&sst, star1) ==
+        SERIALIZED_TOKEN_TEXT_FOR(&sst, star2));
+
+  serialized_syntax_tree_finalize(&sst);
+  free(data);
+  parser_finalize(&parser);
+  TokenArray_finalize(&tokens);
+  token_arena_finalize(&arena);
+}
+
+int main(int argc, const char *argv[]) {
+  global_string_intern_pool_init();
+  test_serializes_shared_helpers_();
+  test_round_trip_();
+  test_unknown_rule_();
+  test_dedups_arena_text_();
+  global_string_intern_pool_finalize();
+  return 0;
+}
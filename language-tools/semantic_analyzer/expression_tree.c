@@ -1,5 +1,8 @@
 #include "language-tools/semantic_analyzer/expression_tree.h"
 
+#include "language-tools/allocator.h"
+#include "language-tools/memory_stats.h"
+
 IMPL_ARRAYLIKE(ExpressionTreeArray, ExpressionTree *);
 IMPL_MAPLIKE(SAMap, void *, void *);
 
@@ -10,4 +13,23 @@ uint32_t SAMap_ptr_hasher(const void *ptr, uint32_t size) {
 int32_t SAMap_ptr_comparator(const void *ptr1, uint32_t ptr1_len,
                              const void *ptr2, uint32_t ptr2_len) {
   return ((intptr_t)ptr1) - ((intptr_t)ptr2);
+}
+
+ExpressionTree *expression_tree_create(RuleFn type, const char rule_name[],
+                                       size_t expression_size) {
+  ExpressionTree *etree = lt_malloc(sizeof(ExpressionTree));
+  etree->type = type;
+  etree->rule_name = rule_name;
+  etree->expression = lt_calloc(1, expression_size);
+  etree->expression_size = expression_size;
+  lt_memory_stats_alloc(LT_MEMORY_EXPRESSION_TREES,
+                        sizeof(ExpressionTree) + expression_size);
+  return etree;
+}
+
+void expression_tree_delete(ExpressionTree *tree) {
+  lt_memory_stats_free(LT_MEMORY_EXPRESSION_TREES,
+                       sizeof(ExpressionTree) + tree->expression_size);
+  lt_free(tree->expression, tree->expression_size);
+  lt_free(tree, sizeof(ExpressionTree));
 }
\ No newline at end of file
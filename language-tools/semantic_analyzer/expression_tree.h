@@ -17,6 +17,7 @@ typedef struct {
   RuleFn type;
   const char *rule_name;
   void *expression;
+  size_t expression_size;
 } ExpressionTree;
 
 DEFINE_ARRAYLIKE(ExpressionTreeArray, ExpressionTree *);
@@ -26,7 +27,13 @@ uint32_t SAMap_ptr_hasher(const void *ptr, uint32_t size);
 int32_t SAMap_ptr_comparator(const void *ptr1, uint32_t ptr1_len,
                              const void *ptr2, uint32_t ptr2_len);
 
-#define GET_MACRO_(_1, _2, NAME) NAME
+// Allocates a tree holding a zeroed expression of expression_size bytes.
+ExpressionTree *expression_tree_create(RuleFn type, const char rule_name[],
+                                       size_t expression_size);
+// Frees tree and its expression, but not what the expression refers to.
+void expression_tree_delete(ExpressionTree *tree);
+
+#define GET_MACRO_(_1, _2, NAME, ...) NAME
 #define DEFINE_EXPRESSION(...)                             \
   GET_MACRO_(__VA_ARGS__, DEFINE_EXPRESSION_WITH_PRODUCER, \
              DEFINE_EXPRESSION_NO_PRODUCER)                \
@@ -60,10 +67,8 @@ int32_t SAMap_ptr_comparator(const void *ptr1, uint32_t ptr1_len,
 
 #define POPULATE_IMPL(name, stree_input, analyzer_input)         \
   ExpressionTree *Populate_##name(stree_input, analyzer_input) { \
-    ExpressionTree *etree = malloc(sizeof(ExpressionTree));      \
-    etree->type = rule_##name;                                   \
-    etree->rule_name = #name;                                    \
-    etree->expression = calloc(1, sizeof(Expression_##name));    \
+    ExpressionTree *etree = expression_tree_create(              \
+        rule_##name, #name, sizeof(Expression_##name));          \
     Transform_##name(stree, etree->expression, analyzer);        \
     return etree;                                                \
   }                                                              \
@@ -83,9 +88,32 @@ int32_t SAMap_ptr_comparator(const void *ptr1, uint32_t ptr1_len,
   }                                                                         \
   void Delete_##name##_inner(Expression_##name *name, analyzer_input)
 
+// Defines the rewrite of expression name for the pass named pass_name. The
+// rewrite returns the tree that replaces tree, which may be tree itself after
+// modifying it in place. It is responsible for rewriting the children of tree
+// (with semantic_analyzer_rewrite(analyzer, child, pass)) and for deleting
+// whatever it no longer uses.
+#define REWRITE_IMPL(pass_name, name, analyzer_input)                        \
+  ExpressionTree *Rewrite_##pass_name##_##name##_inner(                      \
+      ExpressionTree *tree, Expression_##name *name, analyzer_input,         \
+      const RewritePass *pass);                                              \
+  ExpressionTree *Rewrite_##pass_name##_##name(                              \
+      ExpressionTree *tree, analyzer_input, const RewritePass *pass) {       \
+    return Rewrite_##pass_name##_##name##_inner(                             \
+        tree, (Expression_##name *)tree->expression, analyzer, pass);        \
+  }                                                                          \
+  ExpressionTree *Rewrite_##pass_name##_##name##_inner(                      \
+      ExpressionTree *tree, Expression_##name *name, analyzer_input,         \
+      const RewritePass *pass)
+
+#define CREATE_EXPRESSION(name) \
+  expression_tree_create(rule_##name, #name, sizeof(Expression_##name))
+
 #define REGISTRATION_FN(name) \
   void name(SAMap *populators, SAMap *producers, SAMap *deleters)
 
+#define REWRITE_PASS_FN(name) void name(SAMap *rewriters)
+
 #define REGISTER_EXPRESSION(name)                                              \
   {                                                                            \
     SAMap_insert(populators, rule_##name, sizeof(Populator), Populate_##name); \
@@ -99,6 +127,10 @@ int32_t SAMap_ptr_comparator(const void *ptr1, uint32_t ptr1_len,
     SAMap_insert(deleters, rule_##name, sizeof(EDeleter), Delete_##name);      \
   }
 
+#define REGISTER_REWRITE(pass_name, name)                \
+  SAMap_insert(rewriters, rule_##name, sizeof(Rewriter), \
+               Rewrite_##pass_name##_##name)
+
 #define EXPECT_TYPE(stree, type)              \
   if (stree->rule_fn != type) {               \
     fprintf(stderr, "Expected type: " #type); \
@@ -137,10 +169,14 @@ int32_t SAMap_ptr_comparator(const void *ptr1, uint32_t ptr1_len,
   (IS_EXPRESSION((etree), type) ? ((Expression_##type *)(etree)->expression) \
                                 : NULL)
 
-#define APPEND_TREE(sa, list_of_tree, stree)                      \
-  {                                                               \
-    ExpressionTree *expr = semantic_analyzer_populate(sa, stree); \
-    ExpressionTreeArray_push_back(list_of_tree, expr);            \
+#define APPEND_TREE(sa, list_of_tree, stree)                        \
+  {                                                                 \
+    if (semantic_analyzer_is_parallel_()) {                         \
+      append_tree_(sa, list_of_tree, stree);                        \
+    } else {                                                        \
+      ExpressionTree *expr = semantic_analyzer_populate(sa, stree); \
+      ExpressionTreeArray_push_back(list_of_tree, expr);            \
+    }                                                               \
   }
 
 #define EXTRACT_TREE(list_of_tree, i) extract_tree_(list_of_tree, i)
@@ -1,5 +1,55 @@
 #include "language-tools/semantic_analyzer/semantic_analyzer.h"
 
+#include <pthread.h>
+#include <sched.h>
+
+#include "language-tools/allocator.h"
+
+// A tree appended with APPEND_TREE that is populated by whichever worker gets
+// to it first, to be placed at index of list once done.
+typedef struct {
+  const SyntaxTree *tree;
+  ExpressionTreeArray *list;
+  int index;
+  ExpressionTree *result;
+  bool done;
+} PopulateTask_;
+
+DEFINE_ARRAYLIKE(PopulateTaskArray, PopulateTask_ *);
+IMPL_ARRAYLIKE(PopulateTaskArray, PopulateTask_ *);
+
+typedef struct PopulatePool_ PopulatePool_;
+
+typedef struct {
+  PopulatePool_ *pool;
+  pthread_t thread;
+  // Tasks are pushed and popped at the back by the worker that owns them and
+  // stolen from the front by the others.
+  pthread_mutex_t lock;
+  PopulateTaskArray deque;
+} PopulateWorker_;
+
+struct PopulatePool_ {
+  SemanticAnalyzer *analyzer;
+  int min_task_nodes;
+  int num_workers;
+  PopulateWorker_ *workers;
+  bool done;
+};
+
+// The tasks appended while a populator runs, which must be placed before it
+// returns its tree.
+typedef struct PopulateFrame_ PopulateFrame_;
+struct PopulateFrame_ {
+  PopulateFrame_ *parent;
+  bool has_tasks;
+  PopulateTaskArray tasks;
+};
+
+// Only set on threads running semantic_analyzer_populate_parallel().
+static _Thread_local PopulateWorker_ *worker_ = NULL;
+static _Thread_local PopulateFrame_ *frame_ = NULL;
+
 ExpressionTree *extract_tree_(ExpressionTreeArray *alist_of_tree, int index) {
   return ExpressionTreeArray_get_unchecked(alist_of_tree, index);
 }
@@ -18,6 +68,71 @@ void semantic_analyzer_finalize(SemanticAnalyzer *analyzer) {
   SAMap_finalize(&analyzer->deleters);
 }
 
+static PopulateTask_ *take_task_(PopulateWorker_ *worker) {
+  PopulateTask_ *task = NULL;
+  pthread_mutex_lock(&worker->lock);
+  if (!PopulateTaskArray_is_empty(&worker->deque)) {
+    task = PopulateTaskArray_pop_back_unchecked(&worker->deque);
+  }
+  pthread_mutex_unlock(&worker->lock);
+  if (NULL != task) {
+    return task;
+  }
+  PopulatePool_ *pool = worker->pool;
+  const int self = worker - pool->workers;
+  for (int i = 1; i < pool->num_workers && NULL == task; ++i) {
+    PopulateWorker_ *victim = &pool->workers[(self + i) % pool->num_workers];
+    pthread_mutex_lock(&victim->lock);
+    if (!PopulateTaskArray_is_empty(&victim->deque)) {
+      task = PopulateTaskArray_pop_front_unchecked(&victim->deque);
+    }
+    pthread_mutex_unlock(&victim->lock);
+  }
+  return task;
+}
+
+// Runs a task if there is one to take, returning whether there was.
+static bool run_task_(PopulateWorker_ *worker) {
+  PopulateTask_ *task = take_task_(worker);
+  if (NULL == task) {
+    return false;
+  }
+  task->result = semantic_analyzer_populate(worker->pool->analyzer, task->tree);
+  __atomic_store_n(&task->done, true, __ATOMIC_RELEASE);
+  return true;
+}
+
+// Waits for the tasks of frame, running others meanwhile, and places their
+// results.
+static void finish_tasks_(PopulateWorker_ *worker, PopulateFrame_ *frame) {
+  if (!frame->has_tasks) {
+    return;
+  }
+  for (int i = 0; i < PopulateTaskArray_size(&frame->tasks); ++i) {
+    PopulateTask_ *task = PopulateTaskArray_get_unchecked(&frame->tasks, i);
+    while (!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE)) {
+      if (!run_task_(worker)) {
+        sched_yield();
+      }
+    }
+    *ExpressionTreeArray_mutable_ref_unchecked(task->list, task->index) =
+        task->result;
+    lt_free(task, sizeof(PopulateTask_));
+  }
+  PopulateTaskArray_finalize(&frame->tasks);
+}
+
+static void *run_worker_(void *arg) {
+  worker_ = (PopulateWorker_ *)arg;
+  while (!__atomic_load_n(&worker_->pool->done, __ATOMIC_ACQUIRE)) {
+    if (!run_task_(worker_)) {
+      sched_yield();
+    }
+  }
+  worker_ = NULL;
+  return NULL;
+}
+
 ExpressionTree *semantic_analyzer_populate(SemanticAnalyzer *analyzer,
                                            const SyntaxTree *tree) {
   Populator populate = (Populator)SAMap_find(
@@ -26,7 +141,98 @@ ExpressionTree *semantic_analyzer_populate(SemanticAnalyzer *analyzer,
     fprintf(stderr, "Populator not found: %s", tree->production_name);
     exit(1);
   }
-  return populate(tree, analyzer);
+  if (NULL == worker_) {
+    return populate(tree, analyzer);
+  }
+  PopulateFrame_ frame = {.parent = frame_, .has_tasks = false};
+  frame_ = &frame;
+  ExpressionTree *etree = populate(tree, analyzer);
+  frame_ = frame.parent;
+  finish_tasks_(worker_, &frame);
+  return etree;
+}
+
+// Counts the nodes of st, stopping once there are at least limit.
+static int count_nodes_(const SyntaxTree *st, int limit) {
+  int num_nodes = 1;
+  if (!st->has_children) {
+    return num_nodes;
+  }
+  SyntaxTreeArrayIterator children;
+  SyntaxTreeArray_iterator(&children, (SyntaxTreeArray *)&st->children);
+  for (; SyntaxTreeArray_has_next(&children) && num_nodes < limit;
+       SyntaxTreeArray_next(&children)) {
+    num_nodes += count_nodes_(*SyntaxTreeArray_value(&children),
+                              limit - num_nodes);
+  }
+  return num_nodes;
+}
+
+bool semantic_analyzer_is_parallel_() { return NULL != worker_; }
+
+void append_tree_(SemanticAnalyzer *analyzer, ExpressionTreeArray *list_of_tree,
+                  const SyntaxTree *tree) {
+  if (NULL == worker_ ||
+      count_nodes_(tree, worker_->pool->min_task_nodes) <
+          worker_->pool->min_task_nodes) {
+    ExpressionTreeArray_push_back(list_of_tree,
+                                  semantic_analyzer_populate(analyzer, tree));
+    return;
+  }
+  PopulateTask_ *task = lt_malloc(sizeof(PopulateTask_));
+  task->tree = tree;
+  task->list = list_of_tree;
+  task->index = ExpressionTreeArray_size(list_of_tree);
+  task->result = NULL;
+  task->done = false;
+  // Reserves the slot so that later siblings keep their places.
+  ExpressionTreeArray_push_back(list_of_tree, NULL);
+  if (!frame_->has_tasks) {
+    PopulateTaskArray_init(&frame_->tasks);
+    frame_->has_tasks = true;
+  }
+  PopulateTaskArray_push_back(&frame_->tasks, task);
+  pthread_mutex_lock(&worker_->lock);
+  PopulateTaskArray_push_back(&worker_->deque, task);
+  pthread_mutex_unlock(&worker_->lock);
+}
+
+ExpressionTree *semantic_analyzer_populate_parallel(SemanticAnalyzer *analyzer,
+                                                    const SyntaxTree *tree,
+                                                    int num_threads,
+                                                    int min_task_nodes) {
+  PopulatePool_ pool = {.analyzer = analyzer,
+                        .min_task_nodes = min_task_nodes,
+                        .num_workers = num_threads > 1 ? num_threads : 1,
+                        .done = false};
+  pool.workers = lt_calloc(pool.num_workers, sizeof(PopulateWorker_));
+  for (int i = 0; i < pool.num_workers; ++i) {
+    pool.workers[i].pool = &pool;
+    pthread_mutex_init(&pool.workers[i].lock, NULL);
+    PopulateTaskArray_init(&pool.workers[i].deque);
+  }
+  // The calling thread is the first worker.
+  for (int i = 1; i < pool.num_workers; ++i) {
+    if (0 != pthread_create(&pool.workers[i].thread, NULL, run_worker_,
+                            &pool.workers[i])) {
+      fprintf(stderr, "Failed to start semantic analyzer thread.\n");
+      exit(1);
+    }
+  }
+  worker_ = &pool.workers[0];
+  ExpressionTree *etree = semantic_analyzer_populate(analyzer, tree);
+  worker_ = NULL;
+
+  __atomic_store_n(&pool.done, true, __ATOMIC_RELEASE);
+  for (int i = 1; i < pool.num_workers; ++i) {
+    pthread_join(pool.workers[i].thread, NULL);
+  }
+  for (int i = 0; i < pool.num_workers; ++i) {
+    pthread_mutex_destroy(&pool.workers[i].lock);
+    PopulateTaskArray_finalize(&pool.workers[i].deque);
+  }
+  lt_free(pool.workers, sizeof(PopulateWorker_) * pool.num_workers);
+  return etree;
 }
 
 void semantic_analyzer_delete(SemanticAnalyzer *analyzer,
@@ -38,6 +244,27 @@ void semantic_analyzer_delete(SemanticAnalyzer *analyzer,
     exit(1);
   }
   del(tree, analyzer);
-  free(tree->expression);
-  free(tree);
+  expression_tree_delete(tree);
+}
+
+void rewrite_pass_init(RewritePass *pass, const char name[],
+                       RewritePassInitFn init_fn) {
+  pass->name = name;
+  SAMap_init(&pass->rewriters, SAMap_ptr_hasher, SAMap_ptr_comparator);
+  init_fn(&pass->rewriters);
+}
+
+void rewrite_pass_finalize(RewritePass *pass) {
+  SAMap_finalize(&pass->rewriters);
+}
+
+ExpressionTree *semantic_analyzer_rewrite(SemanticAnalyzer *analyzer,
+                                          ExpressionTree *tree,
+                                          const RewritePass *pass) {
+  Rewriter rewrite = (Rewriter)SAMap_find((SAMap *)&pass->rewriters,
+                                          tree->type, sizeof(Rewriter), NULL);
+  if (NULL == rewrite) {
+    return tree;
+  }
+  return rewrite(tree, analyzer, pass);
 }
\ No newline at end of file
@@ -20,6 +20,19 @@ typedef void (*EDeleter)(ExpressionTree *tree, SemanticAnalyzer *analyzer);
 
 typedef void (*SemanticAnalyzerInitFn)(SAMap *, SAMap *, SAMap *);
 
+// A transformation of expression trees, e.g. an optimization, made of a
+// rewrite per rule. Rules without a rewrite are left as they are.
+typedef struct {
+  const char *name;
+  SAMap rewriters;
+} RewritePass;
+
+typedef ExpressionTree *(*Rewriter)(ExpressionTree *tree,
+                                    SemanticAnalyzer *analyzer,
+                                    const RewritePass *pass);
+
+typedef void (*RewritePassInitFn)(SAMap *);
+
 void semantic_analyzer_init(SemanticAnalyzer *analyzer,
                             SemanticAnalyzerInitFn init_fn);
 void semantic_analyzer_finalize(SemanticAnalyzer *analyzer);
@@ -27,6 +40,19 @@ void semantic_analyzer_finalize(SemanticAnalyzer *analyzer);
 ExpressionTree *semantic_analyzer_populate(SemanticAnalyzer *analyzer,
                                            const SyntaxTree *tree);
 
+// Like semantic_analyzer_populate(), but each tree appended with APPEND_TREE
+// whose syntax tree has at least min_task_nodes nodes is populated as a task,
+// on up to num_threads threads that steal tasks from each other. A task's
+// result is placed in the slot APPEND_TREE reserved for it, once the
+// populator that appended it returns, so the result is the same as with
+// semantic_analyzer_populate(). Populators must therefore be thread-safe and
+// must not read the trees they append before returning. Outside of this
+// function, APPEND_TREE populates eagerly.
+ExpressionTree *semantic_analyzer_populate_parallel(SemanticAnalyzer *analyzer,
+                                                    const SyntaxTree *tree,
+                                                    int num_threads,
+                                                    int min_task_nodes);
+
 #define DEFINE_SEMANTIC_ANALYZER_PRODUCE_FN(ProduceType)              \
   typedef int (*Producer)(const ExpressionTree *tree,                 \
                           SemanticAnalyzer *analyzer, ProduceType *); \
@@ -49,7 +75,22 @@ ExpressionTree *semantic_analyzer_populate(SemanticAnalyzer *analyzer,
 
 void semantic_analyzer_delete(SemanticAnalyzer *analyzer, ExpressionTree *tree);
 
+void rewrite_pass_init(RewritePass *pass, const char name[],
+                       RewritePassInitFn init_fn);
+void rewrite_pass_finalize(RewritePass *pass);
+
+// Applies pass to tree and returns the tree that replaces it. tree must not
+// be used afterwards unless it is the one returned.
+ExpressionTree *semantic_analyzer_rewrite(SemanticAnalyzer *analyzer,
+                                          ExpressionTree *tree,
+                                          const RewritePass *pass);
+
 ExpressionTree *extract_tree_(ExpressionTreeArray *list_of_tree, int index);
+// Whether this thread is populating for semantic_analyzer_populate_parallel().
+bool semantic_analyzer_is_parallel_();
+// Like APPEND_TREE, but may leave the tree to a task in parallel mode.
+void append_tree_(SemanticAnalyzer *analyzer, ExpressionTreeArray *list_of_tree,
+                  const SyntaxTree *tree);
 
 #ifdef __cplusplus
 }
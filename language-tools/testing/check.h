@@ -0,0 +1,47 @@
+#ifndef COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_TESTING_CHECK_H_
+#define COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_TESTING_CHECK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Assertions for tests. Unlike assert(), they are kept with NDEBUG.
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if (!(condition)) {                                                    \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__,     \
+              #condition);                                                 \
+      exit(1);                                                             \
+    }                                                                      \
+  } while (0)
+
+#define CHECK_EQ_INT(expected, actual)                                     \
+  do {                                                                     \
+    const long long expected_ = (expected), actual_ = (actual);           \
+    if (expected_ != actual_) {                                            \
+      fprintf(stderr, "%s:%d: CHECK failed: %s == %s (%lld vs %lld)\n",    \
+              __FILE__, __LINE__, #expected, #actual, expected_, actual_); \
+      exit(1);                                                             \
+    }                                                                      \
+  } while (0)
+
+#define CHECK_EQ_STR(expected, actual)                                     \
+  do {                                                                     \
+    const char *expected_ = (expected), *actual_ = (actual);              \
+    if (0 != strcmp(expected_, actual_)) {                                 \
+      fprintf(stderr, "%s:%d: CHECK failed: %s == %s (\"%s\" vs \"%s\")\n", \
+              __FILE__, __LINE__, #expected, #actual, expected_, actual_); \
+      exit(1);                                                             \
+    }                                                                      \
+  } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_TESTING_CHECK_H_ */
@@ -0,0 +1,35 @@
+#include "language-tools/testing/token_testing.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "language-tools/testing/check.h"
+
+void tokenize_text(TestTokenizeFn tokenize, const char text[],
+                   TokenArray *tokens) {
+  FileInfo *file = file_info_file(fmemopen((void *)text, strlen(text), "r"));
+  tokenize(file, tokens);
+  file_info_delete(file);
+}
+
+void check_tokens(TestTokenizeFn tokenize,
+                  TestTokenTypeToNameFn token_type_to_name, const char text[],
+                  int num_tokens, const int types[], const char *texts[],
+                  const int cols[]) {
+  TokenArray tokens;
+  TokenArray_init(&tokens);
+  tokenize_text(tokenize, text, &tokens);
+  CHECK_EQ_INT(num_tokens, TokenArray_size(&tokens));
+  for (int i = 0; i < num_tokens; ++i) {
+    const Token *token = TokenArray_get_unchecked(&tokens, i);
+    CHECK_EQ_STR(token_type_to_name(types[i]),
+                 token_type_to_name(token->type));
+    CHECK_EQ_STR(texts[i], token->text);
+    if (NULL != cols) {
+      int line, col;
+      token_line_col(NULL, token, &line, &col);
+      CHECK_EQ_INT(cols[i], col);
+    }
+  }
+  TokenArray_finalize(&tokens);
+}
@@ -0,0 +1,34 @@
+#ifndef COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_TESTING_TOKEN_TESTING_H_
+#define COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_TESTING_TOKEN_TESTING_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "file-utils/file_info.h"
+#include "language-tools/lexer/token.h"
+
+// Helpers for testing generated lexers and the parsers built on them.
+
+typedef void (*TestTokenizeFn)(FileInfo *file, TokenArray *tokens);
+// Generated <prefix>token_type_to_name() takes the lexer's own enum, so tests
+// wrap it to pass here.
+typedef const char *(*TestTokenTypeToNameFn)(int token_type);
+
+// Appends the tokens of text, as lexed by tokenize, to tokens.
+void tokenize_text(TestTokenizeFn tokenize, const char text[],
+                   TokenArray *tokens);
+
+// Tokenizes text and checks that it gives num_tokens tokens of types with
+// texts, starting at columns cols unless cols is NULL. Types are compared by
+// name so that failures show which ones differ.
+void check_tokens(TestTokenizeFn tokenize,
+                  TestTokenTypeToNameFn token_type_to_name, const char text[],
+                  int num_tokens, const int types[], const char *texts[],
+                  const int cols[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COM_GITHUB_JEFFMANZIONE_LANGUAGE_TOOLS_TESTING_TOKEN_TESTING_H_ */